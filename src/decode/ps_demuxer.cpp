@@ -0,0 +1,133 @@
+#include "ps_demuxer.h"
+
+// 解析失败时缓冲区的上限，超过后丢弃重新同步
+static const size_t kMaxBufferBytes = 4 * 1024 * 1024;
+
+static bool isStartCode(const uint8_t *p) {
+    return p[0] == 0 && p[1] == 0 && p[2] == 1;
+}
+
+static int64_t readPts(const uint8_t *p) {
+    return ((int64_t)(p[0] & 0x0E) << 29) | ((int64_t)p[1] << 22) | ((int64_t)(p[2] & 0xFE) << 14) |
+           ((int64_t)p[3] << 7) | (p[4] >> 1);
+}
+
+void PsDemuxer::reset() {
+    buf_.clear();
+    key_ = false;
+    codec_ = CODEC_UNKNOWN;
+}
+
+void PsDemuxer::feed(const uint8_t *data, size_t size, const Callback &callback) {
+    buf_.insert(buf_.end(), data, data + size);
+
+    size_t pos = 0;
+    while (pos + 4 <= buf_.size()) {
+        if (!isStartCode(&buf_[pos])) {
+            // 失步：找下一个包头
+            size_t next = pos + 1;
+            while (next + 4 <= buf_.size() && !(isStartCode(&buf_[next]) && buf_[next + 3] == 0xBA)) {
+                next++;
+            }
+            pos = next;
+            continue;
+        }
+        size_t used = parseUnit(pos, callback);
+        if (used == 0) break;
+        pos += used;
+    }
+    buf_.erase(buf_.begin(), buf_.begin() + pos);
+    if (buf_.size() > kMaxBufferBytes) {
+        buf_.clear();
+    }
+}
+
+size_t PsDemuxer::parseUnit(size_t pos, const Callback &callback) {
+    const uint8_t *p = &buf_[pos];
+    const size_t avail = buf_.size() - pos;
+    const uint8_t id = p[3];
+
+    if (id == 0xBA) {
+        // 包头：MPEG-2 为 14 字节加填充，MPEG-1 为 12 字节
+        if (avail < 14) return 0;
+        size_t len = (p[4] & 0xC0) == 0x40 ? 14 + (p[13] & 0x07) : 12;
+        if (avail < len) return 0;
+        key_ = false;
+        return len;
+    }
+
+    if (avail < 6) return 0;
+    size_t len = 6 + ((size_t)p[4] << 8 | p[5]);
+
+    if (id == 0xE0 && len == 6) {
+        // 长度为 0 的视频 PES：一直到下一个起始码
+        size_t next = 9;
+        while (next + 4 <= avail && !(isStartCode(p + next) && (p[next + 3] == 0xBA || p[next + 3] == 0xE0))) {
+            next++;
+        }
+        if (next + 4 > avail) return 0;
+        len = next;
+    }
+    if (avail < len) return 0;
+
+    if (id == 0xBB) {
+        // 系统头只出现在关键帧的 PS 包中
+        key_ = true;
+    } else if (id == 0xBC) {
+        parsePsm(p, len);
+    } else if (id == 0xE0 && len >= 9) {
+        size_t header = 9 + p[8];
+        if (header <= len) {
+            int64_t pts = -1;
+            if ((p[7] & 0x80) && p[8] >= 5) {
+                pts = readPts(p + 9);
+            }
+            if (codec_ == CODEC_UNKNOWN) {
+                probeCodec(p + header, len - header);
+            }
+            if (len > header) {
+                callback(p + header, len - header, pts, key_);
+            }
+        }
+    }
+    // 音频、私有流等其他单元直接跳过
+    return len;
+}
+
+void PsDemuxer::parsePsm(const uint8_t *p, size_t size) {
+    if (size < 12) return;
+    size_t info_len = (size_t)p[8] << 8 | p[9];
+    size_t pos = 10 + info_len;
+    if (pos + 2 > size) return;
+    size_t map_end = pos + 2 + ((size_t)p[pos] << 8 | p[pos + 1]);
+    pos += 2;
+    while (pos + 4 <= map_end && pos + 4 <= size) {
+        uint8_t stream_type = p[pos];
+        uint8_t stream_id = p[pos + 1];
+        size_t es_info_len = (size_t)p[pos + 2] << 8 | p[pos + 3];
+        if (stream_id == 0xE0) {
+            if (stream_type == 0x1B) {
+                codec_ = CODEC_H264;
+            } else if (stream_type == 0x24) {
+                codec_ = CODEC_H265;
+            }
+        }
+        pos += 4 + es_info_len;
+    }
+}
+
+void PsDemuxer::probeCodec(const uint8_t *p, size_t size) {
+    for (size_t i = 0; i + 4 < size; i++) {
+        if (!isStartCode(p + i)) continue;
+        uint8_t nal = p[i + 3];
+        int h264_type = nal & 0x1F;
+        int h265_type = (nal >> 1) & 0x3F;
+        // H.264 SPS/AUD，H.265 VPS/SPS/PPS/AUD
+        if (h264_type == 7 || h264_type == 9) {
+            codec_ = CODEC_H264;
+        } else if (h265_type >= 32 && h265_type <= 35) {
+            codec_ = CODEC_H265;
+        }
+        return;
+    }
+}
@@ -0,0 +1,41 @@
+// 海康 PS 流解复用：从 NET_DVR_STREAMDATA 数据中取出视频 PES 负载（H.264/H.265 裸流）
+
+#ifndef RK3588_DEMO_PS_DEMUXER_H
+#define RK3588_DEMO_PS_DEMUXER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <functional>
+#include <vector>
+
+class PsDemuxer {
+public:
+    enum Codec {
+        CODEC_UNKNOWN = 0,
+        CODEC_H264 = 1,
+        CODEC_H265 = 2,
+    };
+
+    // pts 为 90kHz 时间戳，没有时为 -1；key 表示所在的 PS 包带系统头（关键帧）
+    using Callback = std::function<void(const uint8_t *data, size_t size, int64_t pts, bool key)>;
+
+    // 数据可以在任意位置被切开，不完整的单元留到下一次再解析
+    void feed(const uint8_t *data, size_t size, const Callback &callback);
+    void reset();
+
+    // 由节目流映射（PSM）得到，没有 PSM 时从第一个 NAL 头推断
+    Codec codec() const { return codec_; }
+
+private:
+    // 解析 buf_[pos] 处的一个单元，返回消耗的字节数，数据不完整时返回 0
+    size_t parseUnit(size_t pos, const Callback &callback);
+    void parsePsm(const uint8_t *p, size_t size);
+    void probeCodec(const uint8_t *p, size_t size);
+
+    std::vector<uint8_t> buf_;
+    bool key_ = false;
+    Codec codec_ = CODEC_UNKNOWN;
+};
+
+#endif // RK3588_DEMO_PS_DEMUXER_H
@@ -0,0 +1,375 @@
+#include "sw_decoder.h"
+
+#include <algorithm>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/mathematics.h>
+#include <libswscale/swscale.h>
+}
+
+#include "utils/logging.h"
+
+// 队列溢出后保留的空闲缓冲区个数上限
+static const size_t kMaxFreeChunks = 64;
+
+SwDecoder::~SwDecoder() {
+    close();
+}
+
+int SwDecoder::interruptCallback(void *opaque) {
+    // 关闭时打断阻塞中的网络读取
+    return static_cast<SwDecoder *>(opaque)->stop_ ? 1 : 0;
+}
+
+bool SwDecoder::openCodec(int codec_id, const AVCodecParameters *codec_params) {
+    const AVCodec *codec = avcodec_find_decoder((AVCodecID)codec_id);
+    if (codec == nullptr) {
+        NN_LOG_ERROR("sw decoder: no decoder for codec id %d", codec_id);
+        return false;
+    }
+    codec_ = avcodec_alloc_context3(codec);
+    if (codec_ == nullptr) {
+        return false;
+    }
+    if (codec_params != nullptr && avcodec_parameters_to_context(codec_, codec_params) < 0) {
+        NN_LOG_ERROR("sw decoder: invalid codec parameters");
+        return false;
+    }
+    codec_->thread_count = std::max(1, params_.threads);
+    codec_->flags2 |= AV_CODEC_FLAG2_FAST;
+    // 非参考帧解码后不会被其他帧引用，跳过它们不影响后面的画面
+    codec_->skip_frame = params_.skip_nonref ? AVDISCARD_NONREF : AVDISCARD_DEFAULT;
+
+    if (avcodec_open2(codec_, codec, nullptr) < 0) {
+        NN_LOG_ERROR("sw decoder: failed to open %s decoder", codec->name);
+        return false;
+    }
+    if (format_ == nullptr) {
+        // PS 流没有封装层的帧边界，用解析器切分
+        parser_ = av_parser_init(codec->id);
+        if (parser_ == nullptr) {
+            NN_LOG_ERROR("sw decoder: no parser for %s", codec->name);
+            return false;
+        }
+    }
+    NN_LOG_INFO("sw decoder: %s, %d threads, skip non-ref: %d", codec->name, codec_->thread_count,
+                params_.skip_nonref ? 1 : 0);
+    return true;
+}
+
+bool SwDecoder::openPs(const Params &params, FrameCallback callback, FrameFilter filter) {
+    close();
+    params_ = params;
+    callback_ = std::move(callback);
+    filter_ = std::move(filter);
+    demuxer_.reset();
+    wait_key_ = false;
+    need_key_ = true;
+    stop_ = false;
+    finished_ = false;
+
+    packet_ = av_packet_alloc();
+    frame_ = av_frame_alloc();
+    if (packet_ == nullptr || frame_ == nullptr) {
+        release();
+        return false;
+    }
+    // 解码器在收到第一个带 PSM 的关键帧后才创建
+    thread_ = std::thread(&SwDecoder::psLoop, this);
+    return true;
+}
+
+void SwDecoder::feedPs(const uint8_t *data, size_t size) {
+    if (stop_ || !thread_.joinable()) return;
+
+    bool queued = false;
+    demuxer_.feed(data, size, [&](const uint8_t *es, size_t n, int64_t pts, bool key) {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        if (queued_bytes_ + n > params_.queue_bytes) {
+            // 解码跟不上：清空队列，从下一个关键帧重新开始
+            for (auto &chunk : queue_) {
+                dropped_bytes_ += chunk.data.size();
+                if (free_chunks_.size() < kMaxFreeChunks) free_chunks_.push_back(std::move(chunk));
+            }
+            queue_.clear();
+            queued_bytes_ = 0;
+            wait_key_ = true;
+        }
+        if (wait_key_ && !key) {
+            dropped_bytes_ += n;
+            return;
+        }
+        wait_key_ = false;
+
+        Chunk chunk;
+        if (!free_chunks_.empty()) {
+            chunk = std::move(free_chunks_.back());
+            free_chunks_.pop_back();
+        }
+        chunk.data.assign(es, es + n);
+        chunk.pts = pts;
+        chunk.key = key;
+        chunk.codec = demuxer_.codec();
+        queued_bytes_ += n;
+        queue_.push_back(std::move(chunk));
+        queued = true;
+    });
+    if (queued) {
+        queue_cv_.notify_one();
+    }
+}
+
+bool SwDecoder::openUrl(const std::string &url, const Params &params, FrameCallback callback, FrameFilter filter) {
+    close();
+    params_ = params;
+    callback_ = std::move(callback);
+    filter_ = std::move(filter);
+    url_ = url;
+    need_key_ = true;
+    stop_ = false;
+    finished_ = false;
+
+    format_ = avformat_alloc_context();
+    packet_ = av_packet_alloc();
+    frame_ = av_frame_alloc();
+    if (format_ == nullptr || packet_ == nullptr || frame_ == nullptr) {
+        release();
+        return false;
+    }
+    format_->interrupt_callback.callback = &SwDecoder::interruptCallback;
+    format_->interrupt_callback.opaque = this;
+
+    AVDictionary *options = nullptr;
+    if (url.compare(0, 7, "rtsp://") == 0) {
+        av_dict_set(&options, "rtsp_transport", "tcp", 0);
+#if LIBAVFORMAT_VERSION_MAJOR >= 59
+        av_dict_set(&options, "timeout", "5000000", 0);
+#else
+        av_dict_set(&options, "stimeout", "5000000", 0);
+#endif
+    }
+    int ret = avformat_open_input(&format_, url.c_str(), nullptr, &options);
+    av_dict_free(&options);
+    if (ret < 0) {
+        // 失败时 format_ 已被释放
+        format_ = nullptr;
+        NN_LOG_ERROR("sw decoder: failed to open %s", url.c_str());
+        release();
+        return false;
+    }
+    if (avformat_find_stream_info(format_, nullptr) < 0) {
+        NN_LOG_ERROR("sw decoder: no stream info in %s", url.c_str());
+        release();
+        return false;
+    }
+    video_stream_ = av_find_best_stream(format_, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+    if (video_stream_ < 0) {
+        NN_LOG_ERROR("sw decoder: no video stream in %s", url.c_str());
+        release();
+        return false;
+    }
+    const AVCodecParameters *codec_params = format_->streams[video_stream_]->codecpar;
+    if (!openCodec(codec_params->codec_id, codec_params)) {
+        release();
+        return false;
+    }
+    thread_ = std::thread(&SwDecoder::urlLoop, this);
+    return true;
+}
+
+void SwDecoder::close() {
+    stop_ = true;
+    queue_cv_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        queue_.clear();
+        free_chunks_.clear();
+        queued_bytes_ = 0;
+    }
+    release();
+}
+
+void SwDecoder::release() {
+    if (parser_ != nullptr) {
+        av_parser_close(parser_);
+        parser_ = nullptr;
+    }
+    avcodec_free_context(&codec_);
+    if (format_ != nullptr) {
+        avformat_close_input(&format_);
+    }
+    video_stream_ = -1;
+    av_packet_free(&packet_);
+    av_frame_free(&frame_);
+    sws_freeContext(sws_);
+    sws_ = nullptr;
+}
+
+void SwDecoder::psLoop() {
+    Chunk chunk;
+    while (!stop_) {
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex_);
+            if (chunk.data.capacity() > 0 && free_chunks_.size() < kMaxFreeChunks) {
+                free_chunks_.push_back(std::move(chunk));
+            }
+            queue_cv_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+            if (stop_) break;
+            chunk = std::move(queue_.front());
+            queue_.pop_front();
+            queued_bytes_ -= chunk.data.size();
+        }
+
+        if (codec_ == nullptr) {
+            // 等到能确定编码格式的关键帧再创建解码器
+            if (chunk.codec == PsDemuxer::CODEC_UNKNOWN || !chunk.key) continue;
+            AVCodecID id = chunk.codec == PsDemuxer::CODEC_H265 ? AV_CODEC_ID_HEVC : AV_CODEC_ID_H264;
+            if (!openCodec(id, nullptr)) {
+                avcodec_free_context(&codec_);
+                finished_ = true;
+                break;
+            }
+        }
+
+        // 解析器把 PES 负载拼接/切分成完整的帧，PES 时间戳为 90kHz
+        const uint8_t *data = chunk.data.data();
+        int size = (int)chunk.data.size();
+        int64_t pts = chunk.pts >= 0 ? chunk.pts : AV_NOPTS_VALUE;
+        while (size > 0 && !stop_) {
+            uint8_t *out = nullptr;
+            int out_size = 0;
+            int used = av_parser_parse2(parser_, codec_, &out, &out_size, data, size, pts, pts, 0);
+            if (used < 0) break;
+            data += used;
+            size -= used;
+            pts = AV_NOPTS_VALUE;
+            if (out_size > 0) {
+                packet_->data = out;
+                packet_->size = out_size;
+                packet_->flags = parser_->key_frame == 1 ? AV_PKT_FLAG_KEY : 0;
+                decodePacket(packet_, parser_->pts == AV_NOPTS_VALUE ? -1 : parser_->pts / 90);
+            }
+        }
+    }
+}
+
+void SwDecoder::urlLoop() {
+    const AVStream *stream = format_->streams[video_stream_];
+    const AVRational ms = {1, 1000};
+    while (!stop_) {
+        if (av_read_frame(format_, packet_) < 0) break;
+        if (packet_->stream_index == video_stream_) {
+            int64_t ts = packet_->pts != AV_NOPTS_VALUE ? packet_->pts : packet_->dts;
+            decodePacket(packet_, ts == AV_NOPTS_VALUE ? -1 : av_rescale_q(ts, stream->time_base, ms));
+        }
+        av_packet_unref(packet_);
+    }
+    if (!stop_) {
+        // 取出解码器中缓存的最后几帧
+        avcodec_send_packet(codec_, nullptr);
+        receiveFrames();
+    }
+    finished_ = true;
+}
+
+void SwDecoder::decodePacket(AVPacket *packet, int64_t stamp_ms) {
+    // 只解关键帧时非关键帧不送入解码器；切换回来后也要等到关键帧，否则参考帧缺失
+    bool key = (packet->flags & AV_PKT_FLAG_KEY) != 0;
+    if (!key && (key_only_ || need_key_)) {
+        need_key_ = true;
+        return;
+    }
+    need_key_ = false;
+
+    // pts 换成送入序号，输出帧时按序号找回流时间戳和送入时间（B 帧重排后也能对应）
+    Pending &pending = pending_[packet_seq_ % kPendingSize];
+    pending.stamp_ms = stamp_ms;
+    pending.sent = std::chrono::steady_clock::now();
+    packet->pts = packet_seq_++;
+    packet->dts = AV_NOPTS_VALUE;
+
+    int ret;
+    while ((ret = avcodec_send_packet(codec_, packet)) == AVERROR(EAGAIN)) {
+        receiveFrames();
+    }
+    if (ret < 0) {
+        // 损坏的数据直接跳过，解码器会在后面的帧中恢复
+        return;
+    }
+    receiveFrames();
+}
+
+void SwDecoder::receiveFrames() {
+    while (avcodec_receive_frame(codec_, frame_) == 0) {
+        int64_t stamp_ms = -1;
+        double decode_ms = 0;
+        int64_t seq = frame_->pts;
+        if (seq != AV_NOPTS_VALUE && seq < packet_seq_ && packet_seq_ - seq <= kPendingSize) {
+            const Pending &pending = pending_[seq % kPendingSize];
+            stamp_ms = pending.stamp_ms;
+            decode_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - pending.sent).count();
+        }
+        outputFrame(frame_, stamp_ms, decode_ms);
+        av_frame_unref(frame_);
+    }
+}
+
+void SwDecoder::outputFrame(AVFrame *frame, int64_t stamp_ms, double decode_ms) {
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        stats_.frames++;
+        stats_.max_decode_ms = std::max(stats_.max_decode_ms, decode_ms);
+        total_decode_ms_ += decode_ms;
+    }
+
+    const uint32_t stamp = stamp_ms >= 0 ? (uint32_t)stamp_ms : 0;
+    if (filter_ && !filter_(stamp)) {
+        return;
+    }
+
+    // 输出分辨率：只给一边时按比例计算另一边；I420 要求偶数尺寸
+    int width = params_.out_width > 0 ? params_.out_width : frame->width;
+    int height = params_.out_height > 0 ? params_.out_height : frame->height;
+    if (params_.out_width > 0 && params_.out_height <= 0) {
+        height = (int)((int64_t)frame->height * width / frame->width);
+    } else if (params_.out_height > 0 && params_.out_width <= 0) {
+        width = (int)((int64_t)frame->width * height / frame->height);
+    }
+    width = std::max(2, width & ~1);
+    height = std::max(2, height & ~1);
+
+    // 缩放和格式转换一次完成，直接写入复用的缓冲区
+    sws_ = sws_getCachedContext(sws_, frame->width, frame->height, (AVPixelFormat)frame->format, width, height,
+                                AV_PIX_FMT_YUV420P, SWS_FAST_BILINEAR, nullptr, nullptr, nullptr);
+    if (sws_ == nullptr) {
+        return;
+    }
+    const size_t luma = (size_t)width * height;
+    out_buffer_.resize(luma * 3 / 2);
+    uint8_t *dst[4] = {out_buffer_.data(), out_buffer_.data() + luma, out_buffer_.data() + luma + luma / 4, nullptr};
+    int dst_stride[4] = {width, width / 2, width / 2, 0};
+    sws_scale(sws_, frame->data, frame->linesize, 0, frame->height, dst, dst_stride);
+
+    Frame out;
+    out.data = out_buffer_.data();
+    out.width = width;
+    out.height = height;
+    out.stamp_ms = stamp;
+    out.decode_ms = decode_ms;
+    callback_(out);
+}
+
+SwDecoder::Stats SwDecoder::takeStats() {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    Stats stats = stats_;
+    stats.avg_decode_ms = stats.frames > 0 ? total_decode_ms_ / stats.frames : 0;
+    stats.dropped_bytes = dropped_bytes_.exchange(0);
+    stats_ = Stats();
+    total_decode_ms_ = 0;
+    return stats;
+}
@@ -0,0 +1,145 @@
+// 软件解码后端（FFmpeg）：替代 PlayM4，支持海康 PS 流、RTSP 和视频文件
+// 可跳过非参考帧，解码后直接缩放到复用的 I420 缓冲区，并统计每帧解码耗时
+
+#ifndef RK3588_DEMO_SW_DECODER_H
+#define RK3588_DEMO_SW_DECODER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ps_demuxer.h"
+
+struct AVCodecContext;
+struct AVCodecParameters;
+struct AVCodecParserContext;
+struct AVFormatContext;
+struct AVFrame;
+struct AVPacket;
+struct SwsContext;
+
+class SwDecoder {
+public:
+    struct Params {
+        int threads = 2;            // 每路解码线程数
+        int out_width = 0;          // 输出分辨率，0 为原始分辨率
+        int out_height = 0;
+        bool skip_nonref = true;    // 跳过非参考帧（不影响后续帧的解码）
+        size_t queue_bytes = 4 * 1024 * 1024;  // PS 输入队列上限，超过后丢弃到下一个关键帧
+    };
+
+    // 连续的 I420 数据（Y、U、V 平面依次排列），只在回调期间有效
+    struct Frame {
+        const uint8_t *data;
+        int width;
+        int height;
+        uint32_t stamp_ms;  // 流时间戳（毫秒）
+        double decode_ms;   // 从送入解码器到输出该帧的耗时
+    };
+
+    // filter 在颜色空间转换/缩放之前调用，返回 false 的帧直接丢弃；可以为空
+    using FrameFilter = std::function<bool(uint32_t stamp_ms)>;
+    using FrameCallback = std::function<void(const Frame &frame)>;
+
+    struct Stats {
+        int frames = 0;            // 解码输出的帧数
+        size_t dropped_bytes = 0;  // 输入队列溢出丢弃的字节数
+        double avg_decode_ms = 0;
+        double max_decode_ms = 0;
+    };
+
+    SwDecoder() = default;
+    ~SwDecoder();
+    SwDecoder(const SwDecoder &) = delete;
+    SwDecoder &operator=(const SwDecoder &) = delete;
+
+    // 海康 PS 流：数据由 feedPs 送入，在内部线程中解码
+    bool openPs(const Params &params, FrameCallback callback, FrameFilter filter = nullptr);
+    // 在 SDK 回调线程中调用，只做解复用和入队
+    void feedPs(const uint8_t *data, size_t size);
+
+    // RTSP 地址或视频文件，在内部线程中读取和解码
+    bool openUrl(const std::string &url, const Params &params, FrameCallback callback, FrameFilter filter = nullptr);
+
+    void close();
+    // 文件读完或网络流断开
+    bool finished() const { return finished_; }
+
+    // 只解码关键帧（静止画面、iframe 解码策略），可在任意线程中切换
+    void setKeyFramesOnly(bool on) { key_only_ = on; }
+
+    // 取出并清零统计
+    Stats takeStats();
+
+private:
+    struct Chunk {
+        std::vector<uint8_t> data;
+        int64_t pts;
+        bool key;
+        int codec;  // PsDemuxer::Codec
+    };
+
+    bool openCodec(int codec_id, const AVCodecParameters *codec_params);
+    void psLoop();
+    void urlLoop();
+    // 送入一个完整的压缩帧并取出所有已解码的帧；stamp_ms 为流时间戳（毫秒）
+    void decodePacket(AVPacket *packet, int64_t stamp_ms);
+    void receiveFrames();
+    void outputFrame(AVFrame *frame, int64_t stamp_ms, double decode_ms);
+    void release();
+    static int interruptCallback(void *opaque);
+
+    Params params_;
+    FrameCallback callback_;
+    FrameFilter filter_;
+
+    // PS 输入：SDK 回调线程 -> 解码线程
+    PsDemuxer demuxer_;
+    std::mutex queue_mutex_;
+    std::condition_variable queue_cv_;
+    std::deque<Chunk> queue_;
+    std::vector<Chunk> free_chunks_;
+    size_t queued_bytes_ = 0;
+    bool wait_key_ = false;
+    std::atomic<size_t> dropped_bytes_{0};
+
+    std::string url_;
+    std::thread thread_;
+    std::atomic<bool> stop_{false};
+    std::atomic<bool> finished_{false};
+    std::atomic<bool> key_only_{false};
+
+    AVFormatContext *format_ = nullptr;
+    int video_stream_ = -1;
+    AVCodecContext *codec_ = nullptr;
+    AVCodecParserContext *parser_ = nullptr;
+    AVPacket *packet_ = nullptr;
+    AVFrame *frame_ = nullptr;
+    SwsContext *sws_ = nullptr;
+    bool need_key_ = true;  // 跳过关键帧之前的帧（开始解码、只解关键帧切换回来时）
+    std::vector<uint8_t> out_buffer_;  // 复用的输出缓冲区
+
+    // 按送入顺序编号，解码器输出时按编号找回时间戳和送入时间
+    static const int kPendingSize = 64;
+    struct Pending {
+        int64_t stamp_ms;
+        std::chrono::steady_clock::time_point sent;
+    };
+    Pending pending_[kPendingSize];
+    int64_t packet_seq_ = 0;
+
+    std::mutex stats_mutex_;
+    Stats stats_;
+    double total_decode_ms_ = 0;
+};
+
+#endif // RK3588_DEMO_SW_DECODER_H
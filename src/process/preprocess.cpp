@@ -2,172 +2,138 @@
 
 #include "preprocess.h"
 
+#include <cmath>
+#include <map>
+#include <mutex>
+#include <utility>
+
 #include "utils/logging.h"
-#include "im2d.h"
-#include "rga.h"
 
-// opencv 版本的 letterbox
-LetterBoxInfo letterbox(const cv::Mat &img, cv::Mat &img_letterbox, float wh_ratio)
+/*
+ * 原图直接缩放进模型输入，不再先在原分辨率上补边再整体缩小
+                                    dst (模型输入)
+                            ----------------------------
+                            |          pad_y           |
+        --------------      |      --------------      |
+        |            |      |pad_x |            |pad_x |
+        |  src_image |  =>  |      |  resized   |      |
+        |            |      |      |            |      |
+        --------------      |      --------------      |
+                            |          pad_y           |
+                            ----------------------------
+ */
+LetterBoxInfo compute_letterbox(cv::Size src_size, cv::Size dst_size)
 {
-
-    // img has to be 3 channels
-    if (img.channels() != 3)
-    {
-        NN_LOG_ERROR("img has to be 3 channels");
-        exit(-1);
-    }
-    float img_width = img.cols;
-    float img_height = img.rows;
-
-    int letterbox_width = 0;
-    int letterbox_height = 0;
+    float scale = std::min((float)dst_size.width / src_size.width, (float)dst_size.height / src_size.height);
 
     LetterBoxInfo info;
-    int padding_hor = 0;
-    int padding_ver = 0;
-
-    if (img_width / img_height > wh_ratio)
-    {
-        info.hor = false;
-        letterbox_width = img_width;
-        letterbox_height = img_width / wh_ratio;
-        info.pad = (letterbox_height - img_height) / 2.f;
-        padding_hor = 0;
-        padding_ver = info.pad;
-    }
-    else
-    {
-        info.hor = true;
-        letterbox_width = img_height * wh_ratio;
-        letterbox_height = img_height;
-        info.pad = (letterbox_width - img_width) / 2.f;
-        padding_hor = info.pad;
-        padding_ver = 0;
-    }
-    /*
-     * Padding an image.
-                                    dst_img
-        --------------      ----------------------------
-        |            |      |       top_border         |
-        |  src_image |  =>  |                          |
-        |            |      |      --------------      |
-        --------------      |left_ |            |right_|
-                            |border|  dst_rect  |border|
-                            |      |            |      |
-                            |      --------------      |
-                            |       bottom_border      |
-                            ----------------------------
-     */
-    // 使用cv::copyMakeBorder函数进行填充边界
-    cv::copyMakeBorder(img, img_letterbox, padding_ver, padding_ver, padding_hor, padding_hor, cv::BORDER_CONSTANT, cv::Scalar(0, 0, 0));
+    info.resized_w = std::max(1, std::min(dst_size.width, (int)std::round(src_size.width * scale)));
+    info.resized_h = std::max(1, std::min(dst_size.height, (int)std::round(src_size.height * scale)));
+    info.scale_x = (float)info.resized_w / src_size.width;
+    info.scale_y = (float)info.resized_h / src_size.height;
+    info.pad_x = (dst_size.width - info.resized_w) / 2;
+    info.pad_y = (dst_size.height - info.resized_h) / 2;
     return info;
 }
 
-// opencv resize
-void cvimg2tensor(const cv::Mat &img, uint32_t width, uint32_t height, tensor_data_s &tensor)
+// 按 cv::resize(INTER_LINEAR) 的坐标对齐方式生成插值表
+static void build_linear_table(int src_len, int dst_len, int elem_size, std::vector<int> &ofs, std::vector<uint16_t> &w)
 {
-    // img has to be 3 channels
-    if (img.channels() != 3)
+    ofs.resize(dst_len * 2);
+    w.resize(dst_len * 2);
+    float inv_scale = (float)src_len / dst_len;
+    for (int i = 0; i < dst_len; i++)
     {
-        NN_LOG_ERROR("img has to be 3 channels");
-        exit(-1);
+        float f = (i + 0.5f) * inv_scale - 0.5f;
+        int i0 = (int)std::floor(f);
+        f -= i0;
+        if (i0 < 0)
+        {
+            i0 = 0;
+            f = 0.f;
+        }
+        if (i0 >= src_len - 1)
+        {
+            i0 = src_len - 1;
+            f = 0.f;
+        }
+        int i1 = std::min(i0 + 1, src_len - 1);
+        ofs[i * 2 + 0] = i0 * elem_size;
+        ofs[i * 2 + 1] = i1 * elem_size;
+        w[i * 2 + 1] = (uint16_t)(f * 256.f + 0.5f);
+        w[i * 2 + 0] = 256 - w[i * 2 + 1];
     }
-    // BGR to RGB
-    cv::Mat img_rgb;
-    cv::cvtColor(img, img_rgb, cv::COLOR_BGR2RGB);
-    // resize img
-    cv::Mat img_resized;
-    // resize img
-    cv::resize(img_rgb, img_resized, cv::Size(width, height), 0, 0, cv::INTER_LINEAR);
-    // BGR to RGB
-    memcpy(tensor.data, img_resized.data, tensor.attr.size);
 }
 
-// rga 版本的 resize
-void cvimg2tensor_rga(const cv::Mat &img, uint32_t width, uint32_t height, tensor_data_s &tensor)
+std::shared_ptr<const LetterBoxGeometry> get_letterbox_geometry(cv::Size src_size, cv::Size dst_size)
 {
-    // img has to be 3 channels
-    if (img.channels() != 3)
+    static std::mutex cache_mutex;
+    static std::map<std::pair<std::pair<int, int>, std::pair<int, int>>, std::shared_ptr<const LetterBoxGeometry>> cache;
+
+    auto key = std::make_pair(std::make_pair(src_size.width, src_size.height), std::make_pair(dst_size.width, dst_size.height));
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    auto it = cache.find(key);
+    if (it != cache.end())
     {
-        NN_LOG_ERROR("img has to be 3 channels");
-        exit(-1);
+        return it->second;
     }
 
-    cv::Mat img_rgb;
-    cv::cvtColor(img, img_rgb, cv::COLOR_BGR2RGB);
+    auto geometry = std::make_shared<LetterBoxGeometry>();
+    geometry->src_size = src_size;
+    geometry->dst_size = dst_size;
+    geometry->info = compute_letterbox(src_size, dst_size);
+    build_linear_table(src_size.width, geometry->info.resized_w, 3, geometry->xofs, geometry->xw);
+    build_linear_table(src_size.height, geometry->info.resized_h, 1, geometry->yofs, geometry->yw);
+    NN_LOG_INFO("letterbox %dx%d -> %dx%d: content %dx%d at (%d, %d)", src_size.width, src_size.height,
+                dst_size.width, dst_size.height, geometry->info.resized_w, geometry->info.resized_h,
+                geometry->info.pad_x, geometry->info.pad_y);
+
+    cache[key] = geometry;
+    return geometry;
+}
 
-    im_rect src_rect;
-    im_rect dst_rect;
-    memset(&src_rect, 0, sizeof(src_rect));
-    memset(&dst_rect, 0, sizeof(dst_rect));
-    rga_buffer_t src = wrapbuffer_virtualaddr((void *)img_rgb.data, img.cols, img.rows, RK_FORMAT_RGB_888);
-    rga_buffer_t dst = wrapbuffer_virtualaddr((void *)tensor.data, width, height, RK_FORMAT_RGB_888);
-    int ret = imcheck(src, dst, src_rect, dst_rect);
-    if (IM_STATUS_NOERROR != ret)
-    {
-        NN_LOG_ERROR("%d, check error! %s", __LINE__, imStrError((IM_STATUS)ret));
-        exit(-1);
-    }
-    imresize(src, dst);
+cv::Rect LetterBoxGeometry::Decode(float xmin, float ymin, float xmax, float ymax) const
+{
+    float x0 = (xmin - info.pad_x) / info.scale_x;
+    float y0 = (ymin - info.pad_y) / info.scale_y;
+    float x1 = (xmax - info.pad_x) / info.scale_x;
+    float y1 = (ymax - info.pad_y) / info.scale_y;
+
+    int left = std::max(0, std::min((int)(x0 + 0.5f), src_size.width - 1));
+    int top = std::max(0, std::min((int)(y0 + 0.5f), src_size.height - 1));
+    int right = std::max(0, std::min((int)(x1 + 0.5f), src_size.width - 1));
+    int bottom = std::max(0, std::min((int)(y1 + 0.5f), src_size.height - 1));
+    return cv::Rect(left, top, right - left, bottom - top);
 }
 
-// rga 版本的 letterbox
-LetterBoxInfo letterbox_rga(const cv::Mat &img, cv::Mat &img_letterbox, float wh_ratio)
+void letterbox_fill_pad(const LetterBoxInfo &info, cv::Mat &dst)
 {
-    // img has to be 3 channels
-    if (img.channels() != 3)
+    const cv::Scalar black(0, 0, 0);
+    if (info.pad_y > 0)
     {
-        NN_LOG_ERROR("img has to be 3 channels");
-        exit(-1);
+        dst(cv::Rect(0, 0, dst.cols, info.pad_y)).setTo(black);
     }
-    float img_width = img.cols;
-    float img_height = img.rows;
-
-    int letterbox_width = 0;
-    int letterbox_height = 0;
-
-    LetterBoxInfo info;
-    int padding_hor = 0;
-    int padding_ver = 0;
-
-    if (img_width / img_height > wh_ratio)
+    int bottom = info.pad_y + info.resized_h;
+    if (bottom < dst.rows)
     {
-        info.hor = false;
-        letterbox_width = img_width;
-        letterbox_height = img_width / wh_ratio;
-        info.pad = (letterbox_height - img_height) / 2.f;
-        padding_hor = 0;
-        padding_ver = info.pad;
+        dst(cv::Rect(0, bottom, dst.cols, dst.rows - bottom)).setTo(black);
     }
-    else
+    if (info.pad_x > 0)
     {
-        info.hor = true;
-        letterbox_width = img_height * wh_ratio;
-        letterbox_height = img_height;
-        info.pad = (letterbox_width - img_width) / 2.f;
-        padding_hor = info.pad;
-        padding_ver = 0;
+        dst(cv::Rect(0, info.pad_y, info.pad_x, info.resized_h)).setTo(black);
     }
-    // rga add border
-    img_letterbox = cv::Mat::zeros(letterbox_height, letterbox_width, CV_8UC3);
-
-    im_rect src_rect;
-    im_rect dst_rect;
-    memset(&src_rect, 0, sizeof(src_rect));
-    memset(&dst_rect, 0, sizeof(dst_rect));
-
-    // NN_LOG_INFO("img size: %d, %d", img.cols, img.rows);
-
-    rga_buffer_t src = wrapbuffer_virtualaddr((void *)img.data, img.cols, img.rows, RK_FORMAT_RGB_888);
-    rga_buffer_t dst = wrapbuffer_virtualaddr((void *)img_letterbox.data, img_letterbox.cols, img_letterbox.rows, RK_FORMAT_RGB_888);
-    int ret = imcheck(src, dst, src_rect, dst_rect);
-    if (IM_STATUS_NOERROR != ret)
+    int right = info.pad_x + info.resized_w;
+    if (right < dst.cols)
     {
-        NN_LOG_ERROR("%d, check error! %s", __LINE__, imStrError((IM_STATUS)ret));
-        exit(-1);
+        dst(cv::Rect(right, info.pad_y, dst.cols - right, info.resized_h)).setTo(black);
     }
+}
 
-    immakeBorder(src, dst, padding_ver, padding_ver, padding_hor, padding_hor, 0, 0, 0);
-
-    return info;
-}
\ No newline at end of file
+// opencv 版本的 letterbox：resize 直接写入 dst 的内部区域，再原地 BGR->RGB
+void letterbox_resize(const cv::Mat &img, const LetterBoxInfo &info, cv::Mat &dst)
+{
+    cv::Mat content = dst(cv::Rect(info.pad_x, info.pad_y, info.resized_w, info.resized_h));
+    cv::resize(img, content, content.size(), 0, 0, cv::INTER_LINEAR);
+    cv::cvtColor(content, content, cv::COLOR_BGR2RGB);
+    letterbox_fill_pad(info, dst);
+}
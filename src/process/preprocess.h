@@ -3,18 +3,45 @@
 #ifndef RK3588_DEMO_PREPROCESS_H
 #define RK3588_DEMO_PREPROCESS_H
 
+#include <memory>
+#include <vector>
+
 #include <opencv2/opencv.hpp>
 #include "types/datatype.h"
 
+// 原图直接缩放进模型输入的内部区域，四周填充黑边
 struct LetterBoxInfo
 {
-    bool hor;
-    int pad;
+    float scale_x; // 原图 -> 模型输入的实际缩放比例（宽、高分别取整后计算，保证映射精确）
+    float scale_y;
+    int pad_x;     // 图像内容在模型输入中的左边距
+    int pad_y;     // 上边距
+    int resized_w; // 图像内容缩放后的宽
+    int resized_h; // 图像内容缩放后的高
+};
+
+// 某一输入分辨率到模型分辨率的 letterbox 几何信息，每种输入分辨率只计算一次
+struct LetterBoxGeometry
+{
+    cv::Size src_size;
+    cv::Size dst_size;
+    LetterBoxInfo info;
+    // 双线性插值查表（融合预处理使用）：xofs 为源图列的字节偏移，yofs 为源图行号，权重为 Q8 定点
+    std::vector<int> xofs;
+    std::vector<uint16_t> xw;
+    std::vector<int> yofs;
+    std::vector<uint16_t> yw;
+
+    // 模型输入坐标（像素）映射回原图坐标
+    cv::Rect Decode(float xmin, float ymin, float xmax, float ymax) const;
 };
 
-LetterBoxInfo letterbox(const cv::Mat &img, cv::Mat &img_letterbox, float wh_ratio);
-LetterBoxInfo letterbox_rga(const cv::Mat& img, cv::Mat& img_letterbox, float wh_ratio);
-void cvimg2tensor(const cv::Mat &img, uint32_t width, uint32_t height, tensor_data_s &tensor);
-void cvimg2tensor_rga(const cv::Mat &img, uint32_t width, uint32_t height, tensor_data_s &tensor);
+LetterBoxInfo compute_letterbox(cv::Size src_size, cv::Size dst_size);
+// 取缓存的几何信息，没有时计算并缓存；返回的对象只读，可多线程共用
+std::shared_ptr<const LetterBoxGeometry> get_letterbox_geometry(cv::Size src_size, cv::Size dst_size);
+// 只填充 dst 中图像内容以外的上下（或左右）黑边
+void letterbox_fill_pad(const LetterBoxInfo &info, cv::Mat &dst);
+// opencv 版本：直接缩放到 dst 的内部区域并转换为 RGB
+void letterbox_resize(const cv::Mat &img, const LetterBoxInfo &info, cv::Mat &dst);
 
 #endif // RK3588_DEMO_PREPROCESS_H
@@ -0,0 +1,312 @@
+// 预处理后端的实现与注册表
+
+#include "preprocess_backend.h"
+
+#include <unistd.h>
+#include <string.h>
+
+#include <chrono>
+#include <cmath>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "utils/logging.h"
+#include "im2d.h"
+#include "rga.h"
+
+namespace
+{
+    // opencv 版本：cv::resize 直接写入模型输入的内部区域
+    class OpenCVPreprocess : public PreprocessBackend
+    {
+    public:
+        const char *Name() const override { return "opencv"; }
+        bool Available() const override { return true; }
+        nn_error_e Run(const cv::Mat &img, const LetterBoxGeometry &geometry, cv::Mat &dst) override
+        {
+            if (img.channels() != 3)
+            {
+                return NN_PREPROCESS_FAIL;
+            }
+            letterbox_resize(img, geometry.info, dst);
+            return NN_SUCCESS;
+        }
+    };
+
+    // 融合版本：用缓存的插值表直接从原图采样到模型输入，一次遍历完成缩放和 BGR->RGB
+    // 水平方向查表插值，垂直方向混合用 NEON 向量化（非 ARM 平台走标量）
+    class SimdPreprocess : public PreprocessBackend
+    {
+    public:
+        const char *Name() const override { return "simd"; }
+        bool Available() const override { return true; }
+        nn_error_e Run(const cv::Mat &img, const LetterBoxGeometry &geometry, cv::Mat &dst) override
+        {
+            if (img.channels() != 3 || img.depth() != CV_8U)
+            {
+                return NN_PREPROCESS_FAIL;
+            }
+            const LetterBoxInfo &info = geometry.info;
+            const int row_len = info.resized_w * 3;
+            std::vector<uint16_t> buf0(row_len), buf1(row_len);
+
+            int cached0 = -1, cached1 = -1;
+            for (int y = 0; y < info.resized_h; y++)
+            {
+                int y0 = geometry.yofs[y * 2 + 0];
+                int y1 = geometry.yofs[y * 2 + 1];
+                // 缩小倍数不大时相邻输出行会用到同一源行，复用已插值的结果
+                if (y0 == cached1)
+                {
+                    std::swap(buf0, buf1);
+                    std::swap(cached0, cached1);
+                }
+                if (y0 != cached0)
+                {
+                    HResize(img.ptr<uint8_t>(y0), geometry, buf0.data());
+                    cached0 = y0;
+                }
+                if (y1 != cached1)
+                {
+                    HResize(img.ptr<uint8_t>(y1), geometry, buf1.data());
+                    cached1 = y1;
+                }
+                uint8_t *out = dst.ptr<uint8_t>(info.pad_y + y) + info.pad_x * 3;
+                VBlend(buf0.data(), buf1.data(), geometry.yw[y * 2 + 0], geometry.yw[y * 2 + 1], out, row_len);
+            }
+            letterbox_fill_pad(info, dst);
+            return NN_SUCCESS;
+        }
+
+    private:
+        // 水平插值一行，输出 RGB 顺序的 Q8 定点值
+        static void HResize(const uint8_t *row, const LetterBoxGeometry &geometry, uint16_t *dst)
+        {
+            const int *xofs = geometry.xofs.data();
+            const uint16_t *xw = geometry.xw.data();
+            for (int x = 0; x < geometry.info.resized_w; x++)
+            {
+                const uint8_t *p0 = row + xofs[x * 2 + 0];
+                const uint8_t *p1 = row + xofs[x * 2 + 1];
+                uint16_t w0 = xw[x * 2 + 0];
+                uint16_t w1 = xw[x * 2 + 1];
+                dst[x * 3 + 0] = p0[2] * w0 + p1[2] * w1;
+                dst[x * 3 + 1] = p0[1] * w0 + p1[1] * w1;
+                dst[x * 3 + 2] = p0[0] * w0 + p1[0] * w1;
+            }
+        }
+
+        // 垂直方向混合两行，Q16 -> uint8
+        static void VBlend(const uint16_t *b0, const uint16_t *b1, uint32_t w0, uint32_t w1, uint8_t *out, int n)
+        {
+            int i = 0;
+#if defined(__ARM_NEON)
+            uint16x4_t w0v = vdup_n_u16((uint16_t)w0);
+            uint16x4_t w1v = vdup_n_u16((uint16_t)w1);
+            for (; i + 8 <= n; i += 8)
+            {
+                uint16x8_t a = vld1q_u16(b0 + i);
+                uint16x8_t b = vld1q_u16(b1 + i);
+                uint32x4_t lo = vmull_u16(vget_low_u16(a), w0v);
+                lo = vmlal_u16(lo, vget_low_u16(b), w1v);
+                uint32x4_t hi = vmull_u16(vget_high_u16(a), w0v);
+                hi = vmlal_u16(hi, vget_high_u16(b), w1v);
+                uint16x8_t r = vcombine_u16(vrshrn_n_u32(lo, 16), vrshrn_n_u32(hi, 16));
+                vst1_u8(out + i, vmovn_u16(r));
+            }
+#endif
+            for (; i < n; i++)
+            {
+                out[i] = (uint8_t)((b0[i] * w0 + b1[i] * w1 + (1 << 15)) >> 16);
+            }
+        }
+    };
+
+    // rga 版本：RGA 缩放（同时做 BGR->RGB）直接写入模型输入的内部区域，黑边由 CPU 填充
+    // 出错时返回错误码而不是退出，便于基准测试时探测
+    class RGAPreprocess : public PreprocessBackend
+    {
+    public:
+        const char *Name() const override { return "rga"; }
+        bool Available() const override { return access("/dev/rga", F_OK) == 0; }
+        nn_error_e Run(const cv::Mat &img, const LetterBoxGeometry &geometry, cv::Mat &dst) override
+        {
+            if (img.channels() != 3)
+            {
+                return NN_PREPROCESS_FAIL;
+            }
+            const LetterBoxInfo &info = geometry.info;
+            cv::Mat src_img = img.isContinuous() ? img : img.clone();
+
+            im_rect src_rect;
+            im_rect dst_rect;
+            memset(&src_rect, 0, sizeof(src_rect));
+            memset(&dst_rect, 0, sizeof(dst_rect));
+
+            rga_buffer_t src = wrapbuffer_virtualaddr((void *)src_img.data, src_img.cols, src_img.rows, RK_FORMAT_BGR_888);
+            // 目标指向内部区域的起点，行跨度为整个模型输入的宽
+            uint8_t *content = dst.ptr<uint8_t>(info.pad_y) + info.pad_x * 3;
+            rga_buffer_t out = wrapbuffer_virtualaddr((void *)content, info.resized_w, info.resized_h, RK_FORMAT_RGB_888,
+                                                      dst.cols, info.resized_h);
+            int ret = imcheck(src, out, src_rect, dst_rect);
+            if (IM_STATUS_NOERROR != ret)
+            {
+                NN_LOG_ERROR("%d, check error! %s", __LINE__, imStrError((IM_STATUS)ret));
+                return NN_PREPROCESS_FAIL;
+            }
+            if (imresize(src, out) != IM_STATUS_SUCCESS)
+            {
+                return NN_PREPROCESS_FAIL;
+            }
+            letterbox_fill_pad(info, dst);
+            return NN_SUCCESS;
+        }
+    };
+}
+
+std::shared_ptr<PreprocessBackend> CreateOpenCVPreprocess()
+{
+    return std::make_shared<OpenCVPreprocess>();
+}
+
+std::shared_ptr<PreprocessBackend> CreateSimdPreprocess()
+{
+    return std::make_shared<SimdPreprocess>();
+}
+
+std::shared_ptr<PreprocessBackend> CreateRGAPreprocess()
+{
+    return std::make_shared<RGAPreprocess>();
+}
+
+PreprocessRegistry::PreprocessRegistry()
+{
+    // 第一个注册的后端作为基准测试的参考结果
+    Register(CreateOpenCVPreprocess());
+    Register(CreateSimdPreprocess());
+    Register(CreateRGAPreprocess());
+}
+
+PreprocessRegistry &PreprocessRegistry::Instance()
+{
+    static PreprocessRegistry registry;
+    return registry;
+}
+
+void PreprocessRegistry::Register(const std::shared_ptr<PreprocessBackend> &backend)
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    backends_.push_back(backend);
+}
+
+std::shared_ptr<PreprocessBackend> PreprocessRegistry::Get(const std::string &name)
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    for (auto &backend : backends_)
+    {
+        if (name == backend->Name())
+        {
+            return backend;
+        }
+    }
+    return nullptr;
+}
+
+std::shared_ptr<PreprocessBackend> PreprocessRegistry::Select(cv::Size src_size, cv::Size dst_size, const std::string &preferred)
+{
+    if (!preferred.empty() && preferred != "auto")
+    {
+        auto backend = Get(preferred);
+        if (backend && backend->Available())
+        {
+            return backend;
+        }
+        NN_LOG_WARNING("preprocess backend %s not available, fall back to auto", preferred.c_str());
+    }
+
+    // 持锁做基准测试，避免多个线程同时测试互相干扰计时
+    std::lock_guard<std::mutex> lock(mtx_);
+    std::vector<int> key = {SizeBucket(src_size), dst_size.width, dst_size.height};
+    auto it = pinned_.find(key);
+    if (it != pinned_.end())
+    {
+        return it->second;
+    }
+    auto best = Benchmark(src_size, dst_size);
+    pinned_[key] = best;
+    return best;
+}
+
+// 输入像素数按半个 2 的幂分组（约 1.41 倍一组），同组尺寸的各后端耗时排序基本相同
+int PreprocessRegistry::SizeBucket(cv::Size src_size)
+{
+    double pixels = std::max(1.0, (double)src_size.width * src_size.height);
+    return (int)std::ceil(std::log2(pixels) * 2);
+}
+
+std::shared_ptr<PreprocessBackend> PreprocessRegistry::Benchmark(cv::Size src_size, cv::Size dst_size)
+{
+    const int warmup_runs = 2;
+    const int timed_runs = 10;
+    const double max_mean_diff = 2.0; // 与参考结果的平均绝对误差上限（各实现的定点取整略有差别）
+    const int width = src_size.width;
+    const int height = src_size.height;
+
+    cv::Mat frame(height, width, CV_8UC3);
+    cv::randu(frame, cv::Scalar::all(0), cv::Scalar::all(255));
+    auto geometry = get_letterbox_geometry(src_size, dst_size);
+
+    cv::Mat ref(dst_size, CV_8UC3);
+    cv::Mat out(dst_size, CV_8UC3);
+    backends_[0]->Run(frame, *geometry, ref);
+
+    std::shared_ptr<PreprocessBackend> best = backends_[0];
+    double best_ms = -1.0;
+    for (auto &backend : backends_)
+    {
+        if (!backend->Available())
+        {
+            NN_LOG_INFO("preprocess %dx%d: %s not available", width, height, backend->Name());
+            continue;
+        }
+
+        // 先写入非零值，确保黑边也被检查到
+        out.setTo(cv::Scalar::all(255));
+        bool ok = true;
+        for (int i = 0; i < warmup_runs && ok; i++)
+        {
+            ok = backend->Run(frame, *geometry, out) == NN_SUCCESS;
+        }
+        if (!ok)
+        {
+            NN_LOG_WARNING("preprocess %dx%d: %s failed", width, height, backend->Name());
+            continue;
+        }
+        double diff = cv::norm(ref, out, cv::NORM_L1) / ((double)ref.total() * ref.channels());
+        if (diff > max_mean_diff)
+        {
+            NN_LOG_WARNING("preprocess %dx%d: %s output mismatch, mean diff %.2f", width, height, backend->Name(), diff);
+            continue;
+        }
+
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < timed_runs; i++)
+        {
+            backend->Run(frame, *geometry, out);
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        double ms = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() / 1000.0 / timed_runs;
+        NN_LOG_INFO("preprocess %dx%d: %s %.2fms (mean diff %.2f)", width, height, backend->Name(), ms, diff);
+
+        if (best_ms < 0 || ms < best_ms)
+        {
+            best_ms = ms;
+            best = backend;
+        }
+    }
+
+    NN_LOG_INFO("preprocess %dx%d: pinned %s", width, height, best->Name());
+    return best;
+}
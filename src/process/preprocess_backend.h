@@ -0,0 +1,57 @@
+// 预处理后端：统一 letterbox + 缩放 + BGR->RGB 写入模型输入的接口，启动时按分辨率自动选择最快的实现
+
+#ifndef RK3588_DEMO_PREPROCESS_BACKEND_H
+#define RK3588_DEMO_PREPROCESS_BACKEND_H
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "types/error.h"
+#include "process/preprocess.h"
+
+class PreprocessBackend
+{
+public:
+    virtual ~PreprocessBackend(){};
+    virtual const char *Name() const = 0; // 后端名称，与配置文件中的 preprocess= 对应
+    virtual bool Available() const = 0;   // 当前设备上是否可用
+    // 把 BGR 图像按 geometry 缩放进 dst（模型分辨率，RGB，CV_8UC3）的内部区域并填充黑边；
+    // 需要可重入，多个推理线程共用一个实例
+    virtual nn_error_e Run(const cv::Mat &img, const LetterBoxGeometry &geometry, cv::Mat &dst) = 0;
+};
+
+std::shared_ptr<PreprocessBackend> CreateOpenCVPreprocess(); // letterbox + cv::resize
+std::shared_ptr<PreprocessBackend> CreateSimdPreprocess();   // 单次遍历完成 letterbox、缩放和通道交换
+std::shared_ptr<PreprocessBackend> CreateRGAPreprocess();    // RGA 硬件加速，仅在存在 /dev/rga 时可用
+
+class PreprocessRegistry
+{
+public:
+    static PreprocessRegistry &Instance();
+
+    void Register(const std::shared_ptr<PreprocessBackend> &backend);
+    std::shared_ptr<PreprocessBackend> Get(const std::string &name);
+
+    // 选择后端：preferred 为具体名称时直接使用（不可用则回退到自动选择）；
+    // 为 "auto" 时按 (模型输入尺寸, 输入像素数所在的半个 2 的幂区间) 分组，每组只在首次遇到时
+    // 对所有可用后端做一次基准测试，取结果正确且最快的一个并固定下来；ROI 裁剪和分块产生的各种尺寸不会各测一次
+    std::shared_ptr<PreprocessBackend> Select(cv::Size src_size, cv::Size dst_size, const std::string &preferred);
+
+private:
+    PreprocessRegistry();
+    std::shared_ptr<PreprocessBackend> Benchmark(cv::Size src_size, cv::Size dst_size);
+    static int SizeBucket(cv::Size src_size);
+
+    std::mutex mtx_;
+    std::vector<std::shared_ptr<PreprocessBackend>> backends_;
+    // key: (输入尺寸分组, 模型宽, 模型高)
+    std::map<std::vector<int>, std::shared_ptr<PreprocessBackend>> pinned_;
+};
+
+#endif // RK3588_DEMO_PREPROCESS_BACKEND_H
@@ -0,0 +1,320 @@
+// 输入张量打包
+
+#include "tensor_pack.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "utils/logging.h"
+
+tensor_pack_mode_e nn_tensor_pack_mode_from_string(const std::string &mode)
+{
+    if (mode == "layout")
+    {
+        return NN_PACK_LAYOUT;
+    }
+    if (mode == "native")
+    {
+        return NN_PACK_NATIVE;
+    }
+    if (mode != "runtime")
+    {
+        NN_LOG_WARNING("unknown input pack mode %s, use runtime", mode.c_str());
+    }
+    return NN_PACK_RUNTIME;
+}
+
+tensor_pack_param_s nn_tensor_pack_default_param()
+{
+    // yolov8 转换 rknn 时的默认 mean_values=[0,0,0] std_values=[255,255,255]
+    tensor_pack_param_s param;
+    param.mode = NN_PACK_RUNTIME;
+    for (int c = 0; c < 3; c++)
+    {
+        param.mean[c] = 0.f;
+        param.std[c] = 255.f;
+    }
+    return param;
+}
+
+// 生成量化参数：q = x * a + b，b 为整数且 a == 1 时可以走向量化的快速路径
+static void build_quant_plan(const tensor_attr_s &model_attr, const tensor_pack_param_s &param, tensor_pack_plan_s &plan)
+{
+    const bool is_signed = model_attr.type == NN_TENSOR_INT8;
+    const int q_min = is_signed ? -128 : 0;
+    const int q_max = is_signed ? 127 : 255;
+    const float scale = model_attr.scale > 0 ? model_attr.scale : 1.f;
+
+    plan.affine_identity = true;
+    for (int c = 0; c < 3; c++)
+    {
+        float a = 1.f / (param.std[c] * scale);
+        float b = model_attr.zp - param.mean[c] / (param.std[c] * scale);
+        int offset = (int)std::round(b);
+        if (std::fabs(a - 1.f) > 1e-3f || std::fabs(b - offset) > 1e-3f || (c > 0 && offset != plan.offset))
+        {
+            plan.affine_identity = false;
+        }
+        plan.offset = offset;
+        for (int x = 0; x < 256; x++)
+        {
+            int q = (int)std::round(x * a + b);
+            q = std::max(q_min, std::min(q, q_max));
+            plan.lut[c][x] = (uint8_t)(is_signed ? (uint8_t)(int8_t)q : q);
+        }
+    }
+}
+
+void nn_tensor_pack_prepare(const tensor_attr_s &model_attr, const tensor_pack_param_s &param,
+                            tensor_data_s &tensor, tensor_pack_plan_s &plan)
+{
+    if (model_attr.n_dims != 4)
+    {
+        NN_LOG_ERROR("unsupported input dims");
+        exit(-1);
+    }
+
+    uint32_t channels = 0;
+    if (model_attr.layout == NN_TENSOR_NCHW)
+    {
+        channels = model_attr.dims[1];
+        plan.height = model_attr.dims[2];
+        plan.width = model_attr.dims[3];
+    }
+    else if (model_attr.layout == NN_TENSOR_NHWC)
+    {
+        plan.height = model_attr.dims[1];
+        plan.width = model_attr.dims[2];
+        channels = model_attr.dims[3];
+    }
+    else
+    {
+        NN_LOG_ERROR("unsupported input layout");
+        exit(-1);
+    }
+    if (channels != 3)
+    {
+        NN_LOG_ERROR("unsupported input channels: %d", channels);
+        exit(-1);
+    }
+
+    plan.mode = param.mode;
+    if (plan.mode == NN_PACK_NATIVE && model_attr.type != NN_TENSOR_INT8 && model_attr.type != NN_TENSOR_UINT8 &&
+        model_attr.type != NN_TENSOR_FLOAT)
+    {
+        NN_LOG_WARNING("input type %d can not be packed natively, use layout mode", model_attr.type);
+        plan.mode = NN_PACK_LAYOUT;
+    }
+
+    tensor.attr.n_dims = 4;
+    tensor.attr.index = 0;
+    tensor.attr.zp = model_attr.zp;
+    tensor.attr.scale = model_attr.scale;
+    if (plan.mode == NN_PACK_RUNTIME)
+    {
+        tensor.attr.layout = NN_TENSOR_NHWC;
+        tensor.attr.type = NN_TENSOR_UINT8;
+        tensor.attr.dims[0] = model_attr.dims[0];
+        tensor.attr.dims[1] = plan.height;
+        tensor.attr.dims[2] = plan.width;
+        tensor.attr.dims[3] = channels;
+        tensor.attr.pass_through = false;
+    }
+    else
+    {
+        tensor.attr.layout = model_attr.layout;
+        tensor.attr.type = plan.mode == NN_PACK_NATIVE ? model_attr.type : NN_TENSOR_UINT8;
+        for (int i = 0; i < 4; i++)
+        {
+            tensor.attr.dims[i] = model_attr.dims[i];
+        }
+        tensor.attr.pass_through = plan.mode == NN_PACK_NATIVE;
+    }
+    tensor.attr.n_elems = tensor.attr.dims[0] * tensor.attr.dims[1] * tensor.attr.dims[2] * tensor.attr.dims[3];
+    tensor.attr.size = tensor.attr.n_elems * nn_tensor_type_to_size(tensor.attr.type);
+
+    plan.layout = tensor.attr.layout;
+    plan.type = tensor.attr.type;
+    plan.affine_identity = true;
+    plan.offset = 0;
+    for (int c = 0; c < 3; c++)
+    {
+        for (int x = 0; x < 256; x++)
+        {
+            plan.lut[c][x] = (uint8_t)x;
+        }
+        plan.alpha[c] = 1.f / param.std[c];
+        plan.beta[c] = -param.mean[c] / param.std[c];
+    }
+    if (plan.mode == NN_PACK_NATIVE && plan.type != NN_TENSOR_FLOAT)
+    {
+        build_quant_plan(model_attr, param, plan);
+    }
+
+    NN_LOG_INFO("input pack: mode=%d, layout=%s, type=%d, pass_through=%d, fast path=%d", plan.mode,
+                plan.layout == NN_TENSOR_NCHW ? "NCHW" : "NHWC", plan.type, tensor.attr.pass_through,
+                plan.affine_identity);
+}
+
+bool nn_tensor_pack_needed(const tensor_pack_plan_s &plan)
+{
+    return plan.mode != NN_PACK_RUNTIME;
+}
+
+// x + offset 并饱和到 int8 / uint8，HWC 布局不变
+static void pack_offset_hwc(const uint8_t *src, uint8_t *dst, int n, int32_t offset, bool is_signed)
+{
+    int i = 0;
+#if defined(__ARM_NEON)
+    int16x8_t off = vdupq_n_s16((int16_t)offset);
+    for (; i + 16 <= n; i += 16)
+    {
+        uint8x16_t x = vld1q_u8(src + i);
+        int16x8_t lo = vaddq_s16(vreinterpretq_s16_u16(vmovl_u8(vget_low_u8(x))), off);
+        int16x8_t hi = vaddq_s16(vreinterpretq_s16_u16(vmovl_u8(vget_high_u8(x))), off);
+        if (is_signed)
+        {
+            vst1q_s8((int8_t *)dst + i, vcombine_s8(vqmovn_s16(lo), vqmovn_s16(hi)));
+        }
+        else
+        {
+            vst1q_u8(dst + i, vcombine_u8(vqmovun_s16(lo), vqmovun_s16(hi)));
+        }
+    }
+#endif
+    const int q_min = is_signed ? -128 : 0;
+    const int q_max = is_signed ? 127 : 255;
+    for (; i < n; i++)
+    {
+        int q = std::max(q_min, std::min(src[i] + offset, q_max));
+        dst[i] = (uint8_t)q;
+    }
+}
+
+// HWC -> CHW 转置，同时 x + offset 并饱和
+static void pack_offset_chw(const uint8_t *src, uint8_t *dst, int pixels, int32_t offset, bool is_signed)
+{
+    uint8_t *plane0 = dst;
+    uint8_t *plane1 = dst + pixels;
+    uint8_t *plane2 = dst + pixels * 2;
+    int i = 0;
+#if defined(__ARM_NEON)
+    int16x8_t off = vdupq_n_s16((int16_t)offset);
+    for (; i + 16 <= pixels; i += 16)
+    {
+        uint8x16x3_t rgb = vld3q_u8(src + i * 3);
+        uint8_t *planes[3] = {plane0, plane1, plane2};
+        for (int c = 0; c < 3; c++)
+        {
+            if (offset == 0 && !is_signed)
+            {
+                vst1q_u8(planes[c] + i, rgb.val[c]);
+                continue;
+            }
+            int16x8_t lo = vaddq_s16(vreinterpretq_s16_u16(vmovl_u8(vget_low_u8(rgb.val[c]))), off);
+            int16x8_t hi = vaddq_s16(vreinterpretq_s16_u16(vmovl_u8(vget_high_u8(rgb.val[c]))), off);
+            if (is_signed)
+            {
+                vst1q_s8((int8_t *)planes[c] + i, vcombine_s8(vqmovn_s16(lo), vqmovn_s16(hi)));
+            }
+            else
+            {
+                vst1q_u8(planes[c] + i, vcombine_u8(vqmovun_s16(lo), vqmovun_s16(hi)));
+            }
+        }
+    }
+#endif
+    const int q_min = is_signed ? -128 : 0;
+    const int q_max = is_signed ? 127 : 255;
+    for (; i < pixels; i++)
+    {
+        plane0[i] = (uint8_t)std::max(q_min, std::min(src[i * 3 + 0] + offset, q_max));
+        plane1[i] = (uint8_t)std::max(q_min, std::min(src[i * 3 + 1] + offset, q_max));
+        plane2[i] = (uint8_t)std::max(q_min, std::min(src[i * 3 + 2] + offset, q_max));
+    }
+}
+
+// 一般情况：每通道查表量化
+static void pack_lut(const uint8_t *src, uint8_t *dst, int pixels, const tensor_pack_plan_s &plan)
+{
+    if (plan.layout == NN_TENSOR_NCHW)
+    {
+        for (int i = 0; i < pixels; i++)
+        {
+            dst[i] = plan.lut[0][src[i * 3 + 0]];
+            dst[i + pixels] = plan.lut[1][src[i * 3 + 1]];
+            dst[i + pixels * 2] = plan.lut[2][src[i * 3 + 2]];
+        }
+    }
+    else
+    {
+        for (int i = 0; i < pixels; i++)
+        {
+            dst[i * 3 + 0] = plan.lut[0][src[i * 3 + 0]];
+            dst[i * 3 + 1] = plan.lut[1][src[i * 3 + 1]];
+            dst[i * 3 + 2] = plan.lut[2][src[i * 3 + 2]];
+        }
+    }
+}
+
+// float 输入：归一化后写入
+static void pack_float(const uint8_t *src, float *dst, int pixels, const tensor_pack_plan_s &plan)
+{
+    for (int i = 0; i < pixels; i++)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            float v = src[i * 3 + c] * plan.alpha[c] + plan.beta[c];
+            if (plan.layout == NN_TENSOR_NCHW)
+            {
+                dst[i + pixels * c] = v;
+            }
+            else
+            {
+                dst[i * 3 + c] = v;
+            }
+        }
+    }
+}
+
+void nn_tensor_pack(const cv::Mat &rgb, const tensor_pack_plan_s &plan, tensor_data_s &tensor)
+{
+    if (!nn_tensor_pack_needed(plan))
+    {
+        return;
+    }
+    const cv::Mat src = rgb.isContinuous() ? rgb : rgb.clone();
+    const uint8_t *data = src.data;
+    const int pixels = plan.width * plan.height;
+    uint8_t *dst = (uint8_t *)tensor.data;
+
+    if (plan.type == NN_TENSOR_FLOAT)
+    {
+        pack_float(data, (float *)tensor.data, pixels, plan);
+        return;
+    }
+    if (!plan.affine_identity)
+    {
+        pack_lut(data, dst, pixels, plan);
+        return;
+    }
+    const bool is_signed = plan.type == NN_TENSOR_INT8;
+    if (plan.layout == NN_TENSOR_NCHW)
+    {
+        pack_offset_chw(data, dst, pixels, plan.offset, is_signed);
+    }
+    else if (plan.offset == 0 && !is_signed)
+    {
+        memcpy(dst, data, pixels * 3);
+    }
+    else
+    {
+        pack_offset_hwc(data, dst, pixels * 3, plan.offset, is_signed);
+    }
+}
@@ -0,0 +1,55 @@
+// 输入张量打包：把预处理得到的 RGB（HWC，uint8）图像按模型输入的布局/类型写入输入张量
+
+#ifndef RK3588_DEMO_TENSOR_PACK_H
+#define RK3588_DEMO_TENSOR_PACK_H
+
+#include <string>
+
+#include <opencv2/opencv.hpp>
+#include "types/datatype.h"
+
+typedef enum _tensor_pack_mode
+{
+    NN_PACK_RUNTIME = 0, // NHWC uint8 原样提交，布局和归一化/量化都交给 runtime（原有行为）
+    NN_PACK_LAYOUT = 1,  // 按模型原生布局（NCHW 时转置）提交 uint8，runtime 只做归一化/量化
+    NN_PACK_NATIVE = 2,  // 按模型原生布局和数据类型打包，CPU 端融合归一化+量化，pass_through 直接送入 NPU
+} tensor_pack_mode_e;
+
+// 打包参数：归一化为 (x - mean) / std，与模型转换时的 mean_values / std_values 一致
+typedef struct
+{
+    tensor_pack_mode_e mode;
+    float mean[3];
+    float std[3];
+} tensor_pack_param_s;
+
+// 打包计划：加载模型时根据输入属性生成一次，之后每帧直接使用
+typedef struct
+{
+    tensor_pack_mode_e mode;
+    tensor_layout_e layout;
+    tensor_datatype_e type;
+    uint32_t width;
+    uint32_t height;
+    bool affine_identity;  // 归一化+量化后恰好是 x + offset（常见的 mean=0, std=255, scale=1/255）
+    int32_t offset;
+    uint8_t lut[3][256];   // 一般情况下每个通道的量化查找表（int8 按位存放）
+    float alpha[3];        // float 输入：x * alpha + beta
+    float beta[3];
+} tensor_pack_plan_s;
+
+tensor_pack_mode_e nn_tensor_pack_mode_from_string(const std::string &mode);
+tensor_pack_param_s nn_tensor_pack_default_param();
+
+// 根据模型输入属性生成要提交给 runtime 的输入张量描述（dims/layout/type/size/pass_through）和打包计划
+// 模型输入类型不支持所选模式时回退到 NN_PACK_RUNTIME
+void nn_tensor_pack_prepare(const tensor_attr_s &model_attr, const tensor_pack_param_s &param,
+                            tensor_data_s &tensor, tensor_pack_plan_s &plan);
+
+// 是否需要单独的打包步骤；NN_PACK_RUNTIME 时预处理直接写入张量内存，不需要打包
+bool nn_tensor_pack_needed(const tensor_pack_plan_s &plan);
+
+// 打包：rgb 为模型分辨率的 HWC uint8 图像
+void nn_tensor_pack(const cv::Mat &rgb, const tensor_pack_plan_s &plan, tensor_data_s &tensor);
+
+#endif // RK3588_DEMO_TENSOR_PACK_H
@@ -0,0 +1,385 @@
+#include "detection_history.h"
+
+#include <algorithm>
+
+#include "series_codec.h"
+#include "utils/logging.h"
+
+DetectionHistory::~DetectionHistory() {
+    close();
+}
+
+bool DetectionHistory::open(const std::string &db_path) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (db_) return true;
+    if (sqlite3_open_v2(db_path.c_str(), &db_, SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX, nullptr) != SQLITE_OK) {
+        NN_LOG_ERROR("detection history: open %s failed: %s", db_path.c_str(), sqlite3_errmsg(db_));
+        sqlite3_close(db_);
+        db_ = nullptr;
+        return false;
+    }
+    sqlite3_busy_timeout(db_, 1000);
+
+    bool ok = true;
+    for (int level = 0; level < kRollupLevels && ok; level++) {
+        std::string table = kRollupLevel[level].table;
+        // ?3 为空字符串时不按设备过滤；两条语句都是主键 (bucket, device) 上的范围扫描
+        std::string sum_sql = "SELECT max(max_count), sum(sum_count), sum(samples) FROM " + table +
+                              " WHERE bucket >= ?1 AND bucket < ?2 AND (?3 = '' OR device = ?3);";
+        std::string last_sql = "SELECT last_count, last_ms FROM " + table +
+                               " WHERE bucket = (SELECT max(bucket) FROM " + table +
+                               " WHERE bucket >= ?1 AND bucket < ?2 AND (?3 = '' OR device = ?3))"
+                               " AND (?3 = '' OR device = ?3) ORDER BY last_ms DESC LIMIT 1;";
+        ok = sqlite3_prepare_v2(db_, sum_sql.c_str(), -1, &sum_stmt_[level], nullptr) == SQLITE_OK &&
+             sqlite3_prepare_v2(db_, last_sql.c_str(), -1, &last_stmt_[level], nullptr) == SQLITE_OK;
+    }
+    // 原始记录上的统计只读 (ts, box_count) / (device, ts, box_count) 索引
+    ok = ok &&
+         sqlite3_prepare_v2(db_, "SELECT max(box_count), sum(box_count), count(*) FROM detection_results"
+                                 " WHERE ts >= ?1 AND ts < ?2;", -1, &raw_sum_stmt_[0], nullptr) == SQLITE_OK &&
+         sqlite3_prepare_v2(db_, "SELECT max(box_count), sum(box_count), count(*) FROM detection_results"
+                                 " WHERE device = ?3 AND ts >= ?1 AND ts < ?2;", -1, &raw_sum_stmt_[1], nullptr) == SQLITE_OK &&
+         sqlite3_prepare_v2(db_, "SELECT box_count, ts FROM detection_results"
+                                 " WHERE ts >= ?1 AND ts < ?2 ORDER BY ts DESC LIMIT 1;", -1, &raw_last_stmt_[0], nullptr) == SQLITE_OK &&
+         sqlite3_prepare_v2(db_, "SELECT box_count, ts FROM detection_results"
+                                 " WHERE device = ?3 AND ts >= ?1 AND ts < ?2 ORDER BY ts DESC LIMIT 1;", -1, &raw_last_stmt_[1], nullptr) == SQLITE_OK &&
+         sqlite3_prepare_v2(db_, "SELECT device, timestamp, box_count FROM detection_results"
+                                 " WHERE id >= ?1 AND id < ?2 AND ts IS NULL;", -1, &pending_stmt_, nullptr) == SQLITE_OK &&
+         sqlite3_prepare_v2(db_, "SELECT key, value FROM storage_meta WHERE key IN"
+                                 " ('ts_migrate_next', 'ts_migrate_end', 'rollup_backfill_next', 'rollup_backfill_end');",
+                            -1, &progress_stmt_, nullptr) == SQLITE_OK &&
+         sqlite3_prepare_v2(db_, "SELECT start_ms, end_ms, value FROM detection_spans"
+                                 " WHERE device = ?1 AND start_ms <= ?2 ORDER BY start_ms DESC LIMIT 1;",
+                            -1, &span_at_stmt_, nullptr) == SQLITE_OK &&
+         // 区间互不重叠，与范围相交的区间从起点不晚于 ?2 的最后一个区间开始，全部在主键上扫描
+         sqlite3_prepare_v2(db_, "SELECT start_ms, end_ms, value FROM detection_spans WHERE device = ?1 AND start_ms >="
+                                 " coalesce((SELECT max(start_ms) FROM detection_spans WHERE device = ?1 AND start_ms <= ?2), ?2)"
+                                 " AND start_ms < ?3 ORDER BY start_ms;", -1, &span_range_stmt_, nullptr) == SQLITE_OK &&
+         // 压缩块：完全在范围内的块不取 data；同一设备的块互不重叠，与查询区间相同的取法
+         sqlite3_prepare_v2(db_, "SELECT start_ms, end_ms, resolution_ms, samples, sum_count, max_count, last_count,"
+                                 " CASE WHEN start_ms >= ?2 AND end_ms < ?3 THEN NULL ELSE data END"
+                                 " FROM detection_series WHERE end_ms >= ?2 AND start_ms < ?3;",
+                            -1, &series_stmt_[0], nullptr) == SQLITE_OK &&
+         sqlite3_prepare_v2(db_, "SELECT start_ms, end_ms, resolution_ms, samples, sum_count, max_count, last_count,"
+                                 " CASE WHEN start_ms >= ?2 AND end_ms < ?3 THEN NULL ELSE data END"
+                                 " FROM detection_series WHERE device = ?1 AND start_ms >="
+                                 " coalesce((SELECT max(start_ms) FROM detection_series WHERE device = ?1 AND start_ms <= ?2), ?2)"
+                                 " AND start_ms < ?3 ORDER BY start_ms;", -1, &series_stmt_[1], nullptr) == SQLITE_OK;
+    if (!ok) {
+        // 写线程还没有建表时失败，下次查询再试
+        NN_LOG_WARNING("detection history: prepare failed: %s", sqlite3_errmsg(db_));
+        finalize();
+        return false;
+    }
+    return true;
+}
+
+void DetectionHistory::finalize() {
+    for (int level = 0; level < kRollupLevels; level++) {
+        sqlite3_finalize(sum_stmt_[level]);
+        sqlite3_finalize(last_stmt_[level]);
+        sum_stmt_[level] = last_stmt_[level] = nullptr;
+    }
+    for (int i = 0; i < 2; i++) {
+        sqlite3_finalize(raw_sum_stmt_[i]);
+        sqlite3_finalize(raw_last_stmt_[i]);
+        raw_sum_stmt_[i] = raw_last_stmt_[i] = nullptr;
+    }
+    sqlite3_finalize(pending_stmt_);
+    sqlite3_finalize(progress_stmt_);
+    sqlite3_finalize(span_at_stmt_);
+    sqlite3_finalize(span_range_stmt_);
+    pending_stmt_ = progress_stmt_ = span_at_stmt_ = span_range_stmt_ = nullptr;
+    for (int i = 0; i < 2; i++) {
+        sqlite3_finalize(series_stmt_[i]);
+        series_stmt_[i] = nullptr;
+    }
+    if (db_) {
+        sqlite3_close(db_);
+        db_ = nullptr;
+    }
+}
+
+void DetectionHistory::close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    finalize();
+}
+
+// 读取写线程的进度：汇总补建完成之前汇总表不完整，ts 迁移完成之前部分旧记录只有文本时间戳
+bool DetectionHistory::loadProgress() {
+    int64_t backfill_next = 0, backfill_end = 0;
+    migrate_next_ = migrate_end_ = 0;
+    int rc;
+    while ((rc = sqlite3_step(progress_stmt_)) == SQLITE_ROW) {
+        std::string key = (const char *)sqlite3_column_text(progress_stmt_, 0);
+        int64_t value = sqlite3_column_int64(progress_stmt_, 1);
+        if (key == "ts_migrate_next") migrate_next_ = value;
+        else if (key == "ts_migrate_end") migrate_end_ = value;
+        else if (key == "rollup_backfill_next") backfill_next = value;
+        else if (key == "rollup_backfill_end") backfill_end = value;
+    }
+    sqlite3_reset(progress_stmt_);
+    if (rc != SQLITE_DONE) {
+        NN_LOG_ERROR("detection history: read storage_meta failed: %s", sqlite3_errmsg(db_));
+        return false;
+    }
+    rollups_ready_ = backfill_next >= backfill_end;
+    return true;
+}
+
+bool DetectionHistory::queryLevel(int level, const std::string &device, int64_t from_s, int64_t to_s,
+                                  CountAggregate &out) {
+    CountAggregate part;
+    sqlite3_stmt *stmt = sum_stmt_[level];
+    sqlite3_bind_int64(stmt, 1, from_s);
+    sqlite3_bind_int64(stmt, 2, to_s);
+    sqlite3_bind_text(stmt, 3, device.c_str(), (int)device.size(), SQLITE_STATIC);
+    int rc = sqlite3_step(stmt);
+    if (rc == SQLITE_ROW && sqlite3_column_type(stmt, 2) != SQLITE_NULL) {
+        part.max = sqlite3_column_int(stmt, 0);
+        part.sum = sqlite3_column_int64(stmt, 1);
+        part.samples = sqlite3_column_int64(stmt, 2);
+    }
+    sqlite3_reset(stmt);
+    if (rc != SQLITE_ROW) {
+        NN_LOG_ERROR("detection history: query %s failed: %s", kRollupLevel[level].table, sqlite3_errmsg(db_));
+        return false;
+    }
+    if (part.samples == 0) return true;
+
+    stmt = last_stmt_[level];
+    sqlite3_bind_int64(stmt, 1, from_s);
+    sqlite3_bind_int64(stmt, 2, to_s);
+    sqlite3_bind_text(stmt, 3, device.c_str(), (int)device.size(), SQLITE_STATIC);
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        part.last = sqlite3_column_int(stmt, 0);
+        part.last_ms = sqlite3_column_int64(stmt, 1);
+    }
+    sqlite3_reset(stmt);
+    out.add(part);
+    return true;
+}
+
+// 把 [from_s, to_s) 拆成本级完整的桶和两端的零头，零头交给下一级更细的汇总表
+void DetectionHistory::collect(int level, const std::string &device, int64_t from_s, int64_t to_s,
+                               CountAggregate &out) {
+    if (from_s >= to_s) return;
+    if (level == 0) {
+        ok_ = queryLevel(0, device, from_s, to_s, out) && ok_;
+        return;
+    }
+    const int64_t size = kRollupLevel[level].seconds;
+    int64_t first = (from_s + size - 1) / size * size;
+    int64_t last = to_s / size * size;
+    if (first >= last) {
+        collect(level - 1, device, from_s, to_s, out);
+        return;
+    }
+    ok_ = queryLevel(level, device, first, last, out) && ok_;
+    collect(level - 1, device, from_s, first, out);
+    collect(level - 1, device, last, to_s, out);
+}
+
+bool DetectionHistory::queryRaw(const std::string &device, int64_t from_ms, int64_t to_ms, CountAggregate &out) {
+    const int which = device.empty() ? 0 : 1;
+    CountAggregate part;
+    sqlite3_stmt *stmt = raw_sum_stmt_[which];
+    sqlite3_bind_int64(stmt, 1, from_ms);
+    sqlite3_bind_int64(stmt, 2, to_ms);
+    if (which) sqlite3_bind_text(stmt, 3, device.c_str(), (int)device.size(), SQLITE_STATIC);
+    int rc = sqlite3_step(stmt);
+    if (rc == SQLITE_ROW && sqlite3_column_type(stmt, 0) != SQLITE_NULL) {
+        part.max = sqlite3_column_int(stmt, 0);
+        part.sum = sqlite3_column_int64(stmt, 1);
+        part.samples = sqlite3_column_int64(stmt, 2);
+    }
+    sqlite3_reset(stmt);
+    if (rc != SQLITE_ROW) {
+        NN_LOG_ERROR("detection history: query detection_results failed: %s", sqlite3_errmsg(db_));
+        return false;
+    }
+    if (part.samples == 0) return true;
+
+    stmt = raw_last_stmt_[which];
+    sqlite3_bind_int64(stmt, 1, from_ms);
+    sqlite3_bind_int64(stmt, 2, to_ms);
+    if (which) sqlite3_bind_text(stmt, 3, device.c_str(), (int)device.size(), SQLITE_STATIC);
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        part.last = sqlite3_column_int(stmt, 0);
+        part.last_ms = sqlite3_column_int64(stmt, 1);
+    }
+    sqlite3_reset(stmt);
+    out.add(part);
+    return true;
+}
+
+// 还没迁移的旧记录只在 [migrate_next, migrate_end) 的 id 范围内，逐行换算时间，范围随迁移很快缩小
+bool DetectionHistory::queryPending(const std::string &device, int64_t from_ms, int64_t to_ms, CountAggregate &out) {
+    if (migrate_next_ >= migrate_end_) return true;
+    sqlite3_bind_int64(pending_stmt_, 1, migrate_next_);
+    sqlite3_bind_int64(pending_stmt_, 2, migrate_end_);
+    int rc;
+    while ((rc = sqlite3_step(pending_stmt_)) == SQLITE_ROW) {
+        if (!device.empty() && device != (const char *)sqlite3_column_text(pending_stmt_, 0)) continue;
+        int64_t time_ms = parseLocalTimestamp((const char *)sqlite3_column_text(pending_stmt_, 1));
+        if (time_ms < from_ms || time_ms >= to_ms) continue;
+        CountAggregate sample;
+        sample.samples = 1;
+        sample.sum = sample.max = sample.last = sqlite3_column_int(pending_stmt_, 2);
+        sample.last_ms = time_ms;
+        out.add(sample);
+    }
+    sqlite3_reset(pending_stmt_);
+    if (rc != SQLITE_DONE) {
+        NN_LOG_ERROR("detection history: query pending rows failed: %s", sqlite3_errmsg(db_));
+        return false;
+    }
+    return true;
+}
+
+void DetectionHistory::setHotWindow(const HotWindow *hot) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    hot_ = hot;
+}
+
+// 一次查询的所有语句在同一个读事务里，看到的是写线程同一次提交之后的数据
+bool DetectionHistory::aggregateRaw(const std::string &device, int64_t from_ms, int64_t to_ms, CountAggregate &out) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    out = CountAggregate();
+    // 热数据层起点之前的记录都已写盘，之后的都在内存中
+    int64_t split = to_ms;
+    if (hot_) {
+        split = std::max(from_ms, std::min(to_ms, hot_->coverageStart()));
+        hot_->aggregate(device, split, to_ms, out);
+    }
+    if (split <= from_ms) return true;
+    if (!db_) return false;
+    sqlite3_exec(db_, "BEGIN;", nullptr, nullptr, nullptr);
+    bool ok = loadProgress() && queryRaw(device, from_ms, split, out) && queryPending(device, from_ms, split, out);
+    sqlite3_exec(db_, "COMMIT;", nullptr, nullptr, nullptr);
+    return ok;
+}
+
+bool DetectionHistory::aggregate(const std::string &device, int64_t from_ms, int64_t to_ms, CountAggregate &out) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    out = CountAggregate();
+    from_ms = from_ms / 1000 * 1000;
+    to_ms = to_ms / 1000 * 1000;
+    // 与 aggregateRaw 相同地拆分，分界取整到秒
+    int64_t split = to_ms;
+    if (hot_) {
+        split = std::max(from_ms, std::min(to_ms, (hot_->coverageStart() + 999) / 1000 * 1000));
+        hot_->aggregate(device, split, to_ms, out);
+    }
+    if (split <= from_ms) return true;
+    return aggregateDisk(device, from_ms, split, out);
+}
+
+// [from_ms, to_ms) 两端已取整到秒
+bool DetectionHistory::aggregateDisk(const std::string &device, int64_t from_ms, int64_t to_ms, CountAggregate &out) {
+    if (!db_) return false;
+    sqlite3_exec(db_, "BEGIN;", nullptr, nullptr, nullptr);
+    ok_ = loadProgress();
+    if (ok_ && !rollups_ready_) {
+        // 两端同样按秒取整，结果与汇总表一致
+        ok_ = queryRaw(device, from_ms, to_ms, out) && queryPending(device, from_ms, to_ms, out);
+    } else if (ok_) {
+        collect(kRollupLevels - 1, device, from_ms / 1000, to_ms / 1000, out);
+    }
+    sqlite3_exec(db_, "COMMIT;", nullptr, nullptr, nullptr);
+    return ok_;
+}
+
+bool DetectionHistory::valueAt(const std::string &device, int64_t time_ms, int &value) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!db_) return false;
+    bool found = false;
+    sqlite3_bind_text(span_at_stmt_, 1, device.c_str(), (int)device.size(), SQLITE_STATIC);
+    sqlite3_bind_int64(span_at_stmt_, 2, time_ms);
+    if (sqlite3_step(span_at_stmt_) == SQLITE_ROW) {
+        int64_t start_ms = sqlite3_column_int64(span_at_stmt_, 0);
+        int64_t end_ms = sqlite3_column_int64(span_at_stmt_, 1);
+        if (time_ms < end_ms || time_ms == start_ms) {
+            value = sqlite3_column_int(span_at_stmt_, 2);
+            found = true;
+        }
+    }
+    sqlite3_reset(span_at_stmt_);
+    return found;
+}
+
+bool DetectionHistory::aggregateSpans(const std::string &device, int64_t from_ms, int64_t to_ms, SpanAggregate &out) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    out = SpanAggregate();
+    if (!db_) return false;
+    sqlite3_bind_text(span_range_stmt_, 1, device.c_str(), (int)device.size(), SQLITE_STATIC);
+    sqlite3_bind_int64(span_range_stmt_, 2, from_ms);
+    sqlite3_bind_int64(span_range_stmt_, 3, to_ms);
+    int rc;
+    while ((rc = sqlite3_step(span_range_stmt_)) == SQLITE_ROW) {
+        int64_t start_ms = sqlite3_column_int64(span_range_stmt_, 0);
+        int64_t end_ms = sqlite3_column_int64(span_range_stmt_, 1);
+        int value = sqlite3_column_int(span_range_stmt_, 2);
+        if (start_ms == end_ms) {
+            if (start_ms >= from_ms) out.add(start_ms, end_ms, value);
+            continue;
+        }
+        // 两端的区间截到查询范围内
+        int64_t begin = std::max(start_ms, from_ms), end = std::min(end_ms, to_ms);
+        if (end > begin) out.add(begin, end, value);
+    }
+    sqlite3_reset(span_range_stmt_);
+    if (rc != SQLITE_DONE) {
+        NN_LOG_ERROR("detection history: query detection_spans failed: %s", sqlite3_errmsg(db_));
+        return false;
+    }
+    return true;
+}
+
+bool DetectionHistory::aggregateSeries(const std::string &device, int64_t from_ms, int64_t to_ms, CountAggregate &out) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    out = CountAggregate();
+    if (!db_) return false;
+    sqlite3_stmt *stmt = series_stmt_[device.empty() ? 0 : 1];
+    if (!device.empty()) sqlite3_bind_text(stmt, 1, device.c_str(), (int)device.size(), SQLITE_STATIC);
+    sqlite3_bind_int64(stmt, 2, from_ms);
+    sqlite3_bind_int64(stmt, 3, to_ms);
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        int64_t start_ms = sqlite3_column_int64(stmt, 0);
+        int64_t end_ms = sqlite3_column_int64(stmt, 1);
+        int64_t resolution = std::max<int64_t>(1, sqlite3_column_int64(stmt, 2));
+        CountAggregate block;
+        if (sqlite3_column_type(stmt, 7) == SQLITE_NULL) {
+            // 整块在范围内，不用解码
+            block.samples = sqlite3_column_int64(stmt, 3);
+            block.sum = sqlite3_column_int64(stmt, 4);
+            block.max = sqlite3_column_int(stmt, 5);
+            block.last = sqlite3_column_int(stmt, 6);
+            block.last_ms = end_ms;
+        } else {
+            const uint8_t *data = (const uint8_t *)sqlite3_column_blob(stmt, 7);
+            SeriesDecoder decoder(data, sqlite3_column_bytes(stmt, 7), start_ms / resolution,
+                                  sqlite3_column_int64(stmt, 3));
+            int64_t tick;
+            int value;
+            while (decoder.next(tick, value)) {
+                int64_t time_ms = tick * resolution;
+                if (time_ms >= to_ms) break;
+                if (time_ms < from_ms) continue;
+                block.samples++;
+                block.sum += value;
+                block.max = std::max(block.max, value);
+                block.last = value;
+                block.last_ms = time_ms;
+            }
+        }
+        out.add(block);
+    }
+    sqlite3_reset(stmt);
+    if (rc != SQLITE_DONE) {
+        NN_LOG_ERROR("detection history: query detection_series failed: %s", sqlite3_errmsg(db_));
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,74 @@
+// 历史查询：在汇总表上统计一段时间的人数，整小时用小时表，剩下的部分依次用分钟表、秒表，
+// 结果与逐行统计原始记录一致（精确到秒），查询量与时间跨度基本无关。
+// 旧数据的汇总还没补建完时改为在原始记录的 ts 覆盖索引上统计。
+// change_only 模式写入的变化区间另有按时刻取值和按时间加权统计的接口；
+// 压缩序列块完全在范围内时直接用块的汇总列，只解码两端的块。
+// 设置了热数据层（写入器的 HotWindow）时，aggregate/aggregateRaw 中热数据层覆盖的部分在内存中统计，其余部分查数据库
+
+#ifndef RK3588_DEMO_DETECTION_HISTORY_H
+#define RK3588_DEMO_DETECTION_HISTORY_H
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+#include <sqlite3.h>
+
+#include "hot_window.h"
+#include "rollup.h"
+
+class DetectionHistory {
+public:
+    DetectionHistory() = default;
+    ~DetectionHistory();
+
+    DetectionHistory(const DetectionHistory &) = delete;
+    DetectionHistory &operator=(const DetectionHistory &) = delete;
+
+    // 只读连接，与 DetectionWriter 的写连接并行（WAL）
+    bool open(const std::string &db_path);
+    void close();
+    bool isOpen() const { return db_ != nullptr; }
+    // 同一数据库的写入器的热数据层（DetectionWriter::hotWindow()），须在本对象之后销毁
+    void setHotWindow(const HotWindow *hot);
+
+    // 统计 [from_ms, to_ms) 内的记录，两端按秒取整；device 为空时统计所有设备
+    bool aggregate(const std::string &device, int64_t from_ms, int64_t to_ms, CountAggregate &out);
+    // 直接统计 [from_ms, to_ms) 内的原始记录（毫秒精度），走 (ts) 或 (device, ts) 覆盖索引
+    bool aggregateRaw(const std::string &device, int64_t from_ms, int64_t to_ms, CountAggregate &out);
+
+    // 变化区间：time_ms 时刻的人数，该时刻没有数据（空档或超出已记录的范围）时返回 false
+    bool valueAt(const std::string &device, int64_t time_ms, int &value);
+    // 变化区间：[from_ms, to_ms) 内人数的时长、时间加权和、最大/最小/最后值，与逐条记录得到的人数曲线完全一致
+    bool aggregateSpans(const std::string &device, int64_t from_ms, int64_t to_ms, SpanAggregate &out);
+    // 压缩序列：统计 [from_ms, to_ms) 内的样本，样本时间为量化后的时间；device 为空时统计所有设备
+    bool aggregateSeries(const std::string &device, int64_t from_ms, int64_t to_ms, CountAggregate &out);
+
+private:
+    void collect(int level, const std::string &device, int64_t from_s, int64_t to_s, CountAggregate &out);
+    bool queryLevel(int level, const std::string &device, int64_t from_s, int64_t to_s, CountAggregate &out);
+    bool queryRaw(const std::string &device, int64_t from_ms, int64_t to_ms, CountAggregate &out);
+    bool queryPending(const std::string &device, int64_t from_ms, int64_t to_ms, CountAggregate &out);
+    bool loadProgress();
+    bool aggregateDisk(const std::string &device, int64_t from_ms, int64_t to_ms, CountAggregate &out);
+    void finalize();
+
+    std::mutex mutex_;
+    const HotWindow *hot_ = nullptr;
+    sqlite3 *db_ = nullptr;
+    sqlite3_stmt *sum_stmt_[kRollupLevels] = {};
+    sqlite3_stmt *last_stmt_[kRollupLevels] = {};
+    // 原始记录：[0] 所有设备，[1] 指定设备，分开写才能各自用上索引
+    sqlite3_stmt *raw_sum_stmt_[2] = {};
+    sqlite3_stmt *raw_last_stmt_[2] = {};
+    sqlite3_stmt *pending_stmt_ = nullptr;   // 还没迁移 ts 的旧记录
+    sqlite3_stmt *progress_stmt_ = nullptr;  // 写线程的后台迁移/补建进度
+    sqlite3_stmt *span_at_stmt_ = nullptr;
+    sqlite3_stmt *span_range_stmt_ = nullptr;
+    sqlite3_stmt *series_stmt_[2] = {};  // [0] 所有设备，[1] 指定设备
+    int64_t migrate_next_ = 0, migrate_end_ = 0;
+    bool rollups_ready_ = false;
+    bool ok_ = true;
+};
+
+#endif // RK3588_DEMO_DETECTION_HISTORY_H
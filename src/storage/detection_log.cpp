@@ -0,0 +1,461 @@
+#include "detection_log.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "rollup.h"
+#include "utils/logging.h"
+
+static_assert(sizeof(LogSegmentHeader) == 16, "segment header layout");
+static_assert(sizeof(LogRecordHeader) == 24, "record header layout");
+static_assert(sizeof(LogBox) == 14, "box layout");
+static_assert(sizeof(LogIndexEntry) == 16, "index entry layout");
+
+// 索引中 max_time_before 为 -1 的项指向一组摄像头名记录（段开头、重新打开或新注册摄像头时写入）
+static const int64_t kIndexCameraMark = -1;
+// 读取时允许的晚到时间：读到比范围终点晚这么多的记录后不再往后读
+static const int64_t kMaxLatenessMs = 60 * 1000;
+// 重新打开段时清零的末尾长度，覆盖崩溃时写了一半的记录
+static const size_t kTailClearBytes = 1 << 20;
+static const int64_t kHourMs = 3600 * 1000;
+
+static size_t align8(size_t n) {
+    return (n + 7) & ~(size_t)7;
+}
+
+static int64_t steadyMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static int64_t wallMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+static bool makeDirs(const std::string &dir) {
+    for (size_t pos = 1; pos <= dir.size(); pos++) {
+        if (pos == dir.size() || dir[pos] == '/') {
+            std::string part = dir.substr(0, pos);
+            if (mkdir(part.c_str(), 0755) != 0 && errno != EEXIST) return false;
+        }
+    }
+    return true;
+}
+
+int64_t logHourStart(int64_t time_ms) {
+    time_t t = (time_t)(time_ms / 1000);
+    std::tm bt;
+    localtime_r(&t, &bt);
+    bt.tm_min = 0;
+    bt.tm_sec = 0;
+    return (int64_t)mktime(&bt) * 1000;
+}
+
+std::string logSegmentName(int64_t hour_start_ms) {
+    return formatLocalTimestamp(hour_start_ms).substr(0, 10);
+}
+
+// 段文件名（YYYYMMDDHH.dlog）对应的小时起点，不是段文件返回 -1
+static int64_t segmentHour(const std::string &file) {
+    if (file.size() != 15 || file.compare(10, 5, ".dlog") != 0) return -1;
+    return parseLocalTimestamp(file.substr(0, 10) + "0000");
+}
+
+DetectionLog::~DetectionLog() {
+    stop();
+}
+
+bool DetectionLog::start(const Params &params) {
+    if (running_) return true;
+    params_ = params;
+    params_.index_interval_ms = std::max(1, params_.index_interval_ms);
+    params_.initial_segment_bytes = std::max<size_t>(kTailClearBytes, params_.initial_segment_bytes);
+    if (!makeDirs(params_.dir)) {
+        NN_LOG_ERROR("detection log: create %s failed: %s", params_.dir.c_str(), strerror(errno));
+        return false;
+    }
+    stop_ = false;
+    running_ = true;
+    thread_ = std::thread(&DetectionLog::run, this);
+    return true;
+}
+
+void DetectionLog::stop() {
+    if (!running_) return;
+    stop_ = true;
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    running_ = false;
+}
+
+int DetectionLog::addCamera(const std::string &name) {
+    std::lock_guard<std::mutex> lock(camera_mutex_);
+    int camera = camera_count_.load();
+    if (camera >= kMaxCameras) {
+        NN_LOG_ERROR("detection log: more than %d cameras, %s is not logged", kMaxCameras, name.c_str());
+        return -1;
+    }
+    rings_[camera].reset(new BoundedQueue<LogFrame>(std::max<size_t>(4, params_.ring_frames)));
+    cameras_.push_back(name);
+    // 队列建好之后才对写线程可见
+    camera_count_.store(camera + 1, std::memory_order_release);
+    return camera;
+}
+
+bool DetectionLog::push(int camera, const LogFrame &frame) {
+    if (!running_ || camera < 0 || camera >= camera_count_.load(std::memory_order_acquire)) return false;
+    if (!rings_[camera]->push(frame)) {
+        dropped_++;
+        return false;
+    }
+    return true;
+}
+
+DetectionLog::Stats DetectionLog::takeStats() {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    Stats stats = stats_;
+    stats.dropped = dropped_.exchange(0);
+    stats_ = Stats();
+    return stats;
+}
+
+bool DetectionLog::openSegment(int64_t hour_start_ms) {
+    const std::string base = params_.dir + "/" + logSegmentName(hour_start_ms);
+    const std::string path = base + ".dlog";
+    fd_ = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd_ < 0) {
+        NN_LOG_ERROR("detection log: open %s failed: %s", path.c_str(), strerror(errno));
+        return false;
+    }
+    struct stat st;
+    fstat(fd_, &st);
+    const size_t existing = (size_t)st.st_size;
+    capacity_ = params_.initial_segment_bytes;
+    while (capacity_ < existing + kTailClearBytes) capacity_ *= 2;
+    if (ftruncate(fd_, (off_t)capacity_) != 0) {
+        NN_LOG_ERROR("detection log: resize %s failed: %s", path.c_str(), strerror(errno));
+        ::close(fd_);
+        fd_ = -1;
+        return false;
+    }
+    void *map = mmap(nullptr, capacity_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (map == MAP_FAILED) {
+        NN_LOG_ERROR("detection log: mmap %s failed: %s", path.c_str(), strerror(errno));
+        ::close(fd_);
+        fd_ = -1;
+        return false;
+    }
+    map_ = (uint8_t *)map;
+    hour_start_ms_ = hour_start_ms;
+    max_time_ = 0;
+
+    LogSegmentHeader *header = (LogSegmentHeader *)map_;
+    if (existing >= sizeof(LogSegmentHeader) && memcmp(header->magic, kLogMagic, 4) == 0) {
+        // 同一小时内重新启动：接在已有记录之后写
+        used_ = sizeof(LogSegmentHeader);
+        while (used_ + sizeof(LogRecordHeader) <= existing) {
+            const LogRecordHeader *record = (const LogRecordHeader *)(map_ + used_);
+            if (record->size < sizeof(LogRecordHeader) || record->size % 8 != 0 || used_ + record->size > existing) break;
+            if (record->kind == kLogFrame) max_time_ = std::max(max_time_, record->time_ms);
+            used_ += record->size;
+        }
+        memset(map_ + used_, 0, std::min(kTailClearBytes, capacity_ - used_));
+    } else {
+        memset(header, 0, sizeof(LogSegmentHeader));
+        memcpy(header->magic, kLogMagic, 4);
+        header->version = kLogVersion;
+        header->hour_start_ms = hour_start_ms;
+        used_ = sizeof(LogSegmentHeader);
+    }
+
+    index_fd_ = open((base + ".idx").c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (index_fd_ < 0) {
+        NN_LOG_WARNING("detection log: open %s.idx failed: %s", base.c_str(), strerror(errno));
+    }
+    written_cameras_ = 0;
+    last_index_ms_ = steadyMs();
+    return true;
+}
+
+// 关闭时文件截到实际长度；读取方不要在段关闭（整点轮换、退出）的同时读取这一段
+void DetectionLog::closeSegment() {
+    if (!map_) return;
+    writeIndex();
+    msync(map_, used_, MS_SYNC);
+    munmap(map_, capacity_);
+    map_ = nullptr;
+    // 截掉映射时预留的空间
+    if (ftruncate(fd_, (off_t)used_) != 0) {
+        NN_LOG_WARNING("detection log: truncate segment failed: %s", strerror(errno));
+    }
+    ::close(fd_);
+    fd_ = -1;
+    if (index_fd_ >= 0) {
+        ::close(index_fd_);
+        index_fd_ = -1;
+    }
+    hour_start_ms_ = -1;
+}
+
+// 空间不够时文件和映射都加倍
+bool DetectionLog::reserve(size_t bytes) {
+    if (used_ + bytes <= capacity_) return true;
+    size_t capacity = capacity_;
+    while (used_ + bytes > capacity) capacity *= 2;
+    munmap(map_, capacity_);
+    map_ = nullptr;
+    if (ftruncate(fd_, (off_t)capacity) != 0) {
+        NN_LOG_ERROR("detection log: grow segment failed: %s", strerror(errno));
+    }
+    void *map = mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (map == MAP_FAILED) {
+        NN_LOG_ERROR("detection log: mmap failed: %s", strerror(errno));
+        // 映射不回来时放弃这一段，下一帧重新打开
+        ::close(fd_);
+        fd_ = -1;
+        if (index_fd_ >= 0) ::close(index_fd_);
+        index_fd_ = -1;
+        hour_start_ms_ = -1;
+        return false;
+    }
+    map_ = (uint8_t *)map;
+    capacity_ = capacity;
+    return true;
+}
+
+// 先写负载和头的其余字段，最后写 size：读取方看到非 0 的 size 时整条记录已经写完
+void DetectionLog::append(uint16_t kind, uint16_t camera, int64_t time_ms, uint16_t count, uint16_t width,
+                          uint16_t height, const void *payload, size_t payload_bytes) {
+    const size_t size = align8(sizeof(LogRecordHeader) + payload_bytes);
+    if (!reserve(size)) return;
+    LogRecordHeader *record = (LogRecordHeader *)(map_ + used_);
+    if (payload_bytes > 0) {
+        memcpy(map_ + used_ + sizeof(LogRecordHeader), payload, payload_bytes);
+    }
+    record->kind = kind;
+    record->camera = camera;
+    record->time_ms = time_ms;
+    record->count = count;
+    record->width = width;
+    record->height = height;
+    record->reserved = 0;
+    __atomic_store_n(&record->size, (uint32_t)size, __ATOMIC_RELEASE);
+    used_ += size;
+
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    stats_.bytes += size;
+}
+
+void DetectionLog::writeCameraName(int camera) {
+    std::string name;
+    {
+        std::lock_guard<std::mutex> lock(camera_mutex_);
+        name = cameras_[camera];
+    }
+    if (name.size() > 0xFFFF) name.resize(0xFFFF);
+    append(kLogCamera, (uint16_t)camera, wallMs(), (uint16_t)name.size(), 0, 0, name.data(), name.size());
+}
+
+void DetectionLog::writeIndex() {
+    if (index_fd_ < 0) return;
+    LogIndexEntry entry = {max_time_, (uint64_t)used_};
+    if (write(index_fd_, &entry, sizeof(entry)) != (ssize_t)sizeof(entry)) {
+        NN_LOG_WARNING("detection log: write index failed: %s", strerror(errno));
+    }
+    last_index_ms_ = steadyMs();
+}
+
+void DetectionLog::enforceRetention() {
+    if (params_.retention_hours <= 0) return;
+    const int64_t cutoff = wallMs() - (int64_t)params_.retention_hours * kHourMs;
+    DIR *dir = opendir(params_.dir.c_str());
+    if (!dir) return;
+    while (struct dirent *entry = readdir(dir)) {
+        std::string file = entry->d_name;
+        int64_t hour = segmentHour(file);
+        if (hour < 0 || hour == hour_start_ms_ || hour + kHourMs > cutoff) continue;
+        std::string base = params_.dir + "/" + file.substr(0, 10);
+        unlink((base + ".dlog").c_str());
+        unlink((base + ".idx").c_str());
+        NN_LOG_INFO("detection log: removed expired segment %s", file.c_str());
+    }
+    closedir(dir);
+}
+
+void DetectionLog::run() {
+    LogFrame frame;
+    int64_t last_retention = 0;
+    for (;;) {
+        bool stopping = stop_;
+        int popped = 0;
+        const int cameras = camera_count_.load(std::memory_order_acquire);
+        for (int camera = 0; camera < cameras; camera++) {
+            // 每轮每个摄像头最多取一批，各摄像头轮流写
+            for (int i = 0; i < 32 && rings_[camera]->pop(frame); i++) {
+                if (hour_start_ms_ < 0 || frame.time_ms >= hour_start_ms_ + kHourMs) {
+                    // 进入新的一小时（晚到的上一小时的帧留在当前段）
+                    closeSegment();
+                    if (!openSegment(logHourStart(frame.time_ms))) continue;
+                }
+                if (written_cameras_ < cameras) {
+                    // 段开头或有新摄像头：先写摄像头名，并在索引中标出位置
+                    LogIndexEntry mark = {kIndexCameraMark, (uint64_t)used_};
+                    if (index_fd_ >= 0 && write(index_fd_, &mark, sizeof(mark)) != (ssize_t)sizeof(mark)) {
+                        NN_LOG_WARNING("detection log: write index failed: %s", strerror(errno));
+                    }
+                    for (; written_cameras_ < cameras; written_cameras_++) writeCameraName(written_cameras_);
+                }
+                const size_t count = std::min<size_t>(frame.boxes.size(), 0xFFFF);
+                append(kLogFrame, (uint16_t)camera, frame.time_ms, (uint16_t)count, (uint16_t)frame.width,
+                       (uint16_t)frame.height, frame.boxes.data(), count * sizeof(LogBox));
+                max_time_ = std::max(max_time_, frame.time_ms);
+                popped++;
+            }
+        }
+        if (popped > 0) {
+            std::lock_guard<std::mutex> lock(stats_mutex_);
+            stats_.frames += popped;
+        }
+        if (map_ && steadyMs() - last_index_ms_ >= params_.index_interval_ms) {
+            writeIndex();
+            // 交给内核异步写回，不等待
+            msync(map_, used_, MS_ASYNC);
+        }
+        if (steadyMs() - last_retention >= 60 * 1000) {
+            enforceRetention();
+            last_retention = steadyMs();
+        }
+        if (stopping && popped == 0) break;
+        if (popped == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+    }
+    closeSegment();
+}
+
+bool DetectionLogReader::open(const std::string &dir) {
+    struct stat st;
+    if (stat(dir.c_str(), &st) != 0 || !S_ISDIR(st.st_mode)) return false;
+    dir_ = dir;
+    return true;
+}
+
+bool DetectionLogReader::forEach(int64_t from_ms, int64_t to_ms, const std::function<bool(const LogFrame &)> &callback) {
+    DIR *dir = opendir(dir_.c_str());
+    if (!dir) return false;
+    std::vector<std::string> files;
+    while (struct dirent *entry = readdir(dir)) {
+        std::string file = entry->d_name;
+        int64_t hour = segmentHour(file);
+        // 段中记录的时间早于 hour + 1 小时；晚到的记录可能在后面的段里
+        if (hour < 0 || hour + kHourMs <= from_ms || hour >= to_ms + kMaxLatenessMs) continue;
+        files.push_back(file);
+    }
+    closedir(dir);
+    std::sort(files.begin(), files.end());
+
+    bool stopped = false;
+    for (const auto &file : files) {
+        if (!readSegment(dir_ + "/" + file, from_ms, to_ms, callback, stopped) || stopped) break;
+    }
+    return true;
+}
+
+bool DetectionLogReader::readSegment(const std::string &path, int64_t from_ms, int64_t to_ms,
+                                     const std::function<bool(const LogFrame &)> &callback, bool &stopped) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return true;
+    struct stat st;
+    fstat(fd, &st);
+    const size_t size = (size_t)st.st_size;
+    if (size < sizeof(LogSegmentHeader)) {
+        ::close(fd);
+        return true;
+    }
+    void *map = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) return true;
+    const uint8_t *data = (const uint8_t *)map;
+    if (memcmp(((const LogSegmentHeader *)data)->magic, kLogMagic, 4) != 0) {
+        munmap(map, size);
+        return true;
+    }
+
+    // 索引：从最后一个“之前的记录都早于 from_ms”的位置开始读
+    std::vector<LogIndexEntry> index;
+    std::string index_path = path.substr(0, path.size() - 5) + ".idx";
+    int index_fd = ::open(index_path.c_str(), O_RDONLY);
+    if (index_fd >= 0) {
+        LogIndexEntry entry;
+        while (read(index_fd, &entry, sizeof(entry)) == (ssize_t)sizeof(entry)) index.push_back(entry);
+        ::close(index_fd);
+    }
+    size_t start = sizeof(LogSegmentHeader);
+    for (const auto &entry : index) {
+        if (entry.max_time_before != kIndexCameraMark && entry.max_time_before < from_ms && entry.offset <= size) {
+            start = std::max<size_t>(start, entry.offset);
+        }
+    }
+
+    auto readRecord = [&](size_t pos, const LogRecordHeader *&record) -> bool {
+        if (pos + sizeof(LogRecordHeader) > size) return false;
+        record = (const LogRecordHeader *)(data + pos);
+        uint32_t record_size = __atomic_load_n(&record->size, __ATOMIC_ACQUIRE);
+        return record_size >= sizeof(LogRecordHeader) && record_size % 8 == 0 && pos + record_size <= size;
+    };
+    auto readName = [&](const LogRecordHeader *record) {
+        if (record->camera >= names_.size()) names_.resize(record->camera + 1);
+        names_[record->camera].assign((const char *)(record + 1),
+                                      std::min<size_t>(record->count, record->size - sizeof(LogRecordHeader)));
+    };
+
+    // 跳过的部分中的摄像头名由索引标出的位置读取
+    names_.clear();
+    for (const auto &entry : index) {
+        if (entry.max_time_before != kIndexCameraMark || entry.offset >= start) continue;
+        const LogRecordHeader *record;
+        for (size_t pos = entry.offset; readRecord(pos, record) && record->kind == kLogCamera; pos += record->size) {
+            readName(record);
+        }
+    }
+
+    LogFrame frame;
+    const LogRecordHeader *record;
+    for (size_t pos = start; readRecord(pos, record); pos += record->size) {
+        if (record->kind == kLogCamera) {
+            readName(record);
+            continue;
+        }
+        if (record->kind != kLogFrame) continue;
+        if (record->time_ms >= to_ms + kMaxLatenessMs) {
+            stopped = true;
+            break;
+        }
+        if (record->time_ms < from_ms || record->time_ms >= to_ms) continue;
+        const size_t count = std::min<size_t>(record->count, (record->size - sizeof(LogRecordHeader)) / sizeof(LogBox));
+        const LogBox *boxes = (const LogBox *)(record + 1);
+        frame.time_ms = record->time_ms;
+        frame.camera = record->camera;
+        frame.width = record->width;
+        frame.height = record->height;
+        frame.boxes.assign(boxes, boxes + count);
+        frame.camera_name = record->camera < names_.size() ? names_[record->camera].c_str() : "";
+        if (!callback(frame)) {
+            stopped = true;
+            break;
+        }
+    }
+    munmap(map, size);
+    return true;
+}
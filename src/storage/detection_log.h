@@ -0,0 +1,171 @@
+// 检测框日志：每帧的检测框（时间、摄像头、框、置信度）以紧凑的二进制格式追加写入内存映射的文件，供离线分析人群位置。
+// 摄像头线程只把帧放进自己的无锁环形队列，专用写线程依次取出写入；文件按小时分段（目录下 YYYYMMDDHH.dlog），
+// 每段另有时间索引（YYYYMMDDHH.idx），读取时按时间直接定位。
+//
+// 段文件格式（小端，记录按 8 字节对齐）：
+//   LogSegmentHeader，之后是连续的记录，每条记录为 LogRecordHeader + 负载，size 为 0 处是数据末尾；
+//   kLogCamera 记录：负载为摄像头名（count 字节），每段开头写一次所有摄像头，新注册的摄像头随时追加；
+//   kLogFrame 记录：负载为 count 个 LogBox，坐标是原始帧（width × height）上的像素。
+// 索引文件：每 index_interval_ms 追加一个 LogIndexEntry，offset 之前所有记录的时间都不超过 max_time_before。
+// 一段中的记录按写入顺序排列，不同摄像头之间的时间可能略有交错；晚到的上一小时的记录写入当前段。
+
+#ifndef RK3588_DEMO_DETECTION_LOG_H
+#define RK3588_DEMO_DETECTION_LOG_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bounded_queue.h"
+
+static const char kLogMagic[4] = {'D', 'L', 'O', 'G'};
+static const uint16_t kLogVersion = 1;
+
+enum LogRecordKind : uint16_t {
+    kLogCamera = 1,
+    kLogFrame = 2,
+};
+
+struct LogSegmentHeader {
+    char magic[4];
+    uint16_t version;
+    uint16_t reserved;
+    int64_t hour_start_ms;  // 本段对应的小时（本地时间）的起点
+};
+
+struct LogRecordHeader {
+    uint32_t size;     // 整条记录的字节数（含头和对齐填充）
+    uint16_t kind;     // LogRecordKind
+    uint16_t camera;   // 摄像头编号，由 kLogCamera 记录给出名字
+    int64_t time_ms;   // 系统时间（毫秒）
+    uint16_t count;    // 框的个数，或摄像头名的长度
+    uint16_t width;    // 原始帧尺寸
+    uint16_t height;
+    uint16_t reserved;
+};
+
+// 14 字节
+struct LogBox {
+    uint16_t x, y, w, h;
+    uint16_t score;     // 置信度 × 65535
+    uint16_t track_id;  // 跟踪编号，0xFFFF 表示没有
+    uint8_t class_id;
+    uint8_t flags;      // kLogBoxExcluded：框在屏蔽区域内，不计入人数
+
+    float confidence() const { return score / 65535.0f; }
+};
+static const uint8_t kLogBoxExcluded = 0x01;
+
+struct LogIndexEntry {
+    int64_t max_time_before;
+    uint64_t offset;
+};
+
+// 一帧的检测结果
+struct LogFrame {
+    int64_t time_ms = 0;
+    int camera = 0;
+    int width = 0;
+    int height = 0;
+    std::vector<LogBox> boxes;
+    const char *camera_name = nullptr;  // 读取时由 DetectionLogReader 填写，回调期间有效
+};
+
+class DetectionLog {
+public:
+    struct Params {
+        std::string dir = "./detection_log";
+        size_t ring_frames = 256;        // 每个摄像头的队列容量（帧），满时丢弃
+        int index_interval_ms = 1000;    // 时间索引的间隔
+        int retention_hours = 24 * 7;    // 超过的段每分钟检查一次并删除，0 为永久保留
+        size_t initial_segment_bytes = 64 << 20;  // 段文件的初始映射大小，写满后加倍
+    };
+
+    struct Stats {
+        uint64_t frames = 0;   // 上次取统计以来写入的帧数
+        uint64_t bytes = 0;
+        uint64_t dropped = 0;  // 队列满丢弃的帧数
+    };
+
+    DetectionLog() = default;
+    ~DetectionLog();
+
+    DetectionLog(const DetectionLog &) = delete;
+    DetectionLog &operator=(const DetectionLog &) = delete;
+
+    bool start(const Params &params);
+    // 写完队列中剩余的帧后返回，段文件截到实际长度
+    void stop();
+    bool running() const { return running_; }
+
+    // 注册摄像头，返回编号；最多 kMaxCameras 个，应在开始写入之前注册
+    int addCamera(const std::string &name);
+    // 放入一帧，只由该摄像头的线程调用，不阻塞；队列满返回 false
+    bool push(int camera, const LogFrame &frame);
+
+    Stats takeStats();
+
+    static const int kMaxCameras = 64;
+
+private:
+    void run();
+    bool openSegment(int64_t hour_start_ms);
+    void closeSegment();
+    bool reserve(size_t bytes);
+    void append(uint16_t kind, uint16_t camera, int64_t time_ms, uint16_t count, uint16_t width, uint16_t height,
+                const void *payload, size_t payload_bytes);
+    void writeCameraName(int camera);
+    void writeIndex();
+    void enforceRetention();
+
+    Params params_;
+    std::unique_ptr<BoundedQueue<LogFrame>> rings_[kMaxCameras];
+    std::mutex camera_mutex_;
+    std::vector<std::string> cameras_;
+    std::atomic<int> camera_count_{0};
+    std::thread thread_;
+    std::atomic<bool> running_{false};
+    std::atomic<bool> stop_{false};
+
+    // 以下只在写线程中使用
+    int fd_ = -1;
+    int index_fd_ = -1;
+    uint8_t *map_ = nullptr;
+    size_t capacity_ = 0;
+    size_t used_ = 0;
+    int64_t hour_start_ms_ = -1;
+    int64_t max_time_ = 0;
+    int64_t last_index_ms_ = 0;
+    int written_cameras_ = 0;  // 本段已写入名字的摄像头数
+
+    std::mutex stats_mutex_;
+    Stats stats_;
+    std::atomic<uint64_t> dropped_{0};
+};
+
+// 读取检测框日志：按时间范围遍历各段中的帧，用时间索引跳过范围之前的数据
+class DetectionLogReader {
+public:
+    bool open(const std::string &dir);
+
+    // 回调 [from_ms, to_ms) 内的每一帧（按段内写入顺序），回调返回 false 时停止；目录不存在返回 false
+    bool forEach(int64_t from_ms, int64_t to_ms, const std::function<bool(const LogFrame &)> &callback);
+
+private:
+    bool readSegment(const std::string &path, int64_t from_ms, int64_t to_ms,
+                     const std::function<bool(const LogFrame &)> &callback, bool &stopped);
+
+    std::string dir_;
+    std::vector<std::string> names_;  // 当前段的摄像头名
+};
+
+// 段文件的小时起点（本地时间）与文件名（不含扩展名）的转换
+std::string logSegmentName(int64_t hour_start_ms);
+int64_t logHourStart(int64_t time_ms);
+
+#endif // RK3588_DEMO_DETECTION_LOG_H
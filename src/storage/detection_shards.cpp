@@ -0,0 +1,173 @@
+#include "detection_shards.h"
+
+#include <algorithm>
+#include <cctype>
+
+#include "utils/logging.h"
+
+DetectionShards::~DetectionShards() {
+    stop();
+}
+
+std::string DetectionShards::shardPath(const std::string &db_path, const std::string &name) {
+    std::string base = db_path;
+    if (base.size() > 3 && base.compare(base.size() - 3, 3, ".db") == 0) {
+        base.resize(base.size() - 3);
+    }
+    std::string safe = name;
+    for (char &c : safe) {
+        if (!std::isalnum((unsigned char)c) && c != '-') c = '_';
+    }
+    return base + "_" + safe + ".db";
+}
+
+bool DetectionShards::start(const DetectionWriter::Params &params, const std::vector<std::string> &names) {
+    if (running()) return true;
+    if (names.size() > (size_t)kMaxShards) {
+        NN_LOG_ERROR("detection shards: %zu shards, at most %d", names.size(), kMaxShards);
+        return false;
+    }
+    paths_.clear();
+    if (names.empty()) {
+        paths_.push_back(params.db_path);
+    } else {
+        for (const auto &name : names) {
+            paths_.push_back(shardPath(params.db_path, name));
+        }
+    }
+    for (const auto &path : paths_) {
+        DetectionWriter::Params shard_params = params;
+        shard_params.db_path = path;
+        std::unique_ptr<DetectionWriter> writer(new DetectionWriter());
+        if (!writer->start(shard_params)) {
+            stop();
+            return false;
+        }
+        writers_.push_back(std::move(writer));
+    }
+    if (paths_.size() > 1) {
+        NN_LOG_INFO("detection shards: %zu databases, one writer thread each", paths_.size());
+    }
+    return true;
+}
+
+void DetectionShards::stop() {
+    for (auto &writer : writers_) {
+        writer->stop();
+    }
+    writers_.clear();
+}
+
+int DetectionShards::addDevice(const std::string &id, int shard) {
+    if (writers_.empty()) return -1;
+    shard = std::max(0, shard) % (int)writers_.size();
+    return writers_[shard]->addDevice(id) * kMaxShards + shard;
+}
+
+bool DetectionShards::push(int slot, int64_t time_ms, int count) {
+    if (slot < 0) return false;
+    int shard = slot % kMaxShards;
+    if (shard >= (int)writers_.size()) return false;
+    return writers_[shard]->push(slot / kMaxShards, time_ms, count);
+}
+
+std::vector<const HotWindow *> DetectionShards::hotWindows() const {
+    std::vector<const HotWindow *> hot;
+    for (const auto &writer : writers_) {
+        hot.push_back(writer->hotWindow());
+    }
+    return hot;
+}
+
+DetectionWriter::Stats DetectionShards::takeStats() {
+    DetectionWriter::Stats total;
+    double commit_ms_sum = 0;
+    for (auto &writer : writers_) {
+        DetectionWriter::Stats stats = writer->takeStats();
+        total.rows += stats.rows;
+        total.span_writes += stats.span_writes;
+        total.dropped += stats.dropped;
+        total.transactions += stats.transactions;
+        total.deleted += stats.deleted;
+        commit_ms_sum += stats.avg_commit_ms * stats.transactions;
+        total.max_commit_ms = std::max(total.max_commit_ms, stats.max_commit_ms);
+    }
+    total.avg_commit_ms = total.transactions > 0 ? commit_ms_sum / total.transactions : 0;
+    return total;
+}
+
+void ShardedHistory::open(const std::vector<std::string> &paths, const std::vector<const HotWindow *> &hot) {
+    close();
+    paths_ = paths;
+    for (size_t i = 0; i < paths_.size(); i++) {
+        shards_.emplace_back(new DetectionHistory());
+        if (i < hot.size()) shards_.back()->setHotWindow(hot[i]);
+    }
+    ensureOpen();
+}
+
+void ShardedHistory::close() {
+    shards_.clear();
+    paths_.clear();
+}
+
+bool ShardedHistory::ensureOpen() {
+    bool all = true;
+    for (size_t i = 0; i < shards_.size(); i++) {
+        if (!shards_[i]->isOpen() && !shards_[i]->open(paths_[i])) all = false;
+    }
+    return all;
+}
+
+bool ShardedHistory::aggregate(const std::string &device, int64_t from_ms, int64_t to_ms, CountAggregate &out) {
+    out = CountAggregate();
+    bool ok = ensureOpen();
+    for (auto &shard : shards_) {
+        CountAggregate part;
+        if (shard->isOpen() && shard->aggregate(device, from_ms, to_ms, part)) {
+            out.add(part);
+        } else {
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+bool ShardedHistory::aggregateRaw(const std::string &device, int64_t from_ms, int64_t to_ms, CountAggregate &out) {
+    out = CountAggregate();
+    bool ok = ensureOpen();
+    for (auto &shard : shards_) {
+        CountAggregate part;
+        if (shard->isOpen() && shard->aggregateRaw(device, from_ms, to_ms, part)) {
+            out.add(part);
+        } else {
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+bool attachShards(sqlite3 *db, const std::vector<std::string> &paths) {
+    std::string view = "CREATE TEMP VIEW IF NOT EXISTS all_detection_results AS ";
+    for (size_t i = 0; i < paths.size(); i++) {
+        std::string schema = "shard" + std::to_string(i);
+        char *sql = sqlite3_mprintf("ATTACH DATABASE %Q AS %s;", paths[i].c_str(), schema.c_str());
+        char *err = nullptr;
+        int rc = sqlite3_exec(db, sql, nullptr, nullptr, &err);
+        sqlite3_free(sql);
+        if (rc != SQLITE_OK) {
+            NN_LOG_ERROR("detection shards: attach %s failed: %s", paths[i].c_str(), err);
+            sqlite3_free(err);
+            return false;
+        }
+        if (i > 0) view += " UNION ALL ";
+        view += "SELECT device, timestamp, box_count, ts FROM " + schema + ".detection_results";
+    }
+    char *err = nullptr;
+    if (!paths.empty() && sqlite3_exec(db, (view + ";").c_str(), nullptr, nullptr, &err) != SQLITE_OK) {
+        NN_LOG_ERROR("detection shards: create view failed: %s", err);
+        sqlite3_free(err);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,75 @@
+// 分片存储：每个摄像头（或每组摄像头）一个数据库文件和一个 DetectionWriter，各自的写线程互不等待写锁，
+// 写入能力随分片数增加；查询时逐个分片统计再合并（ShardedHistory），或把各分片 ATTACH 到一个连接上用 SQL 查询
+
+#ifndef RK3588_DEMO_DETECTION_SHARDS_H
+#define RK3588_DEMO_DETECTION_SHARDS_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <sqlite3.h>
+
+#include "detection_history.h"
+#include "detection_writer.h"
+
+class DetectionShards {
+public:
+    // 分片数上限（写入编号的低 8 位是分片号）
+    static const int kMaxShards = 256;
+
+    DetectionShards() = default;
+    ~DetectionShards();
+
+    DetectionShards(const DetectionShards &) = delete;
+    DetectionShards &operator=(const DetectionShards &) = delete;
+
+    // names 为空时只有一个分片，就是 params.db_path；否则每个名字一个分片，
+    // 文件名为 db_path 去掉 .db 后加 _名字.db（名字中的非字母数字字符换成 _）
+    bool start(const DetectionWriter::Params &params, const std::vector<std::string> &names);
+    void stop();
+    bool running() const { return !writers_.empty(); }
+
+    // 在 shard 分片上注册设备，返回写入时使用的编号
+    int addDevice(const std::string &id, int shard = 0);
+    // 与 DetectionWriter::push 相同，不阻塞
+    bool push(int slot, int64_t time_ms, int count);
+
+    // 所有分片的统计之和（max_commit_ms 取最大值）
+    DetectionWriter::Stats takeStats();
+
+    int shardCount() const { return (int)writers_.size(); }
+    const std::vector<std::string> &paths() const { return paths_; }
+    // 各分片的热数据层（与 paths() 对应，没有打开时为 nullptr），stop 之后失效
+    std::vector<const HotWindow *> hotWindows() const;
+
+    static std::string shardPath(const std::string &db_path, const std::string &name);
+
+private:
+    std::vector<std::unique_ptr<DetectionWriter>> writers_;
+    std::vector<std::string> paths_;
+};
+
+// 跨分片查询：各分片的设备互不重叠，逐个分片统计后合并，结果与单个数据库相同
+class ShardedHistory {
+public:
+    // 打开失败的分片（写线程还没有建表）在下次查询时重试；hot 为各分片的热数据层（DetectionShards::hotWindows()）
+    void open(const std::vector<std::string> &paths, const std::vector<const HotWindow *> &hot = {});
+    void close();
+
+    bool aggregate(const std::string &device, int64_t from_ms, int64_t to_ms, CountAggregate &out);
+    bool aggregateRaw(const std::string &device, int64_t from_ms, int64_t to_ms, CountAggregate &out);
+
+private:
+    bool ensureOpen();
+
+    std::vector<std::string> paths_;
+    std::vector<std::unique_ptr<DetectionHistory>> shards_;
+};
+
+// 把各分片 ATTACH 到 db 上（shard0、shard1……），并建立临时视图 all_detection_results（各分片
+// detection_results 的 UNION ALL）；SQLite 默认最多 ATTACH 10 个数据库，分片更多时用 ShardedHistory
+bool attachShards(sqlite3 *db, const std::vector<std::string> &paths);
+
+#endif // RK3588_DEMO_DETECTION_SHARDS_H
@@ -0,0 +1,737 @@
+#include "detection_writer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+
+#include "utils/logging.h"
+
+// 文本时间戳（本地时间 YYYYMMDDhhmmssSSS）在 SQL 中转为毫秒时间，用于迁移没有 ts 列的旧记录
+static const char *kTimestampMs =
+    "(CAST(strftime('%s', substr(timestamp, 1, 4) || '-' || substr(timestamp, 5, 2) || '-' || substr(timestamp, 7, 2) || ' ' ||"
+    " substr(timestamp, 9, 2) || ':' || substr(timestamp, 11, 2) || ':' || substr(timestamp, 13, 2), 'utc') AS INTEGER) * 1000"
+    " + CAST(substr(timestamp, 15, 3) AS INTEGER))";
+
+// 汇总表写入增量，与已有的行合并
+static const char *kRollupMerge =
+    " ON CONFLICT (bucket, device) DO UPDATE SET"
+    " max_count = max(max_count, excluded.max_count),"
+    " sum_count = sum_count + excluded.sum_count,"
+    " samples = samples + excluded.samples,"
+    " last_count = CASE WHEN excluded.last_ms >= last_ms THEN excluded.last_count ELSE last_count END,"
+    " last_ms = max(last_ms, excluded.last_ms);";
+
+static int64_t steadyMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int64_t DetectionWriter::nowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+DetectionWriter::~DetectionWriter() {
+    stop();
+}
+
+bool DetectionWriter::start(const Params &params) {
+    if (running_) return true;
+    params_ = params;
+    params_.batch_rows = std::max(1, params_.batch_rows);
+    params_.batch_ms = std::max(1, params_.batch_ms);
+    queue_.reset(new BoundedQueue<Record>(std::max<size_t>(16, params_.queue_size)));
+    if (params_.hot_hours > 0 && !hot_) {
+        hot_.reset(new HotWindow(params_.hot_hours, nowMs()));
+    }
+    if (!openDatabase()) {
+        closeDatabase();
+        return false;
+    }
+    stop_ = false;
+    running_ = true;
+    thread_ = std::thread(&DetectionWriter::run, this);
+    return true;
+}
+
+void DetectionWriter::stop() {
+    if (!running_) return;
+    stop_ = true;
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    running_ = false;
+}
+
+int DetectionWriter::addDevice(const std::string &id) {
+    std::lock_guard<std::mutex> lock(device_mutex_);
+    for (size_t i = 0; i < devices_.size(); i++) {
+        if (devices_[i] == id) return (int)i;
+    }
+    devices_.push_back(id);
+    return (int)devices_.size() - 1;
+}
+
+bool DetectionWriter::push(int device, int64_t time_ms, int count) {
+    if (!running_ || device < 0) return false;
+    if (!queue_->push({device, time_ms, count})) {
+        dropped_++;
+        return false;
+    }
+    return true;
+}
+
+DetectionWriter::Stats DetectionWriter::takeStats() {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    Stats stats = stats_;
+    stats.dropped = dropped_.exchange(0);
+    stats.avg_commit_ms = stats.transactions > 0 ? commit_ms_sum_ / stats.transactions : 0;
+    stats_ = Stats();
+    commit_ms_sum_ = 0;
+    return stats;
+}
+
+bool DetectionWriter::openDatabase() {
+    // 只有写线程使用这个连接，不需要 SQLite 的互斥锁
+    if (sqlite3_open_v2(params_.db_path.c_str(), &db_,
+                        SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_NOMUTEX, nullptr) != SQLITE_OK) {
+        NN_LOG_ERROR("detection writer: open %s failed: %s", params_.db_path.c_str(), sqlite3_errmsg(db_));
+        return false;
+    }
+    sqlite3_busy_timeout(db_, 5000);
+    sqlite3_exec(db_, "PRAGMA journal_mode=WAL;", nullptr, nullptr, nullptr);
+    sqlite3_exec(db_, "PRAGMA synchronous=NORMAL;", nullptr, nullptr, nullptr);
+
+    const char *create_sql = "CREATE TABLE IF NOT EXISTS detection_results ("
+                             "id INTEGER PRIMARY KEY AUTOINCREMENT,"
+                             "device TEXT NOT NULL,"
+                             "timestamp TEXT NOT NULL,"
+                             "box_count INTEGER NOT NULL,"
+                             "ts INTEGER);";
+    char *err = nullptr;
+    if (sqlite3_exec(db_, create_sql, nullptr, nullptr, &err) != SQLITE_OK) {
+        NN_LOG_ERROR("detection writer: create table failed: %s", err);
+        sqlite3_free(err);
+        return false;
+    }
+    // ts：毫秒时间（UTC），按时间查询和删除都走它的索引；timestamp 文本列保留给已有的查看方式。
+    // 旧版本建的表没有 ts 列，先加上，已有的行由写线程分批迁移
+    sqlite3_stmt *probe = nullptr;
+    if (sqlite3_prepare_v2(db_, "SELECT ts FROM detection_results LIMIT 0;", -1, &probe, nullptr) != SQLITE_OK) {
+        if (sqlite3_exec(db_, "ALTER TABLE detection_results ADD COLUMN ts INTEGER;", nullptr, nullptr, &err) != SQLITE_OK) {
+            NN_LOG_ERROR("detection writer: add ts column failed: %s", err);
+            sqlite3_free(err);
+            return false;
+        }
+    }
+    sqlite3_finalize(probe);
+    // 索引带上 box_count，时间范围内的统计只读索引（覆盖索引），不回表
+    NN_LOG_INFO("detection writer: checking indexes on %s", params_.db_path.c_str());
+    if (sqlite3_exec(db_, "CREATE INDEX IF NOT EXISTS idx_detection_results_ts ON detection_results (ts, box_count);"
+                          "CREATE INDEX IF NOT EXISTS idx_detection_results_device_ts ON detection_results (device, ts, box_count);",
+                     nullptr, nullptr, &err) != SQLITE_OK) {
+        NN_LOG_ERROR("detection writer: create index failed: %s", err);
+        sqlite3_free(err);
+        return false;
+    }
+
+    // 汇总表按 (桶, 设备) 存放，按时间范围查询和按保留期删除都是主键范围扫描。
+    // samples/sum_count 统计的是样本（isSample），与逐条记录模式下写入的记录相同，不随 change_only 变化
+    for (int level = 0; level < kRollupLevels; level++) {
+        std::string sql = std::string("CREATE TABLE IF NOT EXISTS ") + kRollupLevel[level].table + " ("
+                          "bucket INTEGER NOT NULL,"
+                          "device TEXT NOT NULL,"
+                          "max_count INTEGER NOT NULL,"
+                          "sum_count INTEGER NOT NULL,"
+                          "samples INTEGER NOT NULL,"
+                          "last_count INTEGER NOT NULL,"
+                          "last_ms INTEGER NOT NULL,"
+                          "PRIMARY KEY (bucket, device)) WITHOUT ROWID;";
+        if (sqlite3_exec(db_, sql.c_str(), nullptr, nullptr, &err) != SQLITE_OK) {
+            NN_LOG_ERROR("detection writer: create %s failed: %s", kRollupLevel[level].table, err);
+            sqlite3_free(err);
+            return false;
+        }
+    }
+
+    // 区间 [start_ms, end_ms) 内人数为 value，同一设备的区间互不重叠；只有一条记录的区间 start_ms = end_ms
+    if (sqlite3_exec(db_, "CREATE TABLE IF NOT EXISTS detection_spans ("
+                          "device TEXT NOT NULL,"
+                          "start_ms INTEGER NOT NULL,"
+                          "end_ms INTEGER NOT NULL,"
+                          "value INTEGER NOT NULL,"
+                          "PRIMARY KEY (device, start_ms)) WITHOUT ROWID;"
+                          "CREATE INDEX IF NOT EXISTS idx_detection_spans_end ON detection_spans (end_ms);",
+                     nullptr, nullptr, &err) != SQLITE_OK) {
+        NN_LOG_ERROR("detection writer: create detection_spans failed: %s", err);
+        sqlite3_free(err);
+        return false;
+    }
+
+    // 压缩序列块：[start_ms, end_ms] 为块中第一个和最后一个样本的时间，汇总列在 data 之前，只读汇总时不用读出 data
+    if (sqlite3_exec(db_, "CREATE TABLE IF NOT EXISTS detection_series ("
+                          "device TEXT NOT NULL,"
+                          "start_ms INTEGER NOT NULL,"
+                          "end_ms INTEGER NOT NULL,"
+                          "resolution_ms INTEGER NOT NULL,"
+                          "samples INTEGER NOT NULL,"
+                          "sum_count INTEGER NOT NULL,"
+                          "min_count INTEGER NOT NULL,"
+                          "max_count INTEGER NOT NULL,"
+                          "last_count INTEGER NOT NULL,"
+                          "data BLOB NOT NULL,"
+                          "PRIMARY KEY (device, start_ms));"
+                          "CREATE INDEX IF NOT EXISTS idx_detection_series_end ON detection_series (end_ms);",
+                     nullptr, nullptr, &err) != SQLITE_OK) {
+        NN_LOG_ERROR("detection writer: create detection_series failed: %s", err);
+        sqlite3_free(err);
+        return false;
+    }
+
+    // 预编译语句在写线程的整个生命周期内复用
+    const char *insert_sql = "INSERT INTO detection_results (device, timestamp, box_count, ts) VALUES (?, ?, ?, ?);";
+    // 按 ts 索引取最旧的 ?1 行，保留期内没有可删的数据时只读一个索引项
+    const char *raw_delete_sql = "DELETE FROM detection_results WHERE id IN (SELECT id FROM detection_results "
+                                 "WHERE ts < ?2 ORDER BY ts LIMIT ?1);";
+    // 迁移：一个 id 范围内还没有 ts 的旧记录由文本时间戳换算
+    std::string migrate_sql = std::string("UPDATE detection_results SET ts = ") + kTimestampMs +
+                              " WHERE id >= ?1 AND id < ?2 AND ts IS NULL;";
+    // 心跳和区间结束都是更新同一行的 end_ms
+    const char *span_sql = "INSERT INTO detection_spans (device, start_ms, end_ms, value) VALUES (?, ?, ?, ?)"
+                           " ON CONFLICT (device, start_ms) DO UPDATE SET end_ms = excluded.end_ms, value = excluded.value;";
+    const char *span_delete_sql = "DELETE FROM detection_spans WHERE (device, start_ms) IN (SELECT device, start_ms "
+                                  "FROM detection_spans WHERE end_ms < ?2 ORDER BY end_ms LIMIT ?1);";
+    // 没写满的块定期写入，之后同一块再写时覆盖
+    const char *series_sql = "INSERT OR REPLACE INTO detection_series (device, start_ms, end_ms, resolution_ms, samples,"
+                             " sum_count, min_count, max_count, last_count, data) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?);";
+    const char *series_delete_sql = "DELETE FROM detection_series WHERE rowid IN (SELECT rowid FROM detection_series "
+                                    "WHERE end_ms < ?2 LIMIT ?1);";
+    if (sqlite3_prepare_v2(db_, insert_sql, -1, &insert_stmt_, nullptr) != SQLITE_OK ||
+        sqlite3_prepare_v2(db_, series_sql, -1, &series_stmt_, nullptr) != SQLITE_OK ||
+        sqlite3_prepare_v2(db_, series_delete_sql, -1, &series_delete_stmt_, nullptr) != SQLITE_OK ||
+        sqlite3_prepare_v2(db_, span_sql, -1, &span_stmt_, nullptr) != SQLITE_OK ||
+        sqlite3_prepare_v2(db_, span_delete_sql, -1, &span_delete_stmt_, nullptr) != SQLITE_OK ||
+        sqlite3_prepare_v2(db_, "BEGIN;", -1, &begin_stmt_, nullptr) != SQLITE_OK ||
+        sqlite3_prepare_v2(db_, "COMMIT;", -1, &commit_stmt_, nullptr) != SQLITE_OK ||
+        sqlite3_prepare_v2(db_, raw_delete_sql, -1, &raw_delete_stmt_, nullptr) != SQLITE_OK ||
+        sqlite3_prepare_v2(db_, migrate_sql.c_str(), -1, &migrate_stmt_, nullptr) != SQLITE_OK) {
+        NN_LOG_ERROR("detection writer: prepare failed: %s", sqlite3_errmsg(db_));
+        return false;
+    }
+    for (int level = 0; level < kRollupLevels; level++) {
+        std::string table = kRollupLevel[level].table;
+        std::string seconds = std::to_string(kRollupLevel[level].seconds);
+        std::string upsert_sql = "INSERT INTO " + table +
+                                 " (bucket, device, max_count, sum_count, samples, last_count, last_ms)"
+                                 " VALUES (?, ?, ?, ?, ?, ?, ?)" + kRollupMerge;
+        std::string delete_sql = "DELETE FROM " + table + " WHERE (bucket, device) IN (SELECT bucket, device FROM " +
+                                 table + " WHERE bucket < ?2 LIMIT ?1);";
+        // 补建：一个 id 范围内的原始记录按桶分组；最后一条记录的时间和人数打包进同一个 max() 里取出
+        std::string backfill_sql = "INSERT INTO " + table +
+                                   " (bucket, device, max_count, sum_count, samples, last_count, last_ms)"
+                                   " SELECT ts / 1000 / " + seconds + " * " + seconds + " AS b, device, max(box_count),"
+                                   " sum(box_count), count(*), max(ts * 65536 + box_count) % 65536, max(ts)"
+                                   " FROM detection_results WHERE id >= ?1 AND id < ?2 AND ts IS NOT NULL"
+                                   " GROUP BY b, device" + kRollupMerge;
+        if (sqlite3_prepare_v2(db_, upsert_sql.c_str(), -1, &rollup_stmt_[level], nullptr) != SQLITE_OK ||
+            sqlite3_prepare_v2(db_, delete_sql.c_str(), -1, &rollup_delete_stmt_[level], nullptr) != SQLITE_OK ||
+            sqlite3_prepare_v2(db_, backfill_sql.c_str(), -1, &backfill_stmt_[level], nullptr) != SQLITE_OK) {
+            NN_LOG_ERROR("detection writer: prepare %s failed: %s", table.c_str(), sqlite3_errmsg(db_));
+            return false;
+        }
+    }
+    return initProgress();
+}
+
+// 后台任务的进度保存在 storage_meta 表中，中途退出后从断点继续：
+// ts_migrate      加上 ts 列时已有的行（ts 为空）分批换算 ts；
+// rollup_backfill 汇总表第一次建立时已有的行分批补建汇总，在迁移完成后进行（补建按 ts 分桶）。
+// 两者的范围都在第一次启动时确定，之后写入的记录已经带 ts 并直接累加汇总
+bool DetectionWriter::initProgress() {
+    char *err = nullptr;
+    if (sqlite3_exec(db_, "CREATE TABLE IF NOT EXISTS storage_meta (key TEXT PRIMARY KEY, value INTEGER NOT NULL);",
+                     nullptr, nullptr, &err) != SQLITE_OK) {
+        NN_LOG_ERROR("detection writer: create storage_meta failed: %s", err);
+        sqlite3_free(err);
+        return false;
+    }
+    if (sqlite3_prepare_v2(db_, "INSERT OR REPLACE INTO storage_meta (key, value) VALUES (?, ?);", -1,
+                           &meta_stmt_, nullptr) != SQLITE_OK) {
+        NN_LOG_ERROR("detection writer: prepare failed: %s", sqlite3_errmsg(db_));
+        return false;
+    }
+    loadRange("ts_migrate", "SELECT min(id), max(id) FROM detection_results WHERE ts IS NULL;", migrate_);
+    loadRange("rollup_backfill", "SELECT min(id), max(id) FROM detection_results;", backfill_);
+    if (migrate_.next < migrate_.end) {
+        NN_LOG_INFO("detection writer: migrating timestamps of %lld existing rows in the background",
+                    (long long)(migrate_.end - migrate_.next));
+    }
+    if (backfill_.next < backfill_.end) {
+        NN_LOG_INFO("detection writer: building rollups for %lld existing rows in the background",
+                    (long long)(backfill_.end - backfill_.next));
+    }
+    return true;
+}
+
+void DetectionWriter::loadRange(const std::string &name, const char *init_sql, IdRange &range) {
+    range = IdRange();
+    bool found = false;
+    sqlite3_stmt *stmt = nullptr;
+    sqlite3_prepare_v2(db_, "SELECT (SELECT value FROM storage_meta WHERE key = ?1),"
+                            " (SELECT value FROM storage_meta WHERE key = ?2);", -1, &stmt, nullptr);
+    if (stmt) {
+        std::string next_key = name + "_next", end_key = name + "_end";
+        sqlite3_bind_text(stmt, 1, next_key.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, 2, end_key.c_str(), -1, SQLITE_TRANSIENT);
+        if (sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_type(stmt, 0) != SQLITE_NULL) {
+            range.next = sqlite3_column_int64(stmt, 0);
+            range.end = sqlite3_column_int64(stmt, 1);
+            found = true;
+        }
+    }
+    sqlite3_finalize(stmt);
+    if (found) return;
+
+    stmt = nullptr;
+    sqlite3_prepare_v2(db_, init_sql, -1, &stmt, nullptr);
+    if (stmt && sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_type(stmt, 0) != SQLITE_NULL) {
+        range.next = sqlite3_column_int64(stmt, 0);
+        range.end = sqlite3_column_int64(stmt, 1) + 1;
+    }
+    sqlite3_finalize(stmt);
+    setMeta((name + "_next").c_str(), range.next);
+    setMeta((name + "_end").c_str(), range.end);
+}
+
+void DetectionWriter::setMeta(const char *key, int64_t value) {
+    sqlite3_bind_text(meta_stmt_, 1, key, -1, SQLITE_STATIC);
+    sqlite3_bind_int64(meta_stmt_, 2, value);
+    if (sqlite3_step(meta_stmt_) != SQLITE_DONE) {
+        NN_LOG_ERROR("detection writer: update storage_meta failed: %s", sqlite3_errmsg(db_));
+    }
+    sqlite3_reset(meta_stmt_);
+}
+
+// 处理范围内的下一批 id：各条语句和进度在同一个事务里；没有剩余时返回 false
+bool DetectionWriter::rangeStep(const std::string &name, IdRange &range, sqlite3_stmt *const *stmts, int count) {
+    static const int64_t kStepRows = 5000;
+    if (range.next >= range.end) return false;
+    int64_t hi = std::min(range.end, range.next + kStepRows);
+    sqlite3_exec(db_, "BEGIN;", nullptr, nullptr, nullptr);
+    for (int i = 0; i < count; i++) {
+        sqlite3_bind_int64(stmts[i], 1, range.next);
+        sqlite3_bind_int64(stmts[i], 2, hi);
+        if (sqlite3_step(stmts[i]) != SQLITE_DONE) {
+            NN_LOG_ERROR("detection writer: %s failed: %s", name.c_str(), sqlite3_errmsg(db_));
+        }
+        sqlite3_reset(stmts[i]);
+    }
+    setMeta((name + "_next").c_str(), hi);
+    sqlite3_exec(db_, "COMMIT;", nullptr, nullptr, nullptr);
+    range.next = hi;
+    if (range.next >= range.end) {
+        NN_LOG_INFO("detection writer: %s of existing rows complete", name.c_str());
+    }
+    return true;
+}
+
+bool DetectionWriter::backgroundStep() {
+    if (rangeStep("ts_migrate", migrate_, &migrate_stmt_, 1)) return true;
+    return rangeStep("rollup_backfill", backfill_, backfill_stmt_, kRollupLevels);
+}
+
+void DetectionWriter::closeDatabase() {
+    sqlite3_finalize(insert_stmt_);
+    sqlite3_finalize(begin_stmt_);
+    sqlite3_finalize(commit_stmt_);
+    sqlite3_finalize(raw_delete_stmt_);
+    sqlite3_finalize(migrate_stmt_);
+    sqlite3_finalize(span_stmt_);
+    sqlite3_finalize(span_delete_stmt_);
+    insert_stmt_ = begin_stmt_ = commit_stmt_ = raw_delete_stmt_ = migrate_stmt_ = nullptr;
+    span_stmt_ = span_delete_stmt_ = nullptr;
+    sqlite3_finalize(series_stmt_);
+    sqlite3_finalize(series_delete_stmt_);
+    series_stmt_ = series_delete_stmt_ = nullptr;
+    sqlite3_finalize(meta_stmt_);
+    meta_stmt_ = nullptr;
+    for (int level = 0; level < kRollupLevels; level++) {
+        sqlite3_finalize(rollup_stmt_[level]);
+        sqlite3_finalize(rollup_delete_stmt_[level]);
+        sqlite3_finalize(backfill_stmt_[level]);
+        rollup_stmt_[level] = rollup_delete_stmt_[level] = backfill_stmt_[level] = nullptr;
+    }
+    if (db_) {
+        sqlite3_close(db_);
+        db_ = nullptr;
+    }
+}
+
+void DetectionWriter::begin() {
+    if (sqlite3_step(begin_stmt_) != SQLITE_DONE) {
+        NN_LOG_ERROR("detection writer: BEGIN failed: %s", sqlite3_errmsg(db_));
+    }
+    sqlite3_reset(begin_stmt_);
+    in_transaction_ = true;
+    transaction_rows_ = 0;
+    transaction_start_ = steadyMicros();
+}
+
+void DetectionWriter::commit() {
+    flushRollups();
+    int64_t start = steadyMicros();
+    if (sqlite3_step(commit_stmt_) != SQLITE_DONE) {
+        NN_LOG_ERROR("detection writer: COMMIT failed: %s", sqlite3_errmsg(db_));
+    }
+    sqlite3_reset(commit_stmt_);
+    double ms = (steadyMicros() - start) / 1000.0;
+    in_transaction_ = false;
+
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    stats_.rows += transaction_rows_;
+    stats_.transactions++;
+    commit_ms_sum_ += ms;
+    stats_.max_commit_ms = std::max(stats_.max_commit_ms, ms);
+}
+
+const std::string &DetectionWriter::deviceName(int device) {
+    if (device >= (int)local_devices_.size()) {
+        std::lock_guard<std::mutex> lock(device_mutex_);
+        local_devices_.assign(devices_.begin(), devices_.end());
+    }
+    static const std::string unknown = "unknown_device";
+    return device < (int)local_devices_.size() ? local_devices_[device] : unknown;
+}
+
+// 与原来的 GetCurrentTimestamp 相同的格式（本地时间 YYYYMMDDhhmmssSSS），同一秒内只调用一次 localtime
+const char *DetectionWriter::formatTimestamp(int64_t time_ms) {
+    int64_t second = time_ms / 1000;
+    if (second != cached_second_) {
+        time_t t = (time_t)second;
+        std::tm bt;
+        localtime_r(&t, &bt);
+        strftime(timestamp_, sizeof(timestamp_), "%Y%m%d%H%M%S", &bt);
+        cached_second_ = second;
+    }
+    snprintf(timestamp_ + 14, sizeof(timestamp_) - 14, "%03d", (int)(time_ms % 1000));
+    return timestamp_;
+}
+
+void DetectionWriter::insert(const Record &record) {
+    if (params_.change_only) {
+        trackSpan(record);
+    }
+    if (!isSample(record)) return;
+    if (!params_.change_only) {
+        insertRow(record);
+    }
+    if (params_.series) {
+        trackSeries(record);
+    }
+    transaction_rows_++;
+    accumulate(record);
+}
+
+void DetectionWriter::insertRow(const Record &record) {
+    const std::string &device = deviceName(record.device);
+    sqlite3_bind_text(insert_stmt_, 1, device.c_str(), (int)device.size(), SQLITE_STATIC);
+    sqlite3_bind_text(insert_stmt_, 2, formatTimestamp(record.time_ms), 17, SQLITE_TRANSIENT);
+    sqlite3_bind_int(insert_stmt_, 3, record.count);
+    sqlite3_bind_int64(insert_stmt_, 4, record.time_ms);
+    if (sqlite3_step(insert_stmt_) != SQLITE_DONE) {
+        NN_LOG_ERROR("detection writer: insert failed: %s", sqlite3_errmsg(db_));
+    }
+    sqlite3_reset(insert_stmt_);
+}
+
+void DetectionWriter::trackSpan(const Record &record) {
+    if (record.device >= (int)spans_.size()) {
+        spans_.resize(record.device + 1);
+    }
+    Span &span = spans_[record.device];
+    const int64_t heartbeat = std::max(1, params_.heartbeat_ms);
+    // 乱序到达的记录按当前区间的结束时间处理，保持区间不重叠
+    const int64_t time_ms = span.start_ms >= 0 ? std::max(record.time_ms, span.end_ms) : record.time_ms;
+    const bool continuous = span.start_ms >= 0 && time_ms - span.end_ms <= heartbeat;
+
+    if (continuous && record.count == span.value) {
+        span.end_ms = time_ms;
+        if (span.end_ms - span.written_end_ms >= heartbeat) writeSpan(record.device);
+        return;
+    }
+    if (span.start_ms >= 0) {
+        // 人数变化时旧区间延续到这条记录；中间有空档时在前一条记录处结束
+        if (continuous) span.end_ms = time_ms;
+        writeSpan(record.device);
+    }
+    span.start_ms = span.end_ms = time_ms;
+    span.value = record.count;
+    writeSpan(record.device);
+}
+
+void DetectionWriter::writeSpan(int device) {
+    Span &span = spans_[device];
+    const std::string &name = deviceName(device);
+    sqlite3_bind_text(span_stmt_, 1, name.c_str(), (int)name.size(), SQLITE_STATIC);
+    sqlite3_bind_int64(span_stmt_, 2, span.start_ms);
+    sqlite3_bind_int64(span_stmt_, 3, span.end_ms);
+    sqlite3_bind_int(span_stmt_, 4, span.value);
+    if (sqlite3_step(span_stmt_) != SQLITE_DONE) {
+        NN_LOG_ERROR("detection writer: update detection_spans failed: %s", sqlite3_errmsg(db_));
+    }
+    sqlite3_reset(span_stmt_);
+    span.written_end_ms = span.end_ms;
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    stats_.span_writes++;
+}
+
+// 退出前把各区间最新的结束时间写入
+void DetectionWriter::flushSpans() {
+    for (int device = 0; device < (int)spans_.size(); device++) {
+        const Span &span = spans_[device];
+        if (span.start_ms < 0 || span.end_ms == span.written_end_ms) continue;
+        if (!in_transaction_) begin();
+        writeSpan(device);
+    }
+}
+
+void DetectionWriter::accumulate(const Record &record) {
+    if (record.device >= (int)buckets_.size()) {
+        buckets_.resize(record.device + 1, std::vector<Bucket>(kRollupLevels));
+    }
+    CountAggregate sample;
+    sample.samples = 1;
+    sample.sum = record.count;
+    sample.max = record.count;
+    sample.last = record.count;
+    sample.last_ms = record.time_ms;
+
+    const int64_t second = record.time_ms / 1000;
+    for (int level = 0; level < kRollupLevels; level++) {
+        Bucket &bucket = buckets_[record.device][level];
+        int64_t start = second / kRollupLevel[level].seconds * kRollupLevel[level].seconds;
+        if (bucket.start != start) {
+            // 进入新的桶：上一个桶的增量先写入
+            flushRollup(record.device, level);
+            bucket.start = start;
+        }
+        bucket.delta.add(sample);
+    }
+}
+
+void DetectionWriter::flushRollup(int device, int level) {
+    Bucket &bucket = buckets_[device][level];
+    if (bucket.delta.samples == 0) return;
+    sqlite3_stmt *stmt = rollup_stmt_[level];
+    const std::string &name = deviceName(device);
+    sqlite3_bind_int64(stmt, 1, bucket.start);
+    sqlite3_bind_text(stmt, 2, name.c_str(), (int)name.size(), SQLITE_STATIC);
+    sqlite3_bind_int(stmt, 3, bucket.delta.max);
+    sqlite3_bind_int64(stmt, 4, bucket.delta.sum);
+    sqlite3_bind_int64(stmt, 5, bucket.delta.samples);
+    sqlite3_bind_int(stmt, 6, bucket.delta.last);
+    sqlite3_bind_int64(stmt, 7, bucket.delta.last_ms);
+    if (sqlite3_step(stmt) != SQLITE_DONE) {
+        NN_LOG_ERROR("detection writer: update %s failed: %s", kRollupLevel[level].table, sqlite3_errmsg(db_));
+    }
+    sqlite3_reset(stmt);
+    bucket.delta = CountAggregate();
+}
+
+// 提交前把所有桶的增量写入，汇总表和原始记录在同一个事务里
+void DetectionWriter::flushRollups() {
+    for (int device = 0; device < (int)buckets_.size(); device++) {
+        for (int level = 0; level < kRollupLevels; level++) {
+            flushRollup(device, level);
+        }
+    }
+}
+
+void DetectionWriter::trackSeries(const Record &record) {
+    if (record.device >= (int)series_.size()) {
+        series_.resize(record.device + 1, SeriesEncoder(std::max(256, params_.series_block_bytes)));
+    }
+    SeriesEncoder &encoder = series_[record.device];
+    const int64_t tick = record.time_ms / std::max(1, params_.series_resolution_ms);
+    if (!encoder.append(tick, record.count)) {
+        // 块写满：写入后从这个样本开始新块
+        writeSeries(record.device);
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        stats_.series_bytes += encoder.finish().size();
+        encoder.reset();
+        encoder.append(tick, record.count);
+    }
+}
+
+void DetectionWriter::writeSeries(int device) {
+    const SeriesEncoder &encoder = series_[device];
+    if (encoder.empty()) return;
+    const int64_t resolution = std::max(1, params_.series_resolution_ms);
+    const std::vector<uint8_t> data = encoder.finish();
+    const std::string &name = deviceName(device);
+    sqlite3_bind_text(series_stmt_, 1, name.c_str(), (int)name.size(), SQLITE_STATIC);
+    sqlite3_bind_int64(series_stmt_, 2, encoder.firstTick() * resolution);
+    sqlite3_bind_int64(series_stmt_, 3, encoder.lastTick() * resolution);
+    sqlite3_bind_int64(series_stmt_, 4, resolution);
+    sqlite3_bind_int64(series_stmt_, 5, encoder.samples());
+    sqlite3_bind_int64(series_stmt_, 6, encoder.sum());
+    sqlite3_bind_int(series_stmt_, 7, encoder.min());
+    sqlite3_bind_int(series_stmt_, 8, encoder.max());
+    sqlite3_bind_int(series_stmt_, 9, encoder.last());
+    sqlite3_bind_blob(series_stmt_, 10, data.data(), (int)data.size(), SQLITE_TRANSIENT);
+    if (sqlite3_step(series_stmt_) != SQLITE_DONE) {
+        NN_LOG_ERROR("detection writer: update detection_series failed: %s", sqlite3_errmsg(db_));
+    }
+    sqlite3_reset(series_stmt_);
+}
+
+// 没写满的块定期写入；退出时也调用
+void DetectionWriter::flushSeries() {
+    for (int device = 0; device < (int)series_.size(); device++) {
+        if (series_[device].empty()) continue;
+        if (!in_transaction_) begin();
+        writeSeries(device);
+    }
+    last_series_flush_ = steadyMicros();
+}
+
+int DetectionWriter::deleteBatch(sqlite3_stmt *stmt) {
+    int deleted = 0;
+    if (sqlite3_step(stmt) == SQLITE_DONE) {
+        deleted = sqlite3_changes(db_);
+    } else {
+        NN_LOG_ERROR("detection writer: retention delete failed: %s", sqlite3_errmsg(db_));
+    }
+    sqlite3_reset(stmt);
+    return deleted;
+}
+
+// 每次最多删除几批，每批单独提交，不长时间占用写锁
+void DetectionWriter::enforceRetention() {
+    static const int kMaxBatches = 10;
+    const int64_t now_ms = nowMs();
+    const int batch = std::max(1, params_.retention_batch);
+    uint64_t deleted = 0;
+
+    if (params_.raw_retention_hours > 0) {
+        int64_t cutoff = now_ms - (int64_t)params_.raw_retention_hours * 3600 * 1000;
+        for (int i = 0; i < kMaxBatches; i++) {
+            sqlite3_bind_int(raw_delete_stmt_, 1, batch);
+            sqlite3_bind_int64(raw_delete_stmt_, 2, cutoff);
+            int n = deleteBatch(raw_delete_stmt_);
+            deleted += n;
+            if (n < batch) break;
+        }
+    }
+    for (int level = 0; level < kRollupLevels; level++) {
+        if (params_.retention_hours[level] <= 0) continue;
+        int64_t cutoff = now_ms / 1000 - (int64_t)params_.retention_hours[level] * 3600;
+        for (int i = 0; i < kMaxBatches; i++) {
+            sqlite3_bind_int(rollup_delete_stmt_[level], 1, batch);
+            sqlite3_bind_int64(rollup_delete_stmt_[level], 2, cutoff);
+            int n = deleteBatch(rollup_delete_stmt_[level]);
+            deleted += n;
+            if (n < batch) break;
+        }
+    }
+
+    if (params_.series_retention_hours > 0) {
+        int64_t cutoff = now_ms - (int64_t)params_.series_retention_hours * 3600 * 1000;
+        for (int i = 0; i < kMaxBatches; i++) {
+            sqlite3_bind_int(series_delete_stmt_, 1, batch);
+            sqlite3_bind_int64(series_delete_stmt_, 2, cutoff);
+            int n = deleteBatch(series_delete_stmt_);
+            deleted += n;
+            if (n < batch) break;
+        }
+    }
+    if (params_.raw_retention_hours > 0) {
+        int64_t cutoff = now_ms - (int64_t)params_.raw_retention_hours * 3600 * 1000;
+        for (int i = 0; i < kMaxBatches; i++) {
+            sqlite3_bind_int(span_delete_stmt_, 1, batch);
+            sqlite3_bind_int64(span_delete_stmt_, 2, cutoff);
+            int n = deleteBatch(span_delete_stmt_);
+            deleted += n;
+            if (n < batch) break;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    stats_.deleted += deleted;
+}
+
+// 记录进入热数据层时返回 true（之后由 flushPending 写盘）；不算样本的记录不进热数据层，
+// 但覆盖范围内的仍排进 pending_，保持与前后记录的顺序
+bool DetectionWriter::appendHot(const Record &record) {
+    if (isSample(record)) {
+        return hot_->append(record.device, deviceName(record.device), record.time_ms, record.count);
+    }
+    return record.time_ms >= hot_->coverageStart();
+}
+
+// 热数据层中的记录在一个事务中顺序写入
+void DetectionWriter::flushPending() {
+    last_flush_ = steadyMicros();
+    if (pending_.empty()) return;
+    if (!in_transaction_) begin();
+    for (const Record &record : pending_) {
+        insert(record);
+    }
+    commit();
+    pending_.clear();
+}
+
+void DetectionWriter::run() {
+    // 热数据层攒下的记录过多时提前写盘，限制内存
+    static const size_t kMaxPendingRows = 1 << 18;
+    const int64_t batch_us = (int64_t)params_.batch_ms * 1000;
+    const int64_t flush_us = (int64_t)std::max(1, params_.flush_ms) * 1000;
+    last_flush_ = steadyMicros();
+    Record record;
+    for (;;) {
+        bool stopping = stop_;
+        int popped = 0;
+        while (popped < params_.batch_rows && queue_->pop(record)) {
+            popped++;
+            // 热数据层起点之后的记录先留在内存中；更早的（刚启动的不足一秒、晚到的）照常写入
+            if (hot_ && appendHot(record)) {
+                pending_.push_back(record);
+                continue;
+            }
+            if (!in_transaction_) begin();
+            insert(record);
+            if (transaction_rows_ >= params_.batch_rows) commit();
+        }
+        if (stopping || pending_.size() >= kMaxPendingRows || steadyMicros() - last_flush_ >= flush_us) {
+            flushPending();
+        }
+        if (params_.series && steadyMicros() - last_series_flush_ >= (int64_t)params_.series_flush_ms * 1000) {
+            flushSeries();
+        }
+        if (in_transaction_ && (stopping || steadyMicros() - transaction_start_ >= batch_us)) {
+            commit();
+        }
+        // stop 之前放入的记录在这一轮已经全部取出
+        if (stopping && popped == 0) break;
+        if (popped == 0 && !in_transaction_) {
+            // 空闲时：先迁移旧数据、补建汇总，再按保留期删除
+            if (backgroundStep()) continue;
+            if (steadyMicros() - last_retention_ >= 10 * 1000000LL) {
+                enforceRetention();
+                last_retention_ = steadyMicros();
+            }
+        }
+        if (popped == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+    }
+    flushPending();
+    flushSpans();
+    flushSeries();
+    if (in_transaction_) commit();
+    closeDatabase();
+    buckets_.clear();
+    spans_.clear();
+    series_.clear();
+}
@@ -0,0 +1,197 @@
+// 检测结果异步写入：摄像头线程只把记录放进有界无锁队列，专用写线程持有自己的连接和预编译语句，
+// 每 batch_rows 行或 batch_ms 毫秒提交一个事务；队列满时丢弃并计数，摄像头线程不会因为存储 I/O 阻塞。
+// 写线程同时增量维护每个设备的秒/分钟/小时汇总表，并在空闲时按保留期分小批删除旧数据。
+// 时间存为整数毫秒（ts 列，带覆盖索引），旧版本的文本时间戳记录在后台分批迁移。
+// change_only 模式下不写逐条记录，只在人数变化或心跳时写 (开始, 结束, 人数) 区间（detection_spans 表）。
+// series 打开时另把每个设备的人数序列压缩成固定大小的块（detection_series 表，见 series_codec.h），用于长期保存。
+// hot_hours 大于 0 时记录先进入内存中的热数据层（HotWindow，最近的查询在内存中完成），每 flush_ms 在一个事务中批量写盘
+
+#ifndef RK3588_DEMO_DETECTION_WRITER_H
+#define RK3588_DEMO_DETECTION_WRITER_H
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sqlite3.h>
+
+#include "bounded_queue.h"
+#include "hot_window.h"
+#include "rollup.h"
+#include "series_codec.h"
+
+class DetectionWriter {
+public:
+    struct Params {
+        std::string db_path = "./detection_results.db";
+        size_t queue_size = 8192;  // 队列容量（条），决定内存上限
+        int batch_rows = 500;      // 一个事务最多写入的行数
+        int batch_ms = 1000;       // 事务最长持续时间，也是崩溃时最多丢失的时间
+        // 保留期（小时），0 为永久保留；超过保留期的数据每 10 秒检查一次，每批最多删除 retention_batch 行
+        int raw_retention_hours = 24 * 7;       // 原始记录
+        int retention_hours[kRollupLevels] = {24 * 7, 24 * 90, 0};  // 秒/分钟/小时汇总
+        int retention_batch = 1000;
+        // 只记录变化：人数不变时只延长当前区间，每 heartbeat_ms 把区间的结束时间写入一次，
+        // 崩溃时最多丢失这段时间的延长；两条记录间隔超过 heartbeat_ms 时区间在前一条记录处断开
+        bool change_only = false;
+        int heartbeat_ms = 60 * 1000;
+        // 0 人的记录不算样本：不写逐条记录，也不计入汇总、压缩序列和热数据层，两种模式下汇总的样本相同；
+        // change_only 模式下仍按顺序用来结束当前区间（否则 5、0、5 会连成一个 5 人的区间）
+        bool skip_zero = false;
+        // 压缩序列：时间量化到 series_resolution_ms，每块最多 series_block_bytes 字节；
+        // 没写满的块每 series_flush_ms 写入一次（崩溃时最多丢失这段时间）
+        bool series = false;
+        int series_resolution_ms = 100;
+        int series_block_bytes = 4096;
+        int series_flush_ms = 60 * 1000;
+        int series_retention_hours = 0;
+        // 热数据层：内存中保留每个设备最近 hot_hours 小时的记录（约 16 字节/条），0 为关闭；
+        // 打开时记录每 flush_ms 写盘一次（崩溃时最多丢失这段时间），正常退出时全部写完，batch_rows/batch_ms 只用于
+        // 早于热数据层起点的记录
+        int hot_hours = 0;
+        int flush_ms = 60 * 1000;
+    };
+
+    struct Stats {
+        uint64_t rows = 0;          // 上次取统计以来写入的记录数
+        uint64_t span_writes = 0;   // change_only 模式下区间的写入次数
+        uint64_t series_bytes = 0;  // 写满的压缩块的字节数
+        uint64_t dropped = 0;       // 队列满丢弃的行数
+        uint64_t transactions = 0;
+        uint64_t deleted = 0;       // 按保留期删除的行数（原始记录和汇总）
+        double avg_commit_ms = 0;   // COMMIT 耗时（WAL 写盘）
+        double max_commit_ms = 0;
+    };
+
+    DetectionWriter() = default;
+    ~DetectionWriter();
+
+    DetectionWriter(const DetectionWriter &) = delete;
+    DetectionWriter &operator=(const DetectionWriter &) = delete;
+
+    // 打开数据库并启动写线程
+    bool start(const Params &params);
+    // 写完队列中剩余的记录、提交事务后返回
+    void stop();
+    bool running() const { return running_; }
+
+    // 注册设备名，返回写入时使用的编号；同名设备返回同一个编号
+    int addDevice(const std::string &id);
+
+    // 放入一条记录，time_ms 为系统时间（毫秒）；队列满返回 false，任何线程都可以调用且不会阻塞
+    bool push(int device, int64_t time_ms, int count);
+
+    Stats takeStats();
+
+    // 热数据层，没有打开时为 nullptr；start 时创建，之后一直有效到写入器析构
+    const HotWindow *hotWindow() const { return hot_.get(); }
+
+    static int64_t nowMs();
+
+private:
+    struct Record {
+        int device;
+        int64_t time_ms;
+        int count;
+    };
+
+    void run();
+    bool openDatabase();
+    void closeDatabase();
+    void begin();
+    void commit();
+    void insert(const Record &record);
+    bool isSample(const Record &record) const { return record.count > 0 || !params_.skip_zero; }
+    bool appendHot(const Record &record);
+    void insertRow(const Record &record);
+    void trackSpan(const Record &record);
+    void writeSpan(int device);
+    void flushSpans();
+    void trackSeries(const Record &record);
+    void writeSeries(int device);
+    void flushSeries();
+    void flushPending();
+    void accumulate(const Record &record);
+    void flushRollup(int device, int level);
+    void flushRollups();
+    void enforceRetention();
+    int deleteBatch(sqlite3_stmt *stmt);
+    // 后台分批处理的原始记录 id 范围 [next, end)
+    struct IdRange {
+        int64_t next = 0;
+        int64_t end = 0;
+    };
+    bool initProgress();
+    void loadRange(const std::string &name, const char *init_sql, IdRange &range);
+    bool rangeStep(const std::string &name, IdRange &range, sqlite3_stmt *const *stmts, int count);
+    bool backgroundStep();
+    void setMeta(const char *key, int64_t value);
+    const std::string &deviceName(int device);
+    const char *formatTimestamp(int64_t time_ms);
+
+    Params params_;
+    std::unique_ptr<BoundedQueue<Record>> queue_;
+    std::unique_ptr<HotWindow> hot_;
+    std::thread thread_;
+    std::atomic<bool> running_{false};
+    std::atomic<bool> stop_{false};
+
+    std::mutex device_mutex_;
+    std::deque<std::string> devices_;      // 注册的设备名（deque 扩容时已有元素不移动）
+    std::vector<std::string> local_devices_;  // 写线程的副本
+
+    // 以下只在写线程中使用
+    sqlite3 *db_ = nullptr;
+    sqlite3_stmt *insert_stmt_ = nullptr;
+    sqlite3_stmt *begin_stmt_ = nullptr;
+    sqlite3_stmt *commit_stmt_ = nullptr;
+    sqlite3_stmt *rollup_stmt_[kRollupLevels] = {};
+    sqlite3_stmt *raw_delete_stmt_ = nullptr;
+    sqlite3_stmt *migrate_stmt_ = nullptr;
+    sqlite3_stmt *span_stmt_ = nullptr;
+    sqlite3_stmt *span_delete_stmt_ = nullptr;
+    sqlite3_stmt *series_stmt_ = nullptr;
+    sqlite3_stmt *series_delete_stmt_ = nullptr;
+    sqlite3_stmt *rollup_delete_stmt_[kRollupLevels] = {};
+    sqlite3_stmt *backfill_stmt_[kRollupLevels] = {};
+    sqlite3_stmt *meta_stmt_ = nullptr;
+    bool in_transaction_ = false;
+    int transaction_rows_ = 0;
+    int64_t transaction_start_ = 0;  // 稳定时钟，微秒
+    int64_t cached_second_ = -1;     // formatTimestamp 缓存的秒
+    char timestamp_[32] = {0};
+
+    // 每个设备每一级汇总当前桶中还没写入数据库的增量
+    struct Bucket {
+        int64_t start = -1;  // 桶起始时间，秒
+        CountAggregate delta;
+    };
+    std::vector<std::vector<Bucket>> buckets_;  // [device][level]
+    // change_only 模式下每个设备当前的区间
+    struct Span {
+        int64_t start_ms = -1;  // -1 表示还没有区间
+        int64_t end_ms = -1;
+        int64_t written_end_ms = -1;  // 数据库中的结束时间
+        int value = 0;
+    };
+    std::vector<Span> spans_;
+    std::vector<SeriesEncoder> series_;  // 每个设备正在写的压缩块
+    int64_t last_series_flush_ = 0;      // 稳定时钟，微秒
+    std::vector<Record> pending_;        // 已进入热数据层、还没写盘的记录
+    int64_t last_flush_ = 0;             // 稳定时钟，微秒
+    int64_t last_retention_ = 0;                // 稳定时钟，微秒
+    IdRange migrate_;                           // 待换算 ts 的旧记录
+    IdRange backfill_;                          // 待补建汇总的旧记录
+
+    std::mutex stats_mutex_;
+    Stats stats_;
+    double commit_ms_sum_ = 0;
+    std::atomic<uint64_t> dropped_{0};
+};
+
+#endif // RK3588_DEMO_DETECTION_WRITER_H
@@ -0,0 +1,112 @@
+#include "hot_window.h"
+
+#include <algorithm>
+
+const int64_t HotWindow::kBucketMs;
+
+HotWindow::HotWindow(int hours, int64_t start_ms)
+    : window_ms_((int64_t)std::max(1, hours) * 3600 * 1000), coverage_start_((start_ms + 999) / 1000 * 1000) {}
+
+bool HotWindow::append(int device, const std::string &name, int64_t time_ms, int count) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (time_ms < coverage_start_) return false;
+    if (device >= (int)devices_.size()) {
+        devices_.resize(device + 1);
+    }
+    Device &entry = devices_[device];
+    if (entry.name.empty()) entry.name = name;
+    std::deque<Sample> &samples = entry.samples;
+    if (samples.empty() || samples.back().time_ms <= time_ms) {
+        samples.push_back({time_ms, count});
+    } else {
+        // 乱序到达的记录插到对应位置，很少发生
+        auto pos = std::upper_bound(samples.begin(), samples.end(), time_ms,
+                                    [](int64_t t, const Sample &sample) { return t < sample.time_ms; });
+        samples.insert(pos, {time_ms, count});
+    }
+    size_++;
+
+    CountAggregate sample;
+    sample.samples = 1;
+    sample.sum = count;
+    sample.max = count;
+    sample.last = count;
+    sample.last_ms = time_ms;
+    const int64_t bucket_start = time_ms / kBucketMs * kBucketMs;
+    std::deque<Bucket> &buckets = entry.buckets;
+    if (buckets.empty() || buckets.back().start_ms < bucket_start) {
+        buckets.push_back({bucket_start, sample});
+    } else {
+        auto pos = std::lower_bound(buckets.begin(), buckets.end(), bucket_start,
+                                    [](const Bucket &bucket, int64_t t) { return bucket.start_ms < t; });
+        if (pos == buckets.end() || pos->start_ms != bucket_start) {
+            pos = buckets.insert(pos, {bucket_start, CountAggregate()});
+        }
+        pos->total.add(sample);
+    }
+
+    // 按整分钟丢弃超出时间窗的记录，分钟汇总与记录始终一致；之后内存中只有 cutoff 之后的记录是完整的
+    const int64_t cutoff = (time_ms - window_ms_) / kBucketMs * kBucketMs;
+    if (samples.front().time_ms < cutoff) {
+        while (!samples.empty() && samples.front().time_ms < cutoff) {
+            samples.pop_front();
+            size_--;
+        }
+        while (!buckets.empty() && buckets.front().start_ms < cutoff) {
+            buckets.pop_front();
+        }
+        coverage_start_ = std::max(coverage_start_, cutoff);
+    }
+    return true;
+}
+
+int64_t HotWindow::coverageStart() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return coverage_start_;
+}
+
+size_t HotWindow::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return size_;
+}
+
+void HotWindow::collectSamples(const Device &device, int64_t from_ms, int64_t to_ms, CountAggregate &out) {
+    if (from_ms >= to_ms) return;
+    const std::deque<Sample> &samples = device.samples;
+    auto it = std::lower_bound(samples.begin(), samples.end(), from_ms,
+                               [](const Sample &sample, int64_t t) { return sample.time_ms < t; });
+    CountAggregate part;
+    for (; it != samples.end() && it->time_ms < to_ms; ++it) {
+        part.max = part.samples > 0 ? std::max(part.max, it->count) : it->count;
+        part.samples++;
+        part.sum += it->count;
+        part.last = it->count;
+        part.last_ms = it->time_ms;
+    }
+    out.add(part);
+}
+
+// 整分钟用分钟汇总，两端不满一分钟的部分逐条统计
+void HotWindow::collect(const Device &device, int64_t from_ms, int64_t to_ms, CountAggregate &out) {
+    const int64_t first = (from_ms + kBucketMs - 1) / kBucketMs * kBucketMs;
+    const int64_t last = to_ms / kBucketMs * kBucketMs;
+    if (first >= last) {
+        collectSamples(device, from_ms, to_ms, out);
+        return;
+    }
+    collectSamples(device, from_ms, first, out);
+    const std::deque<Bucket> &buckets = device.buckets;
+    auto it = std::lower_bound(buckets.begin(), buckets.end(), first,
+                               [](const Bucket &bucket, int64_t t) { return bucket.start_ms < t; });
+    for (; it != buckets.end() && it->start_ms < last; ++it) {
+        out.add(it->total);
+    }
+    collectSamples(device, last, to_ms, out);
+}
+
+void HotWindow::aggregate(const std::string &device, int64_t from_ms, int64_t to_ms, CountAggregate &out) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const Device &entry : devices_) {
+        if (device.empty() || entry.name == device) collect(entry, from_ms, to_ms, out);
+    }
+}
@@ -0,0 +1,61 @@
+// 热数据层：每个设备最近 hours 小时的记录按时间顺序保存在内存中，最近一段时间的查询直接在内存中统计，不读数据库。
+// 记录由 DetectionWriter 的写线程追加（同时攒起来按间隔批量写盘），查询可以在任何线程；
+// coverageStart() 之后的记录内存中一条不缺，之前的只在数据库中，DetectionHistory 按这个时间把查询拆成两段。
+// 每个设备另按分钟保存汇总，查询中整分钟的部分直接用汇总，只逐条统计两端不满一分钟的记录，
+// 持锁时间与分钟数成正比，不随记录条数增长，写线程的 append 不会被长查询卡住。
+
+#ifndef RK3588_DEMO_HOT_WINDOW_H
+#define RK3588_DEMO_HOT_WINDOW_H
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "rollup.h"
+
+class HotWindow {
+public:
+    // start_ms 为开始接收记录的时间，向上取整到秒，之前的记录都在数据库中
+    HotWindow(int hours, int64_t start_ms);
+
+    HotWindow(const HotWindow &) = delete;
+    HotWindow &operator=(const HotWindow &) = delete;
+
+    // 追加一条记录，超出时间窗的旧记录随之丢弃；早于 coverageStart() 的记录不保存，返回 false
+    bool append(int device, const std::string &name, int64_t time_ms, int count);
+
+    int64_t coverageStart() const;
+    // 统计内存中 [from_ms, to_ms) 内的记录，device 为空时统计所有设备
+    void aggregate(const std::string &device, int64_t from_ms, int64_t to_ms, CountAggregate &out) const;
+    size_t size() const;
+
+private:
+    struct Sample {
+        int64_t time_ms;
+        int count;
+    };
+    struct Bucket {
+        int64_t start_ms;  // kBucketMs 的整数倍
+        CountAggregate total;
+    };
+    struct Device {
+        std::string name;
+        std::deque<Sample> samples;  // 按时间排序
+        std::deque<Bucket> buckets;  // 有记录的分钟，按时间排序
+    };
+
+    static const int64_t kBucketMs = 60 * 1000;
+
+    static void collectSamples(const Device &device, int64_t from_ms, int64_t to_ms, CountAggregate &out);
+    static void collect(const Device &device, int64_t from_ms, int64_t to_ms, CountAggregate &out);
+
+    mutable std::mutex mutex_;
+    const int64_t window_ms_;
+    int64_t coverage_start_;
+    size_t size_ = 0;
+    std::vector<Device> devices_;  // 按写入编号
+};
+
+#endif // RK3588_DEMO_HOT_WINDOW_H
@@ -0,0 +1,66 @@
+#include "rollup.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+
+const RollupLevel kRollupLevel[kRollupLevels] = {
+    {"detection_rollup_1s", 1},
+    {"detection_rollup_1m", 60},
+    {"detection_rollup_1h", 3600},
+};
+
+void CountAggregate::add(const CountAggregate &other) {
+    if (other.samples == 0) return;
+    max = samples > 0 ? std::max(max, other.max) : other.max;
+    samples += other.samples;
+    sum += other.sum;
+    if (other.last_ms >= last_ms) {
+        last = other.last;
+        last_ms = other.last_ms;
+    }
+}
+
+void SpanAggregate::add(int64_t start_ms, int64_t end_ms, int value) {
+    if (end_ms < start_ms) return;
+    max = last_ms >= 0 ? std::max(max, value) : value;
+    min = last_ms >= 0 ? std::min(min, value) : value;
+    duration_ms += end_ms - start_ms;
+    weighted_sum += (int64_t)value * (end_ms - start_ms);
+    if (end_ms >= last_ms) {
+        last = value;
+        last_ms = end_ms;
+    }
+}
+
+int64_t parseLocalTimestamp(const std::string &text) {
+    if (text.size() != 14 && text.size() != 17) return -1;
+    for (char c : text) {
+        if (!std::isdigit((unsigned char)c)) return -1;
+    }
+    auto field = [&](size_t pos, size_t len) { return std::atoi(text.substr(pos, len).c_str()); };
+    std::tm bt = {};
+    bt.tm_year = field(0, 4) - 1900;
+    bt.tm_mon = field(4, 2) - 1;
+    bt.tm_mday = field(6, 2);
+    bt.tm_hour = field(8, 2);
+    bt.tm_min = field(10, 2);
+    bt.tm_sec = field(12, 2);
+    bt.tm_isdst = -1;
+    time_t t = mktime(&bt);
+    if (t == (time_t)-1) return -1;
+    int ms = text.size() == 17 ? field(14, 3) : 0;
+    return (int64_t)t * 1000 + ms;
+}
+
+std::string formatLocalTimestamp(int64_t time_ms) {
+    time_t t = (time_t)(time_ms / 1000);
+    std::tm bt;
+    localtime_r(&t, &bt);
+    char buf[32];
+    size_t n = strftime(buf, sizeof(buf), "%Y%m%d%H%M%S", &bt);
+    snprintf(buf + n, sizeof(buf) - n, "%03d", (int)(time_ms % 1000));
+    return buf;
+}
@@ -0,0 +1,50 @@
+// 人数汇总：秒/分钟/小时三级汇总表共用的定义，以及数据库中文本时间戳（本地时间 YYYYMMDDhhmmss[SSS]）的转换
+
+#ifndef RK3588_DEMO_ROLLUP_H
+#define RK3588_DEMO_ROLLUP_H
+
+#include <cstdint>
+#include <string>
+
+// 一段时间内的人数汇总
+struct CountAggregate {
+    int64_t samples = 0;  // 记录条数
+    int64_t sum = 0;      // 人数之和
+    int max = 0;
+    int last = 0;         // 时间最晚的一条记录的人数
+    int64_t last_ms = -1; // 该记录的时间，-1 表示没有记录
+
+    double mean() const { return samples > 0 ? (double)sum / samples : 0.0; }
+    // 合并另一段（不重叠的）时间的汇总
+    void add(const CountAggregate &other);
+};
+
+// 一段时间内人数随时间的汇总（由变化区间得到，按时间加权）
+struct SpanAggregate {
+    int64_t duration_ms = 0;   // 有数据的时长
+    int64_t weighted_sum = 0;  // 人数 × 毫秒之和
+    int max = 0;
+    int min = 0;
+    int last = 0;              // 最后的人数
+    int64_t last_ms = -1;      // 最后的人数持续到的时间，-1 表示没有数据
+
+    double mean() const { return duration_ms > 0 ? (double)weighted_sum / duration_ms : 0.0; }
+    // 合并一个区间 [start_ms, end_ms)；start_ms = end_ms 的区间只有一条记录，只影响最大/最小/最后值
+    void add(int64_t start_ms, int64_t end_ms, int value);
+};
+
+struct RollupLevel {
+    const char *table;
+    int64_t seconds;  // 桶的长度
+};
+
+// 从细到粗
+static const int kRollupLevels = 3;
+extern const RollupLevel kRollupLevel[kRollupLevels];
+
+// 文本时间戳（14 位精确到秒或 17 位精确到毫秒，本地时间）转为毫秒时间，格式错误返回 -1
+int64_t parseLocalTimestamp(const std::string &text);
+// 毫秒时间转为 17 位文本时间戳（本地时间）
+std::string formatLocalTimestamp(int64_t time_ms);
+
+#endif // RK3588_DEMO_ROLLUP_H
@@ -0,0 +1,183 @@
+#include "series_codec.h"
+
+#include <algorithm>
+
+// 追加时预留的最坏情况位数：结束游程（gamma 最多 129 位）加一个完整样本（1 + 36 + 18 位）
+static const size_t kReserveBits = 192;
+
+void SeriesEncoder::reset() {
+    bytes_.clear();
+    bit_count_ = 0;
+    samples_ = 0;
+    prev_delta_ = 0;
+    run_ = 0;
+    sum_ = 0;
+}
+
+void SeriesEncoder::writeBits(uint64_t value, int bits) {
+    for (int i = bits - 1; i >= 0; i--) {
+        if (bit_count_ % 8 == 0) bytes_.push_back(0);
+        if ((value >> i) & 1) bytes_.back() |= (uint8_t)(0x80 >> (bit_count_ % 8));
+        bit_count_++;
+    }
+}
+
+void SeriesEncoder::writeGamma(uint64_t n) {
+    int bits = 0;
+    while ((n >> bits) > 1) bits++;
+    writeBits(0, bits);
+    writeBits(n, bits + 1);
+}
+
+void SeriesEncoder::flushRun() {
+    if (run_ == 0) return;
+    writeBits(0, 1);
+    writeGamma(run_);
+    run_ = 0;
+}
+
+bool SeriesEncoder::append(int64_t tick, int value) {
+    value = std::max(0, std::min(value, 0xFFFF));
+    if (samples_ == 0) {
+        first_tick_ = prev_tick_ = tick;
+        prev_value_ = min_ = max_ = value;
+        sum_ = value;
+        samples_ = 1;
+        writeBits((uint64_t)value, 16);
+        return true;
+    }
+    tick = std::max(tick, prev_tick_);
+    const int64_t delta = tick - prev_tick_;
+    const int64_t dod = delta - prev_delta_;
+    if (dod < INT32_MIN || dod > INT32_MAX) return false;
+
+    if (dod == 0 && value == prev_value_) {
+        // 游程只在写出时占用空间，计数前确认结束时还放得下
+        if (bit_count_ + kReserveBits > max_bytes_ * 8) return false;
+        run_++;
+    } else {
+        if (bit_count_ + kReserveBits > max_bytes_ * 8) return false;
+        flushRun();
+        writeBits(1, 1);
+        if (dod == 0) {
+            writeBits(0, 1);
+        } else if (dod >= -63 && dod <= 64) {
+            writeBits(0x2, 2);
+            writeBits((uint64_t)(dod + 63), 7);
+        } else if (dod >= -255 && dod <= 256) {
+            writeBits(0x6, 3);
+            writeBits((uint64_t)(dod + 255), 9);
+        } else if (dod >= -2047 && dod <= 2048) {
+            writeBits(0xE, 4);
+            writeBits((uint64_t)(dod + 2047), 12);
+        } else {
+            writeBits(0xF, 4);
+            writeBits((uint64_t)(uint32_t)(int32_t)dod, 32);
+        }
+        const int diff = value - prev_value_;
+        if (diff == 0) {
+            writeBits(0, 1);
+        } else if (diff >= -8 && diff <= 7) {
+            writeBits(0x2, 2);
+            writeBits((uint64_t)(diff + 8), 4);
+        } else {
+            writeBits(0x3, 2);
+            writeBits((uint64_t)value, 16);
+        }
+    }
+    prev_delta_ = delta;
+    prev_tick_ = tick;
+    prev_value_ = value;
+    samples_++;
+    sum_ += value;
+    min_ = std::min(min_, value);
+    max_ = std::max(max_, value);
+    return true;
+}
+
+std::vector<uint8_t> SeriesEncoder::finish() const {
+    if (run_ == 0) return bytes_;
+    SeriesEncoder copy = *this;
+    copy.flushRun();
+    return copy.bytes_;
+}
+
+bool SeriesDecoder::readBit(int &bit) {
+    if (bit_pos_ >= size_ * 8) return false;
+    bit = (data_[bit_pos_ / 8] >> (7 - bit_pos_ % 8)) & 1;
+    bit_pos_++;
+    return true;
+}
+
+bool SeriesDecoder::readBits(int bits, uint64_t &value) {
+    value = 0;
+    for (int i = 0; i < bits; i++) {
+        int bit;
+        if (!readBit(bit)) return false;
+        value = (value << 1) | (uint64_t)bit;
+    }
+    return true;
+}
+
+bool SeriesDecoder::readGamma(uint64_t &n) {
+    int zeros = 0;
+    int bit = 0;
+    while (readBit(bit) && bit == 0) {
+        if (++zeros > 63) return false;
+    }
+    if (bit != 1) return false;
+    uint64_t rest;
+    if (!readBits(zeros, rest)) return false;
+    n = (1ULL << zeros) | rest;
+    return true;
+}
+
+bool SeriesDecoder::next(int64_t &tick, int &value) {
+    if (remaining_ <= 0) return false;
+    if (!started_) {
+        uint64_t first;
+        if (!readBits(16, first)) return false;
+        started_ = true;
+        value_ = (int)first;
+    } else if (run_ > 0) {
+        run_--;
+        tick_ += delta_;
+    } else {
+        int bit;
+        if (!readBit(bit)) return false;
+        if (bit == 0) {
+            if (!readGamma(run_)) return false;
+            run_--;
+            tick_ += delta_;
+        } else {
+            // 二阶差分的前缀：连续的 1 的个数（最多 4 个）
+            int ones = 0;
+            while (ones < 4 && readBit(bit) && bit == 1) ones++;
+            static const int kWidth[] = {0, 7, 9, 12, 32};
+            static const int kBias[] = {0, 63, 255, 2047, 0};
+            int64_t dod = 0;
+            uint64_t raw;
+            if (ones > 0) {
+                if (!readBits(kWidth[ones], raw)) return false;
+                dod = ones == 4 ? (int64_t)(int32_t)(uint32_t)raw : (int64_t)raw - kBias[ones];
+            }
+            delta_ += dod;
+            tick_ += delta_;
+            if (!readBit(bit)) return false;
+            if (bit == 1) {
+                if (!readBit(bit)) return false;
+                if (bit == 0) {
+                    if (!readBits(4, raw)) return false;
+                    value_ += (int)raw - 8;
+                } else {
+                    if (!readBits(16, raw)) return false;
+                    value_ = (int)raw;
+                }
+            }
+        }
+    }
+    remaining_--;
+    tick = tick_;
+    value = value_;
+    return true;
+}
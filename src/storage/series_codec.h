@@ -0,0 +1,82 @@
+// 人数时间序列的压缩编码：时间戳按分辨率量化后记二阶差分，人数记与上一个的差，
+// 二阶差分为 0 且人数不变的连续样本合并为一个游程；编码按位紧凑排列，写满固定大小的块后换新块。
+//
+// 位流（高位在前）：第一个样本只有 16 位人数（时间在块的 first_tick 中），之后每项为：
+//   0 + gamma(n)          n 个二阶差分为 0、人数不变的样本
+//   1 + 二阶差分 + 人数    一个样本
+//     二阶差分：0 → 0；10 + 7 位；110 + 9 位；1110 + 12 位；1111 + 32 位（有符号）
+//     人数：0 → 不变；10 + 4 位有符号差值；11 + 16 位人数
+// gamma(n) 为 Elias gamma 编码：floor(log2 n) 个 0，之后是 n 的二进制
+
+#ifndef RK3588_DEMO_SERIES_CODEC_H
+#define RK3588_DEMO_SERIES_CODEC_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class SeriesEncoder {
+public:
+    explicit SeriesEncoder(size_t max_bytes = 4096) : max_bytes_(max_bytes) {}
+
+    void reset();
+    // 追加一个样本（tick 为量化后的时间，不小于上一个样本的 tick）；块已满返回 false，需要换新块
+    bool append(int64_t tick, int value);
+    // 编码结果（含尚未结束的游程）
+    std::vector<uint8_t> finish() const;
+
+    bool empty() const { return samples_ == 0; }
+    int64_t samples() const { return samples_; }
+    int64_t firstTick() const { return first_tick_; }
+    int64_t lastTick() const { return prev_tick_; }
+    int64_t sum() const { return sum_; }
+    int min() const { return min_; }
+    int max() const { return max_; }
+    int last() const { return prev_value_; }
+
+private:
+    void writeBits(uint64_t value, int bits);
+    void writeGamma(uint64_t n);
+    void flushRun();
+
+    size_t max_bytes_;
+    std::vector<uint8_t> bytes_;
+    size_t bit_count_ = 0;
+    int64_t samples_ = 0;
+    int64_t first_tick_ = 0;
+    int64_t prev_tick_ = 0;
+    int64_t prev_delta_ = 0;
+    int prev_value_ = 0;
+    uint64_t run_ = 0;  // 还没写出的游程长度
+    int64_t sum_ = 0;
+    int min_ = 0;
+    int max_ = 0;
+
+    friend class SeriesDecoder;
+};
+
+class SeriesDecoder {
+public:
+    SeriesDecoder(const uint8_t *data, size_t size, int64_t first_tick, int64_t samples)
+        : data_(data), size_(size), tick_(first_tick), remaining_(samples) {}
+
+    // 依次取出样本，取完或数据损坏时返回 false
+    bool next(int64_t &tick, int &value);
+
+private:
+    bool readBits(int bits, uint64_t &value);
+    bool readBit(int &bit);
+    bool readGamma(uint64_t &n);
+
+    const uint8_t *data_;
+    size_t size_;
+    size_t bit_pos_ = 0;
+    int64_t tick_;
+    int64_t delta_ = 0;
+    int value_ = 0;
+    int64_t remaining_;
+    uint64_t run_ = 0;
+    bool started_ = false;
+};
+
+#endif // RK3588_DEMO_SERIES_CODEC_H
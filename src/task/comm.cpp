@@ -13,10 +13,9 @@
 #include <chrono>
 #include <sys/stat.h>
 
-#include <sqlite3.h>
-#include <string>
-
-sqlite3* GetDatabaseConnection(const std::string& db_name);
+#include "storage/detection_writer.h"
+#include "storage/detection_history.h"
+#include "task/count_aggregator.h"
 
 #define FRAME_MAX 128
 #define SLAVE_ADDR 0x01
@@ -24,10 +23,13 @@ sqlite3* GetDatabaseConnection(const std::string& db_name);
 
 // ȫֱ
 static int fd = -1;
-static uint16_t current_people = 0;
-static sqlite3* send_db = nullptr;
-static std::string g_max_device_id;
-static std::string g_max_timestamp;
+// Դͷܣ̶߳ȡգͷ̹߳ɱ
+static const CountAggregator* count_aggregator = nullptr;
+// ͼ¼д߳д벢άܱ 24 Сʱļ¼ͬʱڴУݲ㣩
+// ʷѯһڴͳƣĲ߻ܱ
+static const char* SEND_DB_PATH = "./detection_results_send.db";
+static DetectionWriter send_writer;
+static DetectionHistory send_history;
 static pthread_mutex_t db_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 // ȡǰʱַ
@@ -65,45 +67,22 @@ static std::string get_current_timestamp() {
 static bool init_send_db() {
     pthread_mutex_lock(&db_mutex);
     
-    // ʹ½ӿڻȡ
-    send_db = GetDatabaseConnection("detection_results_send.db");
-    if (!send_db) {
-        pthread_mutex_unlock(&db_mutex);
-        return false;
-    }
-
-    // Ƿ
-    const char* check_sql = "SELECT name FROM sqlite_master WHERE type='table' AND name='detection_results';";
-    sqlite3_stmt* stmt;
-    bool table_exists = false;
-    
-    if (sqlite3_prepare_v2(send_db, check_sql, -1, &stmt, nullptr) == SQLITE_OK) {
-        if (sqlite3_step(stmt) == SQLITE_ROW) {
-            table_exists = true;
-        }
-        sqlite3_finalize(stmt);
-    }
-
-    // ڣ
-    if (!table_exists) {
-        const char* create_sql = "CREATE TABLE detection_results ("
-                               "id INTEGER PRIMARY KEY AUTOINCREMENT,"
-                               "device TEXT NOT NULL,"
-                               "timestamp TEXT NOT NULL,"
-                               "box_count INTEGER NOT NULL);";
-        
-        char* errMsg = nullptr;
-        if (sqlite3_exec(send_db, create_sql, nullptr, nullptr, &errMsg) != SQLITE_OK) {
-            fprintf(stderr, "Failed to create table: %s\n", errMsg);
-            sqlite3_free(errMsg);
+    if (!send_writer.running()) {
+        DetectionWriter::Params params;
+        params.db_path = SEND_DB_PATH;
+        params.raw_retention_hours = 0;  // ԭʼͼ¼һֱ
+        params.hot_hours = 24;           // ͼ¼٣һļ¼ֻռ MB ڴ
+        params.flush_ms = 10 * 1000;     // ÿ 10 ˳дһΣʱඪʧʱ
+        if (!send_writer.start(params)) {
             pthread_mutex_unlock(&db_mutex);
             return false;
         }
     }
-
-    // Ż
-    sqlite3_exec(send_db, "PRAGMA journal_mode=WAL;", nullptr, nullptr, nullptr);
-    sqlite3_exec(send_db, "PRAGMA synchronous=NORMAL;", nullptr, nullptr, nullptr);
+    // дӽñֻܴ֮Ĳѯ
+    if (!send_history.isOpen()) {
+        send_history.open(SEND_DB_PATH);
+    }
+    send_history.setHotWindow(send_writer.hotWindow());
     
     pthread_mutex_unlock(&db_mutex);
     return true;
@@ -158,77 +137,46 @@ static int build_response_frame(uint8_t from_addr, uint8_t to_addr, uint8_t func
     return idx;
 }
 
-// ѯʷ¼
+// ѯʷ¼ʱ䷶Χ [start_time, end_time)14 λʱ䣬ظ÷Χڷ֮
 static std::vector<uint8_t> query_history_records(const std::string& start_time, const std::string& end_time) {
     std::vector<uint8_t> result;
-    pthread_mutex_lock(&db_mutex);
-    
-    if (!send_db) {
-        pthread_mutex_unlock(&db_mutex);
-        return result;
+    int64_t from_ms = parseLocalTimestamp(start_time);
+    int64_t to_ms = parseLocalTimestamp(end_time);
+    if (from_ms < 0 || to_ms < 0) {
+        printf("[ERROR] Invalid history time range: %s ~ %s\n", start_time.c_str(), end_time.c_str());
+        return std::vector<uint8_t>{0x00, 0x00};
     }
 
-    const char* sql = R"(
-        SELECT SUM(box_count) FROM detection_results 
-        WHERE timestamp BETWEEN ? AND ? AND box_count > 0;
-    )";
-    
-    sqlite3_stmt* stmt;
-    if (sqlite3_prepare_v2(send_db, sql, -1, &stmt, nullptr) == SQLITE_OK) {
-        sqlite3_bind_text(stmt, 1, start_time.c_str(), -1, SQLITE_TRANSIENT);
-        sqlite3_bind_text(stmt, 2, end_time.c_str(), -1, SQLITE_TRANSIENT);
-        
-        if (sqlite3_step(stmt) == SQLITE_ROW) {
-            int total = sqlite3_column_int(stmt, 0);
-            // printf("[DB] Query %s~%s => %d people\n", 
-            //       start_time.c_str(), end_time.c_str(), total);
-            result.push_back((total >> 8) & 0xFF);
-            result.push_back(total & 0xFF);
-        } else {
-            // printf("[DB] No data found for %s~%s\n", 
-            //       start_time.c_str(), end_time.c_str());
-        }
-        sqlite3_finalize(stmt);
-    } else {
-        printf("[DB ERROR] %s\n", sqlite3_errmsg(send_db));
+    pthread_mutex_lock(&db_mutex);
+    if (!send_history.isOpen()) {
+        send_history.open(SEND_DB_PATH);
+    }
+    CountAggregate total;
+    if (send_history.aggregate("", from_ms, to_ms, total)) {
+        result.push_back((total.sum >> 8) & 0xFF);
+        result.push_back(total.sum & 0xFF);
     }
-    
     pthread_mutex_unlock(&db_mutex);
     return result.empty() ? std::vector<uint8_t>{0x00, 0x00} : result;
 }
 
-// 淢ͼ¼ݿ⣨ǿ棩
+// 淢ͼ¼ݿ⣺д̵߳ĶУȴд
 static void save_to_send_db(const std::string& device, const std::string& timestamp, uint16_t count) {
-    pthread_mutex_lock(&db_mutex);
-    
     // ȷݿѳʼ
-    if (!send_db && !init_send_db()) {
-        pthread_mutex_unlock(&db_mutex);
+    if (!send_writer.running() && !init_send_db()) {
         return;
     }
 
-    const char* sql = "INSERT INTO detection_results (device, timestamp, box_count) VALUES (?, ?, ?);";
-    sqlite3_stmt* stmt;
-    
-    if (sqlite3_prepare_v2(send_db, sql, -1, &stmt, nullptr) != SQLITE_OK) {
-        printf("[DB ERROR] Prepare statement failed: %s\n", sqlite3_errmsg(send_db));
-        pthread_mutex_unlock(&db_mutex);
-        return;
+    int64_t time_ms = parseLocalTimestamp(timestamp);
+    if (time_ms < 0) {
+        time_ms = DetectionWriter::nowMs();
     }
-    
-    sqlite3_bind_text(stmt, 1, device.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 2, timestamp.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_int(stmt, 3, count);
-    
-    if (sqlite3_step(stmt) != SQLITE_DONE) {
-        printf("[DB ERROR] Insert failed: %s\n", sqlite3_errmsg(send_db));
-    } else {
-        printf("[DB] Successfully saved the record: %s @ %s -> %d\n", 
+    if (send_writer.push(send_writer.addDevice(device), time_ms, count)) {
+        printf("[DB] Successfully queued the record: %s @ %s -> %d\n", 
               device.c_str(), timestamp.c_str(), count);
+    } else {
+        printf("[DB ERROR] Send record queue full, dropped: %s @ %s\n", device.c_str(), timestamp.c_str());
     }
-    
-    sqlite3_finalize(stmt);
-    pthread_mutex_unlock(&db_mutex);
 }
 
 // ̣߳棩
@@ -279,6 +227,18 @@ static void* recv_thread(void* arg) {
         // ʵʱѯ (0x01)
         if (func_code == 0x01 && data_len == 0) {
             // printf("[CMD] Current people query\n");
+            // ǰһ͵ǰһиͷֵԼֵͷʱ
+            uint16_t current_people = 0;
+            std::string device = "unknown_device";
+            std::string timestamp = get_current_timestamp();
+            if (count_aggregator) {
+                CountAggregator::Peak peak = count_aggregator->peak();
+                if (peak.camera >= 0) {
+                    current_people = static_cast<uint16_t>(peak.count);
+                    if (!peak.camera_name.empty()) device = peak.camera_name;
+                    timestamp = formatLocalTimestamp(peak.time_ms);
+                }
+            }
             uint8_t resp[16];
             uint8_t data[2] = {
                 static_cast<uint8_t>((current_people >> 8) & 0xFF),
@@ -287,8 +247,6 @@ static void* recv_thread(void* arg) {
             int resp_len = build_response_frame(SLAVE_ADDR, MASTER_ADDR, 0x02, data, 2, resp);
             
             // 淢ͼ¼current_peopleǷΪ0棩
-            std::string device = g_max_device_id.empty() ? "unknown_device" : g_max_device_id;
-            std::string timestamp = g_max_timestamp.empty() ? get_current_timestamp() : g_max_timestamp;
             save_to_send_db(device, timestamp, current_people);
             
             write(fd, resp, resp_len);
@@ -393,15 +351,7 @@ void init_serial_comm(const char* device) {
     pthread_detach(tid);
 }
 
-// Ҫ͵
-void send_people_count(uint16_t people) {
-    current_people = people;
-    // printf("[PEOPLE] Set current people: %d\n", people);
-}
-
-// Ϣ
-void update_max_info(const std::string& device_id, const std::string& timestamp) {
-    g_max_device_id = device_id;
-    g_max_timestamp = timestamp;
-    // printf("[UPDATE] Max info: %s @ %s\n", device_id.c_str(), timestamp.c_str());
+// Դ init_serial_comm ֮ǰ
+void set_count_aggregator(const CountAggregator* aggregator) {
+    count_aggregator = aggregator;
 }
\ No newline at end of file
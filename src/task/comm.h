@@ -8,6 +8,6 @@
 
 sqlite3* GetDatabaseConnection(const std::string& db_name);
 void init_serial_comm(const char* device);  // 初始化串口通信线程
-void send_people_count(uint16_t people);    // 设置要返回的人数
-void update_max_info(const std::string& device_id, const std::string& timestamp);
+class CountAggregator;
+void set_count_aggregator(const CountAggregator* aggregator);  // 串口返回的人数取自该汇总的快照
 #endif
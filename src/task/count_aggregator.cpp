@@ -0,0 +1,146 @@
+#include "count_aggregator.h"
+
+#include <algorithm>
+
+void CountAggregator::Stats::add(const Stats &other) {
+    if (other.max_camera < 0) return;
+    if (max_camera < 0 || other.max > max || (other.max == max && other.max_time_ms > max_time_ms)) {
+        max = other.max;
+        max_camera = other.max_camera;
+        max_time_ms = other.max_time_ms;
+    }
+    sum += other.sum;
+    frames += other.frames;
+}
+
+CountAggregator::CountAggregator() : windows_{1, 10, 60} {
+    snapshot_ = std::make_shared<const Snapshot>();
+}
+
+void CountAggregator::configure(const std::vector<int> &window_seconds) {
+    std::lock_guard<std::mutex> lock(config_mutex_);
+    windows_.clear();
+    for (int seconds : window_seconds) {
+        if (seconds > 0) windows_.push_back(seconds);
+    }
+    if (windows_.empty()) windows_.push_back(1);
+}
+
+int CountAggregator::addCamera(const std::string &name, const std::string &group) {
+    std::lock_guard<std::mutex> lock(config_mutex_);
+    if ((int)cameras_.size() >= kMaxCameras) return -1;
+    const std::string group_name = group.empty() ? "all" : group;
+    auto it = std::find(groups_.begin(), groups_.end(), group_name);
+    if (it == groups_.end()) it = groups_.insert(groups_.end(), group_name);
+    cameras_.push_back(name);
+    camera_group_.push_back((int)(it - groups_.begin()));
+    camera_count_ = (int)cameras_.size();
+    // 快照中带上新摄像头的名字
+    publish(last_close_ms_);
+    return (int)cameras_.size() - 1;
+}
+
+void CountAggregator::report(int camera, int count, int64_t time_ms) {
+    if (camera < 0 || camera >= camera_count_.load(std::memory_order_relaxed)) return;
+    Slot &slot = slots_[camera];
+    const uint64_t value = (uint64_t)std::max(0, std::min(count, 0xFFFF));
+    uint64_t old = slot.packed.load(std::memory_order_relaxed);
+    uint64_t next;
+    do {
+        uint64_t max = old >> 48;
+        uint64_t frames = (old >> 32) & 0xFFFF;
+        uint64_t sum = old & 0xFFFFFFFF;
+        if (frames < 0xFFFF) {
+            frames++;
+            sum = std::min<uint64_t>(sum + value, 0xFFFFFFFF);
+        }
+        next = (std::max(max, value) << 48) | (frames << 32) | sum;
+        if (frames == 1 || value > max) {
+            // 本秒第一帧或新的最大值：先记时间，close 在 packed 之后读取
+            slot.max_time_ms.store(time_ms, std::memory_order_relaxed);
+        }
+    } while (!slot.packed.compare_exchange_weak(old, next, std::memory_order_release, std::memory_order_relaxed));
+}
+
+void CountAggregator::close(int64_t now_ms) {
+    std::lock_guard<std::mutex> lock(config_mutex_);
+    const int cameras = (int)cameras_.size();
+    std::vector<Stats> second(cameras);
+    for (int i = 0; i < cameras; i++) {
+        uint64_t packed = slots_[i].packed.exchange(0, std::memory_order_acq_rel);
+        Stats &stats = second[i];
+        stats.frames = (int64_t)((packed >> 32) & 0xFFFF);
+        if (stats.frames == 0) continue;
+        stats.max = (int)(packed >> 48);
+        stats.sum = (int64_t)(packed & 0xFFFFFFFF);
+        stats.max_camera = i;
+        stats.max_time_ms = slots_[i].max_time_ms.load(std::memory_order_relaxed);
+    }
+    const size_t keep = (size_t)*std::max_element(windows_.begin(), windows_.end());
+    seconds_.push_front(std::move(second));
+    while (seconds_.size() > keep) seconds_.pop_back();
+    last_close_ms_ = now_ms;
+    publish(now_ms);
+}
+
+// 由最近的秒窗口生成快照，调用时持有 config_mutex_
+void CountAggregator::publish(int64_t now_ms) {
+    const int cameras = (int)cameras_.size();
+    auto snapshot = std::make_shared<Snapshot>();
+    snapshot->time_ms = now_ms;
+    snapshot->windows = windows_;
+    snapshot->cameras = cameras_;
+    snapshot->groups = groups_;
+    snapshot->camera_group = camera_group_;
+    for (int seconds : windows_) {
+        std::vector<Stats> camera(cameras);
+        std::vector<Stats> group(groups_.size());
+        Stats total;
+        for (size_t s = 0; s < seconds_.size() && s < (size_t)seconds; s++) {
+            for (int i = 0; i < cameras && i < (int)seconds_[s].size(); i++) {
+                camera[i].add(seconds_[s][i]);
+            }
+        }
+        for (int i = 0; i < cameras; i++) {
+            group[camera_group_[i]].add(camera[i]);
+            total.add(camera[i]);
+        }
+        snapshot->camera.push_back(std::move(camera));
+        snapshot->group.push_back(std::move(group));
+        snapshot->total.push_back(total);
+    }
+    if (!seconds_.empty()) {
+        for (const Stats &stats : seconds_.front()) {
+            snapshot->last_second.add(stats);
+        }
+    }
+    std::atomic_store(&snapshot_, std::shared_ptr<const Snapshot>(std::move(snapshot)));
+}
+
+std::shared_ptr<const CountAggregator::Snapshot> CountAggregator::snapshot() const {
+    return std::atomic_load(&snapshot_);
+}
+
+CountAggregator::Peak CountAggregator::peak() const {
+    std::shared_ptr<const Snapshot> snapshot = this->snapshot();
+    Peak peak;
+    if (snapshot->last_second.max_camera >= 0) {
+        peak.count = snapshot->last_second.max;
+        peak.camera = snapshot->last_second.max_camera;
+        peak.time_ms = snapshot->last_second.max_time_ms;
+    }
+    // 还没结束的秒窗口直接读计数槽
+    const int cameras = camera_count_.load(std::memory_order_acquire);
+    for (int i = 0; i < cameras; i++) {
+        uint64_t packed = slots_[i].packed.load(std::memory_order_acquire);
+        int max = (int)(packed >> 48);
+        if (((packed >> 32) & 0xFFFF) == 0 || (peak.camera >= 0 && max <= peak.count)) continue;
+        peak.count = max;
+        peak.camera = i;
+        peak.time_ms = slots_[i].max_time_ms.load(std::memory_order_relaxed);
+    }
+    if (peak.camera >= 0 && peak.camera < (int)snapshot->cameras.size()) {
+        peak.camera_name = snapshot->cameras[peak.camera];
+    }
+    return peak;
+}
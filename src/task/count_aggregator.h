@@ -0,0 +1,95 @@
+// 人数汇总：各摄像头线程把每帧的人数记入自己的计数槽（独占一个缓存行，每帧一次 64 位 CAS，不加锁），
+// 主线程每秒收一次各槽（秒窗口），按摄像头、分组和配置的时间窗口统计最大值、总和、帧数和均值，
+// 生成不可变的快照后原子地替换（RCU 式发布）；串口、数据库、指标等读者取同一份快照，数值相互一致
+
+#ifndef RK3588_DEMO_COUNT_AGGREGATOR_H
+#define RK3588_DEMO_COUNT_AGGREGATOR_H
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class CountAggregator {
+public:
+    static const int kMaxCameras = 64;
+
+    // 一个摄像头（或一组、全部摄像头）在一个时间窗口内的统计
+    struct Stats {
+        int max = 0;               // 单个摄像头单帧的最大人数
+        int64_t sum = 0;           // 各帧人数之和
+        int64_t frames = 0;
+        int max_camera = -1;       // 最大人数所在的摄像头，-1 表示没有数据
+        int64_t max_time_ms = 0;   // 最大人数出现的时间
+
+        double mean() const { return frames > 0 ? (double)sum / frames : 0.0; }
+        void add(const Stats &other);
+    };
+
+    struct Snapshot {
+        int64_t time_ms = 0;               // 最后一个秒窗口结束的时间
+        std::vector<int> windows;          // 各时间窗口的秒数
+        std::vector<std::string> cameras;  // 摄像头名，按编号
+        std::vector<std::string> groups;   // 分组名
+        std::vector<int> camera_group;     // 摄像头所属的分组
+        std::vector<std::vector<Stats>> camera;  // [窗口][摄像头]
+        std::vector<std::vector<Stats>> group;   // [窗口][分组]
+        std::vector<Stats> total;                // [窗口] 所有摄像头
+        Stats last_second;                       // 最后一个秒窗口的所有摄像头
+    };
+
+    // 当前的最大人数：最后一个秒窗口与还没结束的秒窗口中所有摄像头的最大值
+    struct Peak {
+        int count = 0;
+        int camera = -1;  // -1 表示没有数据
+        std::string camera_name;
+        int64_t time_ms = 0;
+    };
+
+    CountAggregator();
+
+    CountAggregator(const CountAggregator &) = delete;
+    CountAggregator &operator=(const CountAggregator &) = delete;
+
+    // 时间窗口（秒，按秒窗口的个数计），在注册摄像头之前调用；默认 1、10、60
+    void configure(const std::vector<int> &window_seconds);
+    // 注册摄像头，返回编号；group 为空时归入 "all"；应在开始上报之前注册，最多 kMaxCameras 个
+    int addCamera(const std::string &name, const std::string &group);
+
+    // 摄像头线程每帧调用，不加锁
+    void report(int camera, int count, int64_t time_ms);
+    // 主线程每秒调用一次：结束当前秒窗口并发布新快照
+    void close(int64_t now_ms);
+
+    // 最新的快照，任何线程都可以调用；还没有结束过秒窗口时各统计为空
+    std::shared_ptr<const Snapshot> snapshot() const;
+    Peak peak() const;
+
+private:
+    void publish(int64_t now_ms);
+
+    // 计数槽：高 16 位最大人数，中间 16 位帧数，低 32 位人数之和（都在饱和时停止增加）
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> packed{0};
+        std::atomic<int64_t> max_time_ms{0};  // 与 packed 分开更新，并发时可能差一帧
+    };
+
+    std::vector<int> windows_;
+    Slot slots_[kMaxCameras];
+    std::atomic<int> camera_count_{0};
+
+    // 以下只在主线程中使用（注册在上报开始之前完成）
+    std::mutex config_mutex_;
+    std::vector<std::string> cameras_;
+    std::vector<std::string> groups_;
+    std::vector<int> camera_group_;
+    std::deque<std::vector<Stats>> seconds_;  // 最近的秒窗口，每个窗口按摄像头，新的在前
+    int64_t last_close_ms_ = 0;
+
+    std::shared_ptr<const Snapshot> snapshot_;
+};
+
+#endif // RK3588_DEMO_COUNT_AGGREGATOR_H
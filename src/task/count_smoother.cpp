@@ -0,0 +1,128 @@
+#include "count_smoother.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+
+void CountSmoother::configure(const Params &params) {
+    params_ = params;
+    params_.window_seconds = std::max(0.0, params_.window_seconds);
+    reset();
+}
+
+void CountSmoother::reset() {
+    window_.clear();
+    max_queue_.clear();
+    sum_ = 0;
+    last_ = 0;
+    low_.clear();
+    high_.clear();
+}
+
+void CountSmoother::add(int count, std::chrono::steady_clock::time_point now) {
+    count = std::max(0, count);
+    last_ = count;
+    window_.push_back({now, count});
+    sum_ += count;
+    while (!max_queue_.empty() && max_queue_.back().count <= count) {
+        max_queue_.pop_back();
+    }
+    max_queue_.push_back({now, count});
+    insertMedian(count);
+    expire(now);
+}
+
+// 移出早于 now - window_seconds 的帧，至少保留当前帧
+void CountSmoother::expire(std::chrono::steady_clock::time_point now) {
+    const auto cutoff = now - std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                  std::chrono::duration<double>(params_.window_seconds));
+    while (window_.size() > 1 && window_.front().time < cutoff) {
+        const int count = window_.front().count;
+        sum_ -= count;
+        eraseMedian(count);
+        window_.pop_front();
+    }
+    while (max_queue_.size() > 1 && max_queue_.front().time < cutoff) {
+        max_queue_.pop_front();
+    }
+}
+
+void CountSmoother::insertMedian(int count) {
+    if (low_.empty() || count <= *low_.rbegin()) {
+        low_.insert(count);
+    } else {
+        high_.insert(count);
+    }
+    rebalance();
+}
+
+// low_ 中的值都不大于 high_ 中的值，按值就能判断在哪一半（相同的值删哪一个都一样）
+void CountSmoother::eraseMedian(int count) {
+    if (count <= *low_.rbegin()) {
+        low_.erase(low_.find(count));
+    } else {
+        high_.erase(high_.find(count));
+    }
+    rebalance();
+}
+
+void CountSmoother::rebalance() {
+    if (low_.size() > high_.size() + 1) {
+        auto it = std::prev(low_.end());
+        high_.insert(*it);
+        low_.erase(it);
+    } else if (low_.size() < high_.size()) {
+        auto it = high_.begin();
+        low_.insert(*it);
+        high_.erase(it);
+    }
+}
+
+int CountSmoother::max() const {
+    return max_queue_.empty() ? 0 : max_queue_.front().count;
+}
+
+double CountSmoother::median() const {
+    if (low_.empty()) return 0;
+    if (low_.size() > high_.size()) return *low_.rbegin();
+    return (*low_.rbegin() + *high_.begin()) / 2.0;
+}
+
+double CountSmoother::mean() const {
+    return window_.empty() ? 0 : (double)sum_ / window_.size();
+}
+
+int CountSmoother::value(Statistic statistic) const {
+    switch (statistic) {
+    case kMax:
+        return max();
+    case kMedian:
+        return (int)std::lround(median());
+    case kMean:
+        return (int)std::lround(mean());
+    default:
+        return last_;
+    }
+}
+
+bool CountSmoother::parseStatistic(const std::string &name, Statistic &statistic) {
+    if (name == "raw") statistic = kRaw;
+    else if (name == "max") statistic = kMax;
+    else if (name == "median") statistic = kMedian;
+    else if (name == "mean") statistic = kMean;
+    else return false;
+    return true;
+}
+
+const char *CountSmoother::statisticName(Statistic statistic) {
+    switch (statistic) {
+    case kMax:
+        return "max";
+    case kMedian:
+        return "median";
+    case kMean:
+        return "mean";
+    default:
+        return "raw";
+    }
+}
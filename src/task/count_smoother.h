@@ -0,0 +1,68 @@
+// 人数平滑：在每路的结果路径上维护最近 window_seconds 秒内各帧人数的滑动最大值、中位数和均值，
+// 每帧均摊 O(1)（中位数 O(log n)），不缓存、不重新扫描历史；串口和数据库各自选择发布哪一种统计。
+// 最大值用单调队列，中位数用较小、较大两半的有序多重集合（与双堆相同，但移出的帧可以直接删除），均值用滑动和
+
+#ifndef RK3588_DEMO_COUNT_SMOOTHER_H
+#define RK3588_DEMO_COUNT_SMOOTHER_H
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <set>
+#include <string>
+
+class CountSmoother {
+public:
+    enum Statistic {
+        kRaw = 0,   // 当前帧的人数，不平滑
+        kMax,
+        kMedian,
+        kMean,
+    };
+
+    struct Params {
+        double window_seconds = 2;  // 滑动窗口的长度
+    };
+
+    CountSmoother() = default;
+
+    void configure(const Params &params);
+    void reset();
+
+    // 加入一帧的人数，窗口外的旧帧随之移出
+    void add(int count, std::chrono::steady_clock::time_point now);
+
+    // 窗口内的统计，还没有帧时为 0；中位数和均值四舍五入到整数
+    int value(Statistic statistic) const;
+    int max() const;
+    double median() const;
+    double mean() const;
+    int last() const { return last_; }
+    size_t size() const { return window_.size(); }
+
+    static bool parseStatistic(const std::string &name, Statistic &statistic);
+    static const char *statisticName(Statistic statistic);
+
+private:
+    struct Sample {
+        std::chrono::steady_clock::time_point time;
+        int count;
+    };
+
+    void expire(std::chrono::steady_clock::time_point now);
+    void insertMedian(int count);
+    void eraseMedian(int count);
+    void rebalance();
+
+    Params params_;
+    std::deque<Sample> window_;      // 窗口内的所有帧
+    std::deque<Sample> max_queue_;   // 人数单调递减的帧，队首为窗口最大值
+    int64_t sum_ = 0;
+    int last_ = 0;
+
+    // low_ 为较小的一半（最大值在末尾），high_ 为较大的一半，low_ 比 high_ 多 0 或 1 个
+    std::multiset<int> low_;
+    std::multiset<int> high_;
+};
+
+#endif // RK3588_DEMO_COUNT_SMOOTHER_H
@@ -0,0 +1,99 @@
+#include "decode_policy.h"
+
+#include <sstream>
+
+bool parseDecodePolicy(const std::string &text, DecodePolicy &policy) {
+    if (text == "full") {
+        policy.mode = DecodePolicy::FULL;
+        policy.fps = 0;
+        return true;
+    }
+    if (text == "iframe") {
+        policy.mode = DecodePolicy::KEY_FRAME;
+        policy.fps = 0;
+        return true;
+    }
+    // 目标帧率，可带 fps 后缀
+    std::string number = text;
+    if (number.size() > 3 && number.compare(number.size() - 3, 3, "fps") == 0) {
+        number.resize(number.size() - 3);
+    }
+    try {
+        size_t used = 0;
+        double fps = std::stod(number, &used);
+        if (used != number.size() || fps <= 0) return false;
+        policy.mode = DecodePolicy::DECIMATE;
+        policy.fps = fps;
+        return true;
+    } catch (...) {
+        return false;
+    }
+}
+
+std::string decodePolicyToString(const DecodePolicy &policy) {
+    switch (policy.mode) {
+    case DecodePolicy::DECIMATE: {
+        std::ostringstream oss;
+        oss << policy.fps << "fps";
+        return oss.str();
+    }
+    case DecodePolicy::KEY_FRAME:
+        return "iframe";
+    default:
+        return "full";
+    }
+}
+
+DecodeRateController::DecodeRateController(const DecodeRateController &other) {
+    *this = other;
+}
+
+DecodeRateController &DecodeRateController::operator=(const DecodeRateController &other) {
+    if (this != &other) {
+        mode_ = other.mode_.load();
+        fps_ = other.fps_.load();
+        has_due_ = other.has_due_;
+        last_stamp_ = other.last_stamp_;
+        next_due_ = other.next_due_;
+        accepted_ = other.accepted_.load();
+        dropped_ = other.dropped_.load();
+    }
+    return *this;
+}
+
+void DecodeRateController::setPolicy(const DecodePolicy &policy) {
+    fps_ = policy.fps;
+    mode_ = policy.mode;
+}
+
+DecodePolicy DecodeRateController::policy() const {
+    DecodePolicy policy;
+    policy.mode = (DecodePolicy::Mode)mode_.load();
+    policy.fps = fps_.load();
+    return policy;
+}
+
+bool DecodeRateController::accept(uint32_t stamp_ms) {
+    bool ok = true;
+    double fps = fps_.load();
+    if (mode_.load() == DecodePolicy::DECIMATE && fps > 0) {
+        const double interval = 1000.0 / fps;
+        // 首帧、时间戳回绕或落后太多时重新对齐，避免补帧
+        if (!has_due_ || stamp_ms < last_stamp_ || stamp_ms - next_due_ > 1000.0) {
+            next_due_ = stamp_ms;
+            has_due_ = true;
+        }
+        ok = stamp_ms >= next_due_;
+        if (ok) {
+            next_due_ += interval;
+        }
+        last_stamp_ = stamp_ms;
+    }
+    (ok ? accepted_ : dropped_)++;
+    return ok;
+}
+
+void DecodeRateController::takeStats(int &accepted, int &dropped) {
+    accepted = accepted_.exchange(0);
+    dropped = dropped_.exchange(0);
+}
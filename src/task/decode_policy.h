@@ -0,0 +1,53 @@
+// 解码策略：全帧率、按目标帧率抽帧（不用的帧不做颜色转换）、只解码关键帧
+
+#ifndef RK3588_DEMO_DECODE_POLICY_H
+#define RK3588_DEMO_DECODE_POLICY_H
+
+#include <stdint.h>
+
+#include <atomic>
+#include <string>
+
+struct DecodePolicy {
+    enum Mode {
+        FULL = 0,       // 每一帧都转换
+        DECIMATE = 1,   // 按 fps 抽帧
+        KEY_FRAME = 2,  // PlayM4 只解码关键帧
+    };
+    Mode mode = FULL;
+    double fps = 0;
+};
+
+// 配置格式：full / iframe / 目标帧率（如 5、2.5 或 5fps）
+bool parseDecodePolicy(const std::string &text, DecodePolicy &policy);
+std::string decodePolicyToString(const DecodePolicy &policy);
+
+// 解码回调中按策略决定每一帧是否需要转换；策略可以在运行时从其他线程切换
+class DecodeRateController {
+public:
+    DecodeRateController() = default;
+    DecodeRateController(const DecodeRateController &other);
+    DecodeRateController &operator=(const DecodeRateController &other);
+
+    void setPolicy(const DecodePolicy &policy);
+    DecodePolicy policy() const;
+    bool keyFramesOnly() const { return mode_.load() == DecodePolicy::KEY_FRAME; }
+
+    // 只在解码回调线程中调用；stamp_ms 为 FRAME_INFO::nStamp
+    bool accept(uint32_t stamp_ms);
+
+    // 统计：取出并清零
+    void takeStats(int &accepted, int &dropped);
+
+private:
+    std::atomic<int> mode_{DecodePolicy::FULL};
+    std::atomic<double> fps_{0};
+
+    bool has_due_ = false;
+    uint32_t last_stamp_ = 0;
+    double next_due_ = 0;
+    std::atomic<int> accepted_{0};
+    std::atomic<int> dropped_{0};
+};
+
+#endif // RK3588_DEMO_DECODE_POLICY_H
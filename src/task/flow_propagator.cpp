@@ -0,0 +1,124 @@
+#include "flow_propagator.h"
+
+#include <algorithm>
+#include <cmath>
+
+static float median(std::vector<float> &values) {
+    size_t mid = values.size() / 2;
+    std::nth_element(values.begin(), values.begin() + mid, values.end());
+    return values[mid];
+}
+
+void FlowPropagator::configure(const Params &params, const cv::Size &frame_size) {
+    params_ = params;
+    params_.width = std::max(64, params_.width);
+    params_.points_per_box = std::max(3, params_.points_per_box);
+    frame_size_ = frame_size;
+    valid_ = false;
+    enabled_ = true;
+}
+
+void FlowPropagator::downsample(const uint8_t *y, int width, int height, int stride, cv::Mat &gray) const {
+    cv::Mat plane(height, width, CV_8UC1, (void *)y, stride);
+    if (width <= params_.width) {
+        plane.copyTo(gray);
+        return;
+    }
+    int out_height = std::max(1, height * params_.width / width);
+    cv::resize(plane, gray, cv::Size(params_.width, out_height), 0, 0, cv::INTER_AREA);
+}
+
+void FlowPropagator::reset(const cv::Mat &gray, const std::vector<Detection> &detections) {
+    valid_ = false;
+    if (gray.empty() || frame_size_.width <= 0) return;
+
+    prev_ = gray;
+    scale_ = (float)gray.cols / frame_size_.width;
+    frames_ = 0;
+    boxes_.clear();
+    points_.clear();
+
+    const cv::Rect bounds(0, 0, gray.cols, gray.rows);
+    std::vector<cv::Point2f> corners;
+    for (const auto &det : detections) {
+        BoxState state;
+        state.det = det;
+        state.box = cv::Rect2f(det.box.x * scale_, det.box.y * scale_, det.box.width * scale_, det.box.height * scale_);
+        state.first = (int)points_.size();
+        state.drift = cv::Point2f(0, 0);
+
+        cv::Rect roi = cv::Rect(state.box) & bounds;
+        if (roi.width >= 4 && roi.height >= 4) {
+            cv::goodFeaturesToTrack(prev_(roi), corners, params_.points_per_box, 0.01,
+                                    std::max(2, std::min(roi.width, roi.height) / 4));
+            if (corners.size() < 3) {
+                // 纹理太少：改用框内 3x3 网格点
+                corners.clear();
+                for (int gy = 1; gy <= 3; gy++) {
+                    for (int gx = 1; gx <= 3; gx++) {
+                        corners.emplace_back(roi.width * gx / 4.f, roi.height * gy / 4.f);
+                    }
+                }
+            }
+            for (const auto &p : corners) {
+                points_.emplace_back(p.x + roi.x, p.y + roi.y);
+            }
+        }
+        // 框太小没有特征点时保持不动
+        state.count = (int)points_.size() - state.first;
+        boxes_.push_back(state);
+    }
+    valid_ = true;
+}
+
+bool FlowPropagator::propagate(const cv::Mat &gray, std::vector<Detection> &out) {
+    if (!ready() || gray.size() != prev_.size()) return false;
+
+    if (!points_.empty()) {
+        cv::calcOpticalFlowPyrLK(prev_, gray, points_, next_, status_, error_,
+                                 cv::Size(params_.win_size, params_.win_size), params_.levels);
+    }
+
+    // 先检查所有框，全部通过才更新状态
+    shifts_.assign(boxes_.size(), cv::Point2f(0, 0));
+    for (size_t b = 0; b < boxes_.size(); b++) {
+        const BoxState &state = boxes_[b];
+        if (state.count == 0) continue;
+        dx_.clear();
+        dy_.clear();
+        for (int i = state.first; i < state.first + state.count; i++) {
+            if (status_[i]) {
+                dx_.push_back(next_[i].x - points_[i].x);
+                dy_.push_back(next_[i].y - points_[i].y);
+            }
+        }
+        if ((float)dx_.size() < params_.min_valid * state.count) {
+            return false;
+        }
+        // 取中位数，不受少数跟错的点（背景、遮挡）影响
+        shifts_[b] = cv::Point2f(median(dx_), median(dy_));
+        cv::Point2f drift = state.drift + shifts_[b];
+        if (std::sqrt(drift.x * drift.x + drift.y * drift.y) > params_.max_drift * state.box.height) {
+            return false;
+        }
+    }
+
+    out.clear();
+    const float inv = 1.f / scale_;
+    for (size_t b = 0; b < boxes_.size(); b++) {
+        BoxState &state = boxes_[b];
+        state.box.x += shifts_[b].x;
+        state.box.y += shifts_[b].y;
+        state.drift += shifts_[b];
+        // 跟丢的点按框的位移补上，保证下一帧点数不变
+        for (int i = state.first; i < state.first + state.count; i++) {
+            points_[i] = status_[i] ? next_[i] : points_[i] + shifts_[b];
+        }
+        out.push_back(state.det);
+        out.back().box = cv::Rect(cvRound(state.box.x * inv), cvRound(state.box.y * inv),
+                                  cvRound(state.box.width * inv), cvRound(state.box.height * inv));
+    }
+    prev_ = gray;
+    frames_++;
+    return true;
+}
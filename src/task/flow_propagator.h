@@ -0,0 +1,69 @@
+// 光流传播：在不推理的帧上，用降采样 Y 平面上的稀疏金字塔 LK 光流平移上一次推理的检测框，
+// 特征点丢失过多或框漂移过大时要求重新推理
+
+#ifndef RK3588_DEMO_FLOW_PROPAGATOR_H
+#define RK3588_DEMO_FLOW_PROPAGATOR_H
+
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "types/yolo_datatype.h"
+
+class FlowPropagator {
+public:
+    struct Params {
+        int width = 480;            // 光流计算用的灰度图宽度（高度按比例）
+        int points_per_box = 8;     // 每个框选取的特征点数
+        int max_frames = 5;         // 两次推理之间最多传播的帧数
+        float max_drift = 0.5f;     // 框累计位移超过框高的该比例时重新推理
+        float min_valid = 0.5f;     // 框内跟踪成功的特征点比例低于该值时重新推理
+        int win_size = 15;
+        int levels = 2;
+    };
+
+    FlowPropagator() = default;
+
+    // frame_size 为检测框所在的坐标系（配置的分辨率）
+    void configure(const Params &params, const cv::Size &frame_size);
+    bool enabled() const { return enabled_; }
+    const Params &params() const { return params_; }
+
+    // 由解码帧的 Y 平面生成降采样灰度图，在解码回调中调用
+    void downsample(const uint8_t *y, int width, int height, int stride, cv::Mat &gray) const;
+
+    // 推理完成后：以该帧为参考帧，在每个框内选特征点
+    void reset(const cv::Mat &gray, const std::vector<Detection> &detections);
+    // 有参考帧且未超过传播帧数上限
+    bool ready() const { return valid_ && frames_ < params_.max_frames; }
+    void invalidate() { valid_ = false; }
+
+    // 跟踪特征点并移动检测框，结果写入 out；漂移超限或特征点丢失时返回 false（out 不变）
+    bool propagate(const cv::Mat &gray, std::vector<Detection> &out);
+
+private:
+    struct BoxState {
+        Detection det;
+        cv::Rect2f box;      // 灰度图坐标
+        int first, count;    // 在 points_ 中的范围
+        cv::Point2f drift;   // 自参考帧以来的累计位移（灰度图坐标）
+    };
+
+    bool enabled_ = false;
+    Params params_;
+    cv::Size frame_size_;
+    float scale_ = 1.f;  // 灰度图坐标 / 配置坐标
+
+    bool valid_ = false;
+    int frames_ = 0;
+    cv::Mat prev_;
+    std::vector<BoxState> boxes_;
+    std::vector<cv::Point2f> points_;
+    std::vector<cv::Point2f> next_;
+    std::vector<uchar> status_;
+    std::vector<float> error_;
+    std::vector<float> dx_, dy_;
+    std::vector<cv::Point2f> shifts_;
+};
+
+#endif // RK3588_DEMO_FLOW_PROPAGATOR_H
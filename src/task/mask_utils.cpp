@@ -1,4 +1,6 @@
 #include "mask_utils.h"
+#include "decode_policy.h"
+#include "count_smoother.h"
 #include <fstream>
 #include <sstream>
 #include <iostream>
@@ -22,7 +24,8 @@ std::vector<CameraConfigInfo> parseCameraConfig(const std::string& configFile) {
             tokens.push_back(token);
         }
         
-        if (tokens.size() < 4) continue;
+        // ȫֲУkey=value parseGlobalOptions 
+        if (tokens.size() < 4 || tokens[0].find('=') != std::string::npos) continue;
         
         config.ip = tokens[0];
         config.username = tokens[1];
@@ -89,6 +92,9 @@ std::vector<CameraConfigInfo> parseCameraConfig(const std::string& configFile) {
                     }
                     config.exclusion_zones.push_back(polygon);
                 }
+            } else if (tokens[i].find('=') != std::string::npos) {
+                // ѡ key=value
+                parseCameraOption(tokens[i], config.options);
             }
         }
         
@@ -111,6 +117,16 @@ std::vector<CameraConfigInfo> parseCameraConfig(const std::string& configFile) {
             }
         }
         // =====  =====
+
+        // ֻδų򣨼ӱ߾ࣩ
+        config.active_region = cv::Rect(0, 0, config.width, config.height);
+        if (config.options.roi && !mask.empty()) {
+            int margin = config.options.roi_margin >= 0 ? config.options.roi_margin
+                                                         : std::max(config.width, config.height) / 10;
+            config.active_region = computeActiveRegion(mask, margin);
+            std::cout << "Inference region for camera " << config.ip
+                      << " (channel " << config.channel << "): " << config.active_region << std::endl;
+        }
         
         configs.push_back(config);
     }
@@ -118,6 +134,283 @@ std::vector<CameraConfigInfo> parseCameraConfig(const std::string& configFile) {
     return configs;
 }
 
+//  "a,b,c" ʽ
+static bool parseFloat3(const std::string& value, float out[3]) {
+    float parsed[3];
+    std::istringstream ss(value);
+    std::string item;
+    int n = 0;
+    while (std::getline(ss, item, ',')) {
+        if (n >= 3) return false;
+        try {
+            parsed[n++] = std::stof(item);
+        } catch (...) {
+            return false;
+        }
+    }
+    if (n != 3) return false;
+    for (int i = 0; i < 3; i++) out[i] = parsed[i];
+    return true;
+}
+
+bool parseCameraOption(const std::string& token, CameraOptions& options) {
+    size_t pos = token.find('=');
+    if (pos == std::string::npos) return false;
+
+    std::string key = token.substr(0, pos);
+    std::string value = token.substr(pos + 1);
+
+    if (key == "preprocess") {
+        options.preprocess = value;
+    } else if (key == "roi") {
+        options.roi = value != "off";
+    } else if (key == "roi_margin") {
+        try {
+            options.roi_margin = std::max(0, std::stoi(value));
+        } catch (...) {
+            std::cerr << "Warning: invalid camera option: " << token << std::endl;
+            return false;
+        }
+    } else if (key == "tiles") {
+        size_t x = value.find('x');
+        try {
+            options.tile_cols = std::max(1, std::stoi(value.substr(0, x)));
+            options.tile_rows = x == std::string::npos ? 1 : std::max(1, std::stoi(value.substr(x + 1)));
+        } catch (...) {
+            std::cerr << "Warning: invalid camera option: " << token << std::endl;
+            return false;
+        }
+    } else if (key == "tile_overlap") {
+        try {
+            options.tile_overlap = std::stof(value);
+        } catch (...) {
+            std::cerr << "Warning: invalid camera option: " << token << std::endl;
+            return false;
+        }
+    } else if (key == "motion") {
+        options.motion = value != "off";
+    } else if (key == "motion_threshold" || key == "motion_refresh") {
+        try {
+            if (key == "motion_threshold") {
+                options.motion_threshold = std::max(1, std::stoi(value));
+            } else {
+                options.motion_refresh = std::max(0.0, std::stod(value));
+            }
+        } catch (...) {
+            std::cerr << "Warning: invalid camera option: " << token << std::endl;
+            return false;
+        }
+    } else if (key == "activity") {
+        options.activity = value != "off";
+    } else if (key == "activity_idle" || key == "activity_refresh") {
+        try {
+            double seconds = std::max(0.1, std::stod(value));
+            (key == "activity_idle" ? options.activity_idle : options.activity_refresh) = seconds;
+        } catch (...) {
+            std::cerr << "Warning: invalid camera option: " << token << std::endl;
+            return false;
+        }
+    } else if (key == "decode") {
+        DecodePolicy policy;
+        if (!parseDecodePolicy(value, policy)) {
+            std::cerr << "Warning: invalid camera option: " << token << std::endl;
+            return false;
+        }
+        options.decode = value;
+    } else if (key == "stream" || key == "display") {
+        bool valid = value == "main" || value == "sub" || (key == "stream" && value == "dual");
+        if (!valid) {
+            std::cerr << "Warning: invalid camera option: " << token << std::endl;
+            return false;
+        }
+        (key == "stream" ? options.stream : options.display) = value;
+    } else if (key == "evidence") {
+        try {
+            options.evidence = std::max(0, std::stoi(value));
+        } catch (...) {
+            std::cerr << "Warning: invalid camera option: " << token << std::endl;
+            return false;
+        }
+    } else if (key == "decoder") {
+        if (value != "playm4" && value != "ffmpeg") {
+            std::cerr << "Warning: invalid camera option: " << token << std::endl;
+            return false;
+        }
+        options.decoder = value;
+    } else if (key == "decode_threads") {
+        try {
+            options.decode_threads = std::max(1, std::stoi(value));
+        } catch (...) {
+            std::cerr << "Warning: invalid camera option: " << token << std::endl;
+            return false;
+        }
+    } else if (key == "decode_size") {
+        // WxHֻʱ߶
+        size_t x = value.find('x');
+        try {
+            options.decode_width = std::max(0, std::stoi(value.substr(0, x)));
+            options.decode_height = x == std::string::npos ? 0 : std::max(0, std::stoi(value.substr(x + 1)));
+        } catch (...) {
+            std::cerr << "Warning: invalid camera option: " << token << std::endl;
+            return false;
+        }
+    } else if (key == "skip_nonref") {
+        options.skip_nonref = value != "off";
+    } else if (key == "track") {
+        options.track = value != "off";
+    } else if (key == "track_interval" || key == "track_gap") {
+        try {
+            if (key == "track_interval") {
+                options.track_interval = std::max(1, std::stoi(value));
+            } else {
+                options.track_gap = std::max(0.0, std::stod(value));
+            }
+        } catch (...) {
+            std::cerr << "Warning: invalid camera option: " << token << std::endl;
+            return false;
+        }
+    } else if (key == "flow") {
+        options.flow = value != "off";
+    } else if (key == "flow_interval" || key == "flow_drift") {
+        try {
+            if (key == "flow_interval") {
+                options.flow_interval = std::max(1, std::stoi(value));
+            } else {
+                options.flow_drift = std::max(0.f, std::stof(value));
+            }
+        } catch (...) {
+            std::cerr << "Warning: invalid camera option: " << token << std::endl;
+            return false;
+        }
+    } else if (key == "cascade") {
+        options.cascade = value == "off" ? "" : value;
+    } else if (key == "cascade_density" || key == "cascade_conf" || key == "cascade_diff") {
+        try {
+            if (key == "cascade_density") {
+                options.cascade_density = std::max(1, std::stoi(value));
+            } else if (key == "cascade_conf") {
+                options.cascade_conf = std::max(0.f, std::min(1.f, std::stof(value)));
+            } else {
+                options.cascade_diff = std::max(1, std::stoi(value));
+            }
+        } catch (...) {
+            std::cerr << "Warning: invalid camera option: " << token << std::endl;
+            return false;
+        }
+    } else if (key == "group") {
+        options.group = value;
+    } else if (key == "smooth_window") {
+        try {
+            options.smooth_window = std::max(0.0, std::stod(value));
+        } catch (...) {
+            std::cerr << "Warning: invalid camera option: " << token << std::endl;
+            return false;
+        }
+    } else if (key == "model") {
+        options.model = value;
+    } else if (key == "input_pack") {
+        options.input_pack = value;
+    } else if (key == "input_mean" || key == "input_std") {
+        if (!parseFloat3(value, key == "input_mean" ? options.input_mean : options.input_std)) {
+            std::cerr << "Warning: invalid camera option: " << token << std::endl;
+            return false;
+        }
+    } else {
+        std::cerr << "Warning: unknown camera option: " << token << std::endl;
+        return false;
+    }
+    return true;
+}
+
+GlobalOptions parseGlobalOptions(const std::string& configFile) {
+    GlobalOptions options;
+    std::ifstream file(configFile);
+    std::string line;
+
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') continue;
+
+        std::istringstream iss(line);
+        std::string token;
+        iss >> token;
+        if (token.find('=') == std::string::npos) continue;
+
+        // ȫֲУֻ key=value
+        do {
+            size_t pos = token.find('=');
+            std::string key = token.substr(0, pos);
+            std::string value = token.substr(pos + 1);
+            try {
+                if (key == "infer_budget") {
+                    options.infer_budget = std::max(0.0, std::stod(value));
+                } else if (key == "infer_min_rate") {
+                    options.infer_min_rate = std::max(0.01, std::stod(value));
+                } else if (key == "infer_max_rate") {
+                    options.infer_max_rate = std::max(0.01, std::stod(value));
+                } else if (key == "overload") {
+                    options.overload = value != "off";
+                } else if (key == "overload_age_ms") {
+                    options.overload_age_ms = std::max(10.0, std::stod(value));
+                } else if (key == "overload_queue") {
+                    options.overload_queue = std::max(1, std::stoi(value));
+                } else if (key == "db_batch_rows") {
+                    options.db_batch_rows = std::max(1, std::stoi(value));
+                } else if (key == "db_batch_ms") {
+                    options.db_batch_ms = std::max(1, std::stoi(value));
+                } else if (key == "db_queue") {
+                    options.db_queue = std::max(16, std::stoi(value));
+                } else if (key == "db_retention_hours") {
+                    options.db_retention_hours = std::max(0, std::stoi(value));
+                } else if (key == "db_change_only") {
+                    options.db_change_only = value != "off";
+                } else if (key == "db_heartbeat_s") {
+                    options.db_heartbeat_s = std::max(1, std::stoi(value));
+                } else if (key == "db_series") {
+                    options.db_series = value != "off";
+                } else if (key == "db_series_resolution_ms") {
+                    options.db_series_resolution_ms = std::max(1, std::stoi(value));
+                } else if (key == "db_series_retention_hours") {
+                    options.db_series_retention_hours = std::max(0, std::stoi(value));
+                } else if (key == "db_hot_hours") {
+                    options.db_hot_hours = std::max(0, std::stoi(value));
+                } else if (key == "db_flush_s") {
+                    options.db_flush_s = std::max(1, std::stoi(value));
+                } else if (key == "db_shards") {
+                    options.db_shards = value == "camera" ? 0 : std::max(1, std::stoi(value));
+                } else if (key == "detection_log") {
+                    options.detection_log = value == "off" ? "" : value;
+                } else if (key == "detection_log_hours") {
+                    options.detection_log_hours = std::max(0, std::stoi(value));
+                } else if (key == "count_windows") {
+                    std::vector<int> windows;
+                    std::istringstream ss(value);
+                    std::string item;
+                    while (std::getline(ss, item, ',')) {
+                        windows.push_back(std::max(1, std::stoi(item)));
+                    }
+                    if (!windows.empty()) options.count_windows = windows;
+                } else if (key == "serial_stat" || key == "db_stat") {
+                    CountSmoother::Statistic statistic;
+                    if (!CountSmoother::parseStatistic(value, statistic)) {
+                        std::cerr << "Warning: invalid global option: " << token << std::endl;
+                    } else {
+                        (key == "serial_stat" ? options.serial_stat : options.db_stat) = value;
+                    }
+                } else if (key == "db_rollup_retention_hours") {
+                    if (!parseFloat3(value, options.db_rollup_retention_hours)) {
+                        std::cerr << "Warning: invalid global option: " << token << std::endl;
+                    }
+                } else {
+                    std::cerr << "Warning: unknown global option: " << token << std::endl;
+                }
+            } catch (...) {
+                std::cerr << "Warning: invalid global option: " << token << std::endl;
+            }
+        } while (iss >> token);
+    }
+    return options;
+}
+
 uchar getMaskValueAtPoint(const cv::Point& p, const cv::Mat& mask) {
     if (p.x < 0 || p.y < 0 || p.x >= mask.cols || p.y >= mask.rows) {
         return 0;
@@ -176,4 +469,27 @@ bool shouldExcludeBox(const cv::Rect& box, const cv::Mat& mask) {
     }
     
     return true;
-}
\ No newline at end of file
+}
+
+cv::Rect computeActiveRegion(const cv::Mat& mask, int margin) {
+    cv::Rect full(0, 0, mask.cols, mask.rows);
+
+    // ɫ0Ϊ
+    std::vector<cv::Point> active;
+    cv::findNonZero(mask == 0, active);
+    if (active.empty()) {
+        return full;
+    }
+
+    cv::Rect region = cv::boundingRect(active);
+    region.x -= margin;
+    region.y -= margin;
+    region.width += margin * 2;
+    region.height += margin * 2;
+    region &= full;
+
+    // ȡż RGA Ӳ
+    region.width &= ~1;
+    region.height &= ~1;
+    return region.area() > 0 ? region : full;
+}
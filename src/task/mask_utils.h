@@ -5,6 +5,75 @@
 #include <vector>
 #include <string>
 
+// Optional per-camera settings, given as key=value tokens on the camera line
+struct CameraOptions {
+    std::string preprocess = "auto";  // preprocess backend: auto/opencv/simd/rga
+    std::string input_pack = "runtime";  // input tensor packing: runtime/layout/native
+    float input_mean[3] = {0.f, 0.f, 0.f};  // must match mean_values used when converting the model
+    float input_std[3] = {255.f, 255.f, 255.f};  // must match std_values used when converting the model
+    bool roi = false;     // run inference only on the bounding rect of the non-excluded region
+    int roi_margin = -1;  // pixels added around that rect; -1 = 10% of the frame size
+    std::string model;    // per-camera model path, empty = the one given on the command line
+    int tile_cols = 1;    // tiled inference grid (tiles=CxR), 1x1 = off
+    int tile_rows = 1;
+    float tile_overlap = 0.2f;  // overlap between neighbouring tiles, fraction of the tile size
+    bool motion = false;        // skip inference and reuse the last detections while nothing moves
+    int motion_threshold = 10;  // per-block luma change counted as motion
+    double motion_refresh = 5;  // force a full inference at least this often, seconds
+    bool activity = false;        // decode key frames only while packet sizes show a static scene
+    double activity_idle = 10;    // seconds without motion before the stream is treated as idle
+    double activity_refresh = 2;  // minimum refresh interval while idle, seconds
+    std::string decode = "full";  // decode policy: full / iframe / target fps; re-read on SIGHUP
+    std::string stream = "main";  // main: main stream only; sub: sub-stream only; dual: sub for inference + main on demand
+    std::string display = "sub";  // dual mode: which stream the window shows
+    int evidence = 0;             // save a snapshot when the valid count reaches this value, 0 = off
+    std::string decoder = "playm4";  // playm4 / ffmpeg (needs a build with ENABLE_FFMPEG_DECODE)
+    int decode_threads = 2;          // ffmpeg: decoder threads for this stream
+    int decode_width = 0;            // ffmpeg: output size (decode_size=WxH), 0 = stream size
+    int decode_height = 0;
+    bool skip_nonref = true;         // ffmpeg: skip frames no other frame references
+    bool track = false;         // track detections and infer only every few frames
+    int track_interval = 5;     // longest inference interval in frames; adapts down when tracks are uncertain
+    double track_gap = 1.0;     // longest time between two inferences, seconds
+    bool flow = false;          // shift the last detections along sparse optical flow between inferences
+    int flow_interval = 5;      // most frames propagated before the next inference
+    float flow_drift = 0.5f;    // re-infer once a box has moved this fraction of its height
+    std::string cascade;        // larger model run on the same frame when the camera's model is unsure, empty = off
+    int cascade_density = 15;   // escalate at this many people
+    float cascade_conf = 0.5f;  // escalate when 30% of the detections score below this
+    int cascade_diff = 3;       // escalate when the count jumps this far from its recent mean
+    std::string group;          // count aggregation group, empty = "all"
+    double smooth_window = 2;   // sliding window of the smoothed count (serial_stat/db_stat), seconds
+};
+
+// Settings shared by all cameras, given as key=value tokens on their own line
+struct GlobalOptions {
+    double infer_budget = 0;         // total inferences per second across all cameras, 0 = unlimited
+    double infer_min_rate = 1;       // lowest inference rate any camera gets, per second
+    double infer_max_rate = 25;      // highest inference rate any camera gets, per second
+    bool overload = false;           // degrade display/overlay/DB/inference step by step when overloaded
+    double overload_age_ms = 500;    // mean frame age (decode to processed) treated as overload
+    int overload_queue = 6;          // inference queue depth treated as overload
+    int db_batch_rows = 500;         // detection rows per SQLite transaction
+    int db_batch_ms = 1000;          // longest time a transaction stays open, milliseconds
+    int db_queue = 8192;             // rows buffered for the writer thread; more are dropped
+    int db_retention_hours = 24 * 7; // raw detection rows older than this are deleted, 0 keeps them
+    float db_rollup_retention_hours[3] = {24 * 7, 24 * 90, 0};  // per-second/minute/hour rollups, 0 keeps them
+    bool db_change_only = false;     // store (start, end, count) spans instead of one row per frame
+    int db_heartbeat_s = 60;         // how often an unchanged span's end time is written
+    bool db_series = false;          // also keep counts as compressed blocks in detection_series
+    int db_series_resolution_ms = 100;  // sample times in compressed blocks are rounded down to this
+    int db_series_retention_hours = 0;  // compressed blocks older than this are deleted, 0 keeps them
+    int db_hot_hours = 0;            // recent rows kept in memory for queries and flushed in batches, 0 is off
+    int db_flush_s = 60;             // with db_hot_hours, how often buffered rows are written to disk
+    int db_shards = 1;               // 1: one database; 0: one per camera; N: cameras split into N groups
+    std::string detection_log;       // directory of the binary per-frame box log, empty when off
+    int detection_log_hours = 24 * 7;  // hourly log segments older than this are deleted, 0 keeps them
+    std::vector<int> count_windows = {1, 10, 60};  // count aggregation windows, seconds
+    std::string serial_stat = "raw"; // count sent on the serial port: raw / max / median / mean over smooth_window
+    std::string db_stat = "raw";     // count stored in the database: raw / max / median / mean over smooth_window
+};
+
 struct CameraConfigInfo {
     std::string ip;
     std::string username;
@@ -13,10 +82,16 @@ struct CameraConfigInfo {
     int width;
     int height;
     std::vector<std::vector<cv::Point>> exclusion_zones;
+    CameraOptions options;
+    cv::Rect active_region;  // inference region in frame coordinates (whole frame when roi is off)
 };
 
 std::vector<CameraConfigInfo> parseCameraConfig(const std::string& configFile);
+bool parseCameraOption(const std::string& token, CameraOptions& options);
+GlobalOptions parseGlobalOptions(const std::string& configFile);
 cv::Mat createExclusionMask(int width, int height, const std::vector<std::vector<cv::Point>>& exclusion_zones);
+// Bounding rect of the non-excluded (zero) mask pixels grown by margin and clipped to the mask
+cv::Rect computeActiveRegion(const cv::Mat& mask, int margin);
 uchar getMaskValueAtPoint(const cv::Point& p, const cv::Mat& mask);
 bool shouldExcludeBox(const cv::Rect& box, const cv::Mat& mask);
 
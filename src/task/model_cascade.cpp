@@ -0,0 +1,85 @@
+#include "model_cascade.h"
+
+#include <algorithm>
+#include <cmath>
+
+static float iou(const cv::Rect &a, const cv::Rect &b) {
+    float inter = (float)(a & b).area();
+    float uni = (float)a.area() + b.area() - inter;
+    return uni > 0 ? inter / uni : 0.f;
+}
+
+void ModelCascade::configure(const Params &params) {
+    params_ = params;
+    params_.density = std::max(1, params_.density);
+    params_.count_diff = std::max(1, params_.count_diff);
+    params_.window_seconds = std::max(0.1, params_.window_seconds);
+    has_mean_ = false;
+    escalated_once_ = false;
+    stats_ = Stats();
+    enabled_ = true;
+}
+
+bool ModelCascade::shouldEscalate(const std::vector<Detection> &small, std::chrono::steady_clock::time_point now) {
+    if (!enabled_) return false;
+    stats_.frames++;
+
+    const int count = (int)small.size();
+    bool density = count >= params_.density;
+
+    int low = 0;
+    for (const auto &det : small) {
+        if (det.confidence < params_.low_conf) low++;
+    }
+    bool low_conf = low > 0 && low >= params_.low_conf_ratio * count;
+
+    // 与最近均值比较：突然多出或少了几个人，说明小模型在这一帧可能漏检或误检
+    bool disagree = false;
+    if (!has_mean_) {
+        mean_ = count;
+        has_mean_ = true;
+    } else {
+        double diff = std::fabs(count - mean_);
+        disagree = diff >= params_.count_diff && diff >= 0.2 * mean_;
+        double dt = std::chrono::duration<double>(now - last_update_).count();
+        double alpha = 1.0 - std::exp(-std::max(0.0, dt) / params_.window_seconds);
+        mean_ += alpha * (count - mean_);
+    }
+    last_update_ = now;
+
+    bool held = escalated_once_ &&
+                std::chrono::duration<double>(now - last_escalation_).count() < params_.hold_seconds;
+
+    stats_.density += density;
+    stats_.low_conf += low_conf;
+    stats_.disagree += disagree;
+    if (!(density || low_conf || disagree)) {
+        if (!held) return false;
+        stats_.held++;
+    } else {
+        last_escalation_ = now;
+        escalated_once_ = true;
+    }
+    stats_.escalated++;
+    return true;
+}
+
+void ModelCascade::merge(const std::vector<Detection> &small, std::vector<Detection> &large) const {
+    const size_t n = large.size();
+    for (const auto &det : small) {
+        if (det.confidence < params_.keep_conf) continue;
+        bool covered = false;
+        for (size_t i = 0; i < n && !covered; i++) {
+            covered = large[i].class_id == det.class_id && iou(large[i].box, det.box) >= params_.merge_iou;
+        }
+        if (!covered) {
+            large.push_back(det);
+        }
+    }
+}
+
+ModelCascade::Stats ModelCascade::takeStats() {
+    Stats stats = stats_;
+    stats_ = Stats();
+    return stats;
+}
@@ -0,0 +1,57 @@
+// 模型级联：小模型每次推理都运行，人多、低置信度检测偏多或人数与最近均值相差较大时，
+// 同一帧再用大模型推理，两者的结果按摄像头合并
+
+#ifndef RK3588_DEMO_MODEL_CASCADE_H
+#define RK3588_DEMO_MODEL_CASCADE_H
+
+#include <chrono>
+#include <vector>
+
+#include "types/yolo_datatype.h"
+
+class ModelCascade {
+public:
+    struct Params {
+        int density = 15;             // 小模型人数达到该值时升级
+        float low_conf = 0.5f;        // 置信度低于该值的检测算作低置信度
+        float low_conf_ratio = 0.3f;  // 低置信度检测占比达到该值时升级
+        int count_diff = 3;           // 人数与最近均值相差达到该值（且超过均值的 20%）时升级
+        double window_seconds = 5;    // 人数均值的统计窗口（指数滑动）
+        double hold_seconds = 2;      // 升级后至少保持的时间，避免两个模型的人数来回跳
+        float merge_iou = 0.5f;       // 小模型的框与大模型的框 IoU 低于该值才算大模型漏检
+        float keep_conf = 0.7f;       // 大模型漏检的框，小模型置信度达到该值才保留
+    };
+
+    struct Stats {
+        int frames = 0;     // 小模型推理次数
+        int escalated = 0;  // 其中运行了大模型的次数
+        int density = 0;    // 各触发原因的次数（同一帧可能有多个原因）
+        int low_conf = 0;
+        int disagree = 0;
+        int held = 0;
+    };
+
+    void configure(const Params &params);
+    bool enabled() const { return enabled_; }
+    const Params &params() const { return params_; }
+
+    // 小模型结果出来后调用，返回该帧是否还要运行大模型
+    bool shouldEscalate(const std::vector<Detection> &small, std::chrono::steady_clock::time_point now);
+    // 合并：以大模型结果为准，补上大模型漏掉的小模型高置信度框，结果写入 large
+    void merge(const std::vector<Detection> &small, std::vector<Detection> &large) const;
+
+    Stats takeStats();
+
+private:
+    bool enabled_ = false;
+    Params params_;
+
+    bool has_mean_ = false;
+    double mean_ = 0;
+    std::chrono::steady_clock::time_point last_update_;
+    std::chrono::steady_clock::time_point last_escalation_;
+    bool escalated_once_ = false;
+    Stats stats_;
+};
+
+#endif // RK3588_DEMO_MODEL_CASCADE_H
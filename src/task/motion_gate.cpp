@@ -0,0 +1,84 @@
+#include "motion_gate.h"
+
+#include <stdlib.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+void MotionGate::configure(const Params &params, const cv::Rect &region, const cv::Size &frame_size) {
+    params_ = params;
+    params_.cell = std::max(4, params_.cell);
+    region_ = region;
+    frame_size_ = frame_size;
+    reference_.release();
+    enabled_ = true;
+}
+
+void MotionGate::thumbnail(const uint8_t *y, int width, int height, int stride, cv::Mat &thumb) const {
+    const int cell = params_.cell;
+    const int cols = width / cell;
+    const int rows = height / cell;
+    // 每个块只取 4x4 个采样点，足以反映亮度变化
+    const int step = std::max(1, cell / 4);
+    const int samples = ((cell + step - 1) / step) * ((cell + step - 1) / step);
+
+    thumb.create(rows, cols, CV_8UC1);
+    std::vector<uint32_t> sums(cols);
+    for (int r = 0; r < rows; r++) {
+        std::fill(sums.begin(), sums.end(), 0);
+        for (int dy = 0; dy < cell; dy += step) {
+            const uint8_t *line = y + (size_t)(r * cell + dy) * stride;
+            for (int c = 0; c < cols; c++) {
+                const uint8_t *p = line + c * cell;
+                uint32_t s = 0;
+                for (int dx = 0; dx < cell; dx += step) {
+                    s += p[dx];
+                }
+                sums[c] += s;
+            }
+        }
+        uint8_t *out = thumb.ptr<uint8_t>(r);
+        for (int c = 0; c < cols; c++) {
+            out[c] = (uint8_t)(sums[c] / samples);
+        }
+    }
+}
+
+bool MotionGate::shouldInfer(const cv::Mat &thumb, std::chrono::steady_clock::time_point now) const {
+    if (!enabled_ || thumb.empty() || reference_.empty() || reference_.size() != thumb.size()) {
+        return true;
+    }
+    if (std::chrono::duration<double>(now - last_infer_).count() >= params_.refresh_seconds) {
+        return true;
+    }
+
+    // 关注区域换算到缩略图坐标
+    const double sx = (double)thumb.cols / std::max(1, frame_size_.width);
+    const double sy = (double)thumb.rows / std::max(1, frame_size_.height);
+    cv::Rect area((int)(region_.x * sx), (int)(region_.y * sy),
+                  (int)std::ceil(region_.width * sx) + 1, (int)std::ceil(region_.height * sy) + 1);
+    area &= cv::Rect(0, 0, thumb.cols, thumb.rows);
+    if (area.area() <= 0) {
+        area = cv::Rect(0, 0, thumb.cols, thumb.rows);
+    }
+
+    int changed = 0;
+    for (int r = area.y; r < area.y + area.height; r++) {
+        const uint8_t *cur = thumb.ptr<uint8_t>(r);
+        const uint8_t *ref = reference_.ptr<uint8_t>(r);
+        for (int c = area.x; c < area.x + area.width; c++) {
+            if (abs(cur[c] - ref[c]) > params_.pixel_threshold && ++changed >= params_.min_changed_cells) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void MotionGate::accept(const cv::Mat &thumb, std::chrono::steady_clock::time_point now) {
+    if (!thumb.empty()) {
+        thumb.copyTo(reference_);
+    }
+    last_infer_ = now;
+}
@@ -0,0 +1,45 @@
+// 运动门控：在提交推理前用降采样的 Y 平面做帧差，画面没有变化时复用上一次的检测结果
+
+#ifndef RK3588_DEMO_MOTION_GATE_H
+#define RK3588_DEMO_MOTION_GATE_H
+
+#include <stdint.h>
+
+#include <chrono>
+
+#include <opencv2/opencv.hpp>
+
+class MotionGate {
+public:
+    struct Params {
+        int cell = 16;               // 缩略图每个像素对应原图 cell x cell 的块
+        int pixel_threshold = 10;    // 块均值变化超过该灰度值认为该块有变化
+        int min_changed_cells = 2;   // 有变化的块数达到该值才认为画面有变化
+        double refresh_seconds = 5;  // 即使画面不变，也至少每隔这么久推理一次
+    };
+
+    MotionGate() = default;
+
+    // region 为需要关注的区域，frame_size 为 region 所在的坐标系（配置的分辨率），只比较该区域内的块；
+    // 实际解码的分辨率可以不同（如子码流），比较时按比例换算
+    void configure(const Params &params, const cv::Rect &region, const cv::Size &frame_size);
+    bool enabled() const { return enabled_; }
+
+    // 由 Y 平面生成块均值缩略图（CV_8UC1），在解码回调中对每一帧调用
+    void thumbnail(const uint8_t *y, int width, int height, int stride, cv::Mat &thumb) const;
+
+    // 与参考帧相比画面是否有变化，或者距上次推理已超过刷新间隔
+    bool shouldInfer(const cv::Mat &thumb, std::chrono::steady_clock::time_point now) const;
+    // 推理完成后把该帧作为新的参考帧
+    void accept(const cv::Mat &thumb, std::chrono::steady_clock::time_point now);
+
+private:
+    bool enabled_ = false;
+    Params params_;
+    cv::Rect region_;
+    cv::Size frame_size_;
+    cv::Mat reference_;
+    std::chrono::steady_clock::time_point last_infer_;
+};
+
+#endif // RK3588_DEMO_MOTION_GATE_H
@@ -0,0 +1,100 @@
+#include "overload_controller.h"
+
+#include <algorithm>
+
+void OverloadController::configure(const Params &params) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    params_ = params;
+    params_.recover_age_ms = std::min(params_.recover_age_ms, params_.max_age_ms);
+    params_.max_queue = std::max(1, params_.max_queue);
+    params_.display_fps = std::max(0.1, params_.display_fps);
+    params_.infer_rate = std::max(0.1, params_.infer_rate);
+    display_interval_ = 1.0 / params_.display_fps;
+    infer_interval_ = 1.0 / params_.infer_rate;
+    enabled_ = params_.enabled;
+    if (!enabled_) {
+        level_ = kNormal;
+    }
+    overload_seconds_ = 0;
+    headroom_seconds_ = 0;
+}
+
+void OverloadController::report(double frame_age_ms, int queue_depth) {
+    if (!enabled_) return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    age_sum_ += frame_age_ms;
+    age_count_++;
+    age_max_ = std::max(age_max_, frame_age_ms);
+    queue_max_ = std::max(queue_max_, queue_depth);
+}
+
+bool OverloadController::evaluate(std::chrono::steady_clock::time_point now) {
+    if (!enabled_) return false;
+    std::lock_guard<std::mutex> lock(mutex_);
+    double dt = has_eval_ ? std::chrono::duration<double>(now - last_eval_).count() : 0;
+    last_eval_ = now;
+    has_eval_ = true;
+
+    double mean_age = age_count_ > 0 ? age_sum_ / age_count_ : 0;
+    last_ = {level_, mean_age, age_max_, queue_max_};
+    bool reported = age_count_ > 0;
+    age_sum_ = 0;
+    age_count_ = 0;
+    age_max_ = 0;
+    queue_max_ = 0;
+    // 没有任何帧处理完成时无法判断，保持当前状态
+    if (!reported) return false;
+
+    bool overloaded = mean_age > params_.max_age_ms || last_.max_queue > params_.max_queue;
+    bool headroom = mean_age < params_.recover_age_ms && last_.max_queue <= params_.max_queue / 2;
+    overload_seconds_ = overloaded ? overload_seconds_ + dt : 0;
+    headroom_seconds_ = headroom ? headroom_seconds_ + dt : 0;
+
+    // 每次只移动一级，下一级要重新累计时间，避免一次负载尖峰直接降到底
+    int level = level_;
+    if (overload_seconds_ >= params_.escalate_seconds && level < kMaxLevel) {
+        level++;
+        overload_seconds_ = 0;
+    } else if (headroom_seconds_ >= params_.recover_seconds && level > kNormal) {
+        level--;
+        headroom_seconds_ = 0;
+    }
+    if (level == level_) return false;
+    level_ = level;
+    last_.level = level;
+    return true;
+}
+
+OverloadController::Params OverloadController::params() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return params_;
+}
+
+OverloadController::Metrics OverloadController::metrics() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return last_;
+}
+
+bool OverloadController::displayDue(std::chrono::steady_clock::time_point last,
+                                    std::chrono::steady_clock::time_point now) const {
+    if (level_ < kDisplayRate) return true;
+    return std::chrono::duration<double>(now - last).count() >= display_interval_.load(std::memory_order_relaxed);
+}
+
+bool OverloadController::inferenceAllowed(std::chrono::steady_clock::time_point last,
+                                          std::chrono::steady_clock::time_point now) const {
+    if (level_ < kInferRate) return true;
+    return std::chrono::duration<double>(now - last).count() >= infer_interval_.load(std::memory_order_relaxed);
+}
+
+const char *OverloadController::levelName(int level) {
+    switch (level) {
+    case kNormal: return "normal";
+    case kDisplayRate: return "display rate";
+    case kNoOverlay: return "no overlay";
+    case kDbDetail: return "db detail";
+    case kLightInference: return "light inference";
+    case kInferRate: return "inference rate";
+    default: return "unknown";
+    }
+}
@@ -0,0 +1,82 @@
+// 过载控制：各摄像头线程上报帧龄（解码到处理完成的时间）和推理队列深度，主线程每秒评估一次，
+// 持续过载时按固定顺序逐级降级，恢复余量后按相反顺序逐级恢复；人数统计和串口输出不受降级影响
+
+#ifndef RK3588_DEMO_OVERLOAD_CONTROLLER_H
+#define RK3588_DEMO_OVERLOAD_CONTROLLER_H
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+
+class OverloadController {
+public:
+    // 降级顺序，级别越高包含的降级越多
+    enum Level {
+        kNormal = 0,
+        kDisplayRate = 1,    // 降低显示帧率
+        kNoOverlay = 2,      // 不画检测框和文字
+        kDbDetail = 3,       // 数据库每秒一行（该秒最大人数），不保存证据截图
+        kLightInference = 4, // 关闭分块推理和级联大模型，每次推理只有一个小模型任务
+        kInferRate = 5,      // 限制每路推理帧率
+        kMaxLevel = kInferRate
+    };
+
+    struct Params {
+        bool enabled = false;
+        double max_age_ms = 500;        // 帧龄均值超过该值视为过载
+        double recover_age_ms = 150;    // 帧龄均值低于该值视为有余量
+        int max_queue = 6;              // 任一路推理队列超过该深度视为过载
+        double escalate_seconds = 2;    // 持续过载多久升一级
+        double recover_seconds = 10;    // 持续有余量多久降一级
+        double display_fps = 5;         // kDisplayRate 及以上的显示帧率
+        double infer_rate = 5;          // kInferRate 的每路推理次数/秒
+    };
+
+    struct Metrics {
+        int level;
+        double mean_age_ms;  // 上一个评估周期的帧龄均值
+        double max_age_ms;
+        int max_queue;
+    };
+
+    // configure 可以在摄像头线程运行时调用（SIGHUP 重新加载）
+    void configure(const Params &params);
+    bool enabled() const { return enabled_; }
+    Params params() const;
+    int level() const { return level_; }
+
+    // 摄像头线程每处理完一帧调用
+    void report(double frame_age_ms, int queue_depth);
+    // 主线程定期调用，返回级别是否变化
+    bool evaluate(std::chrono::steady_clock::time_point now);
+    Metrics metrics();
+
+    // kDisplayRate 及以上按 display_fps 限制显示，last 为该路上次显示的时间
+    bool displayDue(std::chrono::steady_clock::time_point last, std::chrono::steady_clock::time_point now) const;
+    // kInferRate 按 infer_rate 限制推理，last 为该路上次推理的时间
+    bool inferenceAllowed(std::chrono::steady_clock::time_point last, std::chrono::steady_clock::time_point now) const;
+
+    static const char *levelName(int level);
+
+private:
+    std::atomic<bool> enabled_{false};
+    std::atomic<int> level_{kNormal};
+    // 摄像头线程每帧读取的两个间隔（秒），由 configure 更新，不经过 mutex_
+    std::atomic<double> display_interval_{1.0 / 5};
+    std::atomic<double> infer_interval_{1.0 / 5};
+
+    mutable std::mutex mutex_;
+    Params params_;
+    double age_sum_ = 0;
+    int age_count_ = 0;
+    double age_max_ = 0;
+    int queue_max_ = 0;
+    Metrics last_{kNormal, 0, 0, 0};
+
+    bool has_eval_ = false;
+    std::chrono::steady_clock::time_point last_eval_;
+    double overload_seconds_ = 0;
+    double headroom_seconds_ = 0;
+};
+
+#endif // RK3588_DEMO_OVERLOAD_CONTROLLER_H
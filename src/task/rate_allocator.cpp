@@ -0,0 +1,122 @@
+#include "rate_allocator.h"
+
+#include <algorithm>
+#include <cmath>
+
+// 令牌桶容量：允许短时间内补上一次被拒绝的推理
+static const double kMaxTokens = 2.0;
+
+void InferenceRateAllocator::configure(const Params &params) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    params_ = params;
+    params_.min_rate = std::max(0.01, params_.min_rate);
+    params_.max_rate = std::max(params_.min_rate, params_.max_rate);
+    enabled_ = params_.budget > 0;
+    rebalance();
+}
+
+int InferenceRateAllocator::addCamera(const std::string &id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Slot slot;
+    slot.id = id;
+    slot.last_refill = std::chrono::steady_clock::now();
+    slots_.push_back(slot);
+    rebalance();
+    return (int)slots_.size() - 1;
+}
+
+void InferenceRateAllocator::rebalance() {
+    const size_t n = slots_.size();
+    if (n == 0) return;
+
+    // 权重：1（空场景也分一点）+ 人数均值 + 变化程度
+    std::vector<double> weight(n);
+    std::vector<bool> capped(n, false);
+    for (size_t i = 0; i < n; i++) {
+        weight[i] = 1.0 + slots_[i].mean + params_.change_weight * std::sqrt(slots_[i].var);
+        slots_[i].rate = params_.min_rate;
+    }
+
+    // 先保证最低帧率，剩余预算按权重分配；达到上限的摄像头把多出的份额让给其他摄像头
+    double spare = std::max(0.0, params_.budget - params_.min_rate * n);
+    for (size_t round = 0; round < n && spare > 1e-6; round++) {
+        double total = 0;
+        for (size_t i = 0; i < n; i++) {
+            if (!capped[i]) total += weight[i];
+        }
+        if (total <= 0) break;
+        double left = 0;
+        for (size_t i = 0; i < n; i++) {
+            if (capped[i]) continue;
+            double rate = slots_[i].rate + spare * weight[i] / total;
+            if (rate >= params_.max_rate) {
+                left += rate - params_.max_rate;
+                rate = params_.max_rate;
+                capped[i] = true;
+            }
+            slots_[i].rate = rate;
+        }
+        spare = left;
+    }
+}
+
+bool InferenceRateAllocator::acquire(int slot, std::chrono::steady_clock::time_point now) {
+    if (!enabled_) return true;
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (slot < 0 || slot >= (int)slots_.size()) return true;
+
+    if (std::chrono::duration<double>(now - last_rebalance_).count() >= params_.rebalance_seconds) {
+        rebalance();
+        last_rebalance_ = now;
+    }
+
+    Slot &s = slots_[slot];
+    double dt = std::chrono::duration<double>(now - s.last_refill).count();
+    s.last_refill = now;
+    s.tokens = std::min(kMaxTokens, s.tokens + std::max(0.0, dt) * s.rate);
+    if (s.tokens >= 1.0) {
+        s.tokens -= 1.0;
+        s.granted++;
+        return true;
+    }
+    s.denied++;
+    return false;
+}
+
+void InferenceRateAllocator::report(int slot, int count, std::chrono::steady_clock::time_point now) {
+    if (!enabled_) return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (slot < 0 || slot >= (int)slots_.size()) return;
+
+    Slot &s = slots_[slot];
+    if (!s.has_report) {
+        s.mean = count;
+        s.var = 0;
+        s.has_report = true;
+    } else {
+        // 按时间间隔的指数滑动均值/方差，推理频率不同的摄像头用同样的时间窗口
+        double dt = std::chrono::duration<double>(now - s.last_report).count();
+        double alpha = 1.0 - std::exp(-std::max(0.0, dt) / params_.window_seconds);
+        double diff = count - s.mean;
+        s.mean += alpha * diff;
+        s.var = (1.0 - alpha) * (s.var + alpha * diff * diff);
+    }
+    s.last_report = now;
+}
+
+double InferenceRateAllocator::rate(int slot) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (slot < 0 || slot >= (int)slots_.size()) return 0;
+    return slots_[slot].rate;
+}
+
+std::vector<InferenceRateAllocator::Metrics> InferenceRateAllocator::takeMetrics() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<Metrics> metrics;
+    for (auto &s : slots_) {
+        metrics.push_back({s.id, s.rate, s.mean, std::sqrt(s.var), s.granted, s.denied});
+        s.granted = 0;
+        s.denied = 0;
+    }
+    return metrics;
+}
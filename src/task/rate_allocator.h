@@ -0,0 +1,72 @@
+// 推理帧率分配：所有摄像头共享一个全局推理预算（次/秒），按各路最近的人数和人数变化分配，
+// 每路保证最低帧率；在提交到 Yolov8ThreadPool 之前调用 acquire 决定本帧是否推理
+
+#ifndef RK3588_DEMO_RATE_ALLOCATOR_H
+#define RK3588_DEMO_RATE_ALLOCATOR_H
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class InferenceRateAllocator {
+public:
+    struct Params {
+        double budget = 0;              // 全局推理次数/秒，0 为不限制
+        double min_rate = 1;            // 每路最低推理次数/秒
+        double max_rate = 25;           // 每路最高推理次数/秒（一般为码流帧率）
+        double window_seconds = 30;     // 人数均值/方差的统计窗口（指数滑动）
+        double change_weight = 2;       // 人数标准差相对人数均值的权重
+        double rebalance_seconds = 1;   // 重新分配的间隔
+    };
+
+    struct Metrics {
+        std::string id;
+        double rate;     // 当前分配的推理次数/秒
+        double mean;     // 人数均值
+        double stddev;   // 人数标准差
+        int granted;     // 上次取指标以来允许的推理次数
+        int denied;      // 上次取指标以来被预算拒绝的次数
+    };
+
+    void configure(const Params &params);
+    bool enabled() const { return enabled_; }
+    const Params &params() const { return params_; }
+
+    // 在摄像头线程启动前注册，返回该路的编号
+    int addCamera(const std::string &id);
+
+    // 本帧是否可以推理（令牌桶，按分配的帧率补充）
+    bool acquire(int slot, std::chrono::steady_clock::time_point now);
+    // 每次推理后上报有效人数
+    void report(int slot, int count, std::chrono::steady_clock::time_point now);
+
+    double rate(int slot);
+    // 各路指标快照，granted/denied 取出后清零
+    std::vector<Metrics> takeMetrics();
+
+private:
+    struct Slot {
+        std::string id;
+        double mean = 0;
+        double var = 0;
+        bool has_report = false;
+        std::chrono::steady_clock::time_point last_report;
+        double rate = 0;
+        double tokens = 1;
+        std::chrono::steady_clock::time_point last_refill;
+        int granted = 0;
+        int denied = 0;
+    };
+
+    void rebalance();
+
+    std::atomic<bool> enabled_{false};
+    Params params_;
+    std::mutex mutex_;
+    std::vector<Slot> slots_;
+    std::chrono::steady_clock::time_point last_rebalance_;
+};
+
+#endif // RK3588_DEMO_RATE_ALLOCATOR_H
@@ -0,0 +1,95 @@
+#include "stream_activity.h"
+
+#include <algorithm>
+
+// 海康 PS 流：每帧以包头 00 00 01 BA 开始，关键帧带系统头 00 00 01 BB，视频 PES 为 00 00 01 E0
+static const size_t kHeaderScanBytes = 512;
+
+static bool hasStartCode(const uint8_t *data, size_t size, uint8_t stream_id) {
+    size = std::min(size, kHeaderScanBytes);
+    for (size_t i = 0; i + 3 < size; i++) {
+        if (data[i] == 0 && data[i + 1] == 0 && data[i + 2] == 1 && data[i + 3] == stream_id) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static int64_t toMs(std::chrono::steady_clock::time_point t) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(t.time_since_epoch()).count();
+}
+
+StreamActivityEstimator::StreamActivityEstimator(const StreamActivityEstimator &other) {
+    *this = other;
+}
+
+StreamActivityEstimator &StreamActivityEstimator::operator=(const StreamActivityEstimator &other) {
+    if (this != &other) {
+        enabled_ = other.enabled_;
+        params_ = other.params_;
+        frame_bytes_ = other.frame_bytes_;
+        frame_key_ = other.frame_key_;
+        frame_video_ = other.frame_video_;
+        fast_bytes_ = other.fast_bytes_;
+        baseline_ = other.baseline_;
+        last_active_ = other.last_active_;
+        last_key_ms_ = other.last_key_ms_.load();
+        idle_ = other.idle_.load();
+        activity_ = other.activity_.load();
+    }
+    return *this;
+}
+
+void StreamActivityEstimator::configure(const Params &params) {
+    params_ = params;
+    enabled_ = true;
+    frame_bytes_ = 0;
+    fast_bytes_ = 0;
+    baseline_ = 0;
+    last_active_ = std::chrono::steady_clock::now();
+    last_key_ms_ = toMs(last_active_);
+    idle_ = false;
+}
+
+void StreamActivityEstimator::feed(const uint8_t *data, size_t size, std::chrono::steady_clock::time_point now) {
+    if (!enabled_ || size < 4) return;
+
+    // 新的 PS 包头：上一帧结束
+    if (data[0] == 0 && data[1] == 0 && data[2] == 1 && data[3] == 0xBA) {
+        finishFrame(now);
+        frame_key_ = hasStartCode(data, size, 0xBB);
+        frame_video_ = false;
+    }
+    frame_video_ = frame_video_ || hasStartCode(data, size, 0xE0);
+    frame_bytes_ += size;
+}
+
+void StreamActivityEstimator::finishFrame(std::chrono::steady_clock::time_point now) {
+    size_t bytes = frame_bytes_;
+    frame_bytes_ = 0;
+    if (bytes == 0 || !frame_video_) return;
+
+    if (frame_key_) {
+        last_key_ms_ = toMs(now);
+        return;
+    }
+
+    // 基线跟踪 P 帧大小的低位：变小时快速跟随，变大时缓慢上升（适应夜间噪点、码率变化）
+    if (baseline_ <= 0) {
+        baseline_ = bytes;
+        fast_bytes_ = bytes;
+    }
+    fast_bytes_ += 0.2 * (bytes - fast_bytes_);
+    baseline_ += (bytes < baseline_ ? 0.1 : 0.002) * (bytes - baseline_);
+
+    activity_ = (float)(fast_bytes_ / std::max(1.0, baseline_));
+    bool active = fast_bytes_ > baseline_ * params_.active_ratio && fast_bytes_ - baseline_ > params_.active_margin;
+    if (active) {
+        last_active_ = now;
+    }
+    idle_ = std::chrono::duration<double>(now - last_active_).count() >= params_.idle_seconds;
+}
+
+double StreamActivityEstimator::secondsSinceKeyFrame(std::chrono::steady_clock::time_point now) const {
+    return (toMs(now) - last_key_ms_.load()) / 1000.0;
+}
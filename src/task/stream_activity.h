@@ -0,0 +1,58 @@
+// 码流活跃度估计：不解码，只根据编码后 P 帧的字节数判断画面是否有运动
+// 静止画面的 P 帧只有几百字节，有人走动时会大上一个数量级
+
+#ifndef RK3588_DEMO_STREAM_ACTIVITY_H
+#define RK3588_DEMO_STREAM_ACTIVITY_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <atomic>
+#include <chrono>
+
+class StreamActivityEstimator {
+public:
+    struct Params {
+        double active_ratio = 2.5;    // P 帧大小的短期均值超过静止基线的倍数认为有运动
+        int active_margin = 1024;     // 同时至少要比基线大这么多字节，避免基线很小时误判
+        double idle_seconds = 10;     // 持续这么久没有运动才进入空闲状态
+        double refresh_seconds = 2;   // 空闲时最少每隔这么久刷新一帧
+    };
+
+    StreamActivityEstimator() = default;
+    StreamActivityEstimator(const StreamActivityEstimator &other);
+    StreamActivityEstimator &operator=(const StreamActivityEstimator &other);
+
+    void configure(const Params &params);
+    bool enabled() const { return enabled_; }
+    const Params &params() const { return params_; }
+
+    // 输入一个 PS 封装的码流包（RealDataCallBack_V30 收到的数据），只在码流回调线程中调用
+    void feed(const uint8_t *data, size_t size, std::chrono::steady_clock::time_point now);
+
+    // 以下可在其他线程读取
+    bool idle() const { return idle_.load(); }
+    // 距离上一个关键帧的秒数
+    double secondsSinceKeyFrame(std::chrono::steady_clock::time_point now) const;
+    float activity() const { return activity_.load(); }  // 短期 P 帧大小 / 基线
+
+private:
+    void finishFrame(std::chrono::steady_clock::time_point now);
+
+    bool enabled_ = false;
+    Params params_;
+
+    // 当前帧（从一个 PS 包头开始，到下一个包头之前）
+    size_t frame_bytes_ = 0;
+    bool frame_key_ = false;
+    bool frame_video_ = false;
+
+    double fast_bytes_ = 0;  // P 帧大小的短期均值
+    double baseline_ = 0;    // 静止画面的 P 帧大小，快降慢升
+    std::chrono::steady_clock::time_point last_active_;
+    std::atomic<int64_t> last_key_ms_{0};
+    std::atomic<bool> idle_{false};
+    std::atomic<float> activity_{0.f};
+};
+
+#endif // RK3588_DEMO_STREAM_ACTIVITY_H
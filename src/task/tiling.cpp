@@ -0,0 +1,144 @@
+#include "tiling.h"
+
+#include <algorithm>
+#include <cmath>
+
+// 框边缘离切边不超过该像素数时认为被切断
+static const int kCutTolerance = 4;
+
+std::vector<cv::Rect> planTiles(const cv::Rect &area, int cols, int rows, float overlap) {
+    std::vector<cv::Rect> tiles;
+    cols = std::max(1, cols);
+    rows = std::max(1, rows);
+    overlap = std::max(0.f, std::min(overlap, 0.5f));
+
+    // 块大小：cols 个块、相邻重叠 overlap 恰好覆盖 area；宽高取偶数，所有块大小相同以共用预处理几何缓存
+    int tile_w = (int)std::ceil(area.width / (cols - (cols - 1) * overlap));
+    int tile_h = (int)std::ceil(area.height / (rows - (rows - 1) * overlap));
+    tile_w = std::min((tile_w + 1) & ~1, area.width & ~1);
+    tile_h = std::min((tile_h + 1) & ~1, area.height & ~1);
+    if (tile_w <= 0 || tile_h <= 0) {
+        tiles.push_back(area);
+        return tiles;
+    }
+
+    for (int r = 0; r < rows; r++) {
+        int y = rows > 1 ? area.y + (area.height - tile_h) * r / (rows - 1) : area.y;
+        for (int c = 0; c < cols; c++) {
+            int x = cols > 1 ? area.x + (area.width - tile_w) * c / (cols - 1) : area.x;
+            tiles.emplace_back(x, y, tile_w, tile_h);
+        }
+    }
+    return tiles;
+}
+
+namespace {
+    struct Candidate {
+        Detection det;
+        int tile;
+        bool cut;
+    };
+
+    bool touchesCut(const cv::Rect &box, const cv::Rect &tile, const cv::Rect &area) {
+        if (tile.x > area.x && box.x - tile.x <= kCutTolerance) return true;
+        if (tile.y > area.y && box.y - tile.y <= kCutTolerance) return true;
+        if (tile.br().x < area.br().x && tile.br().x - box.br().x <= kCutTolerance) return true;
+        if (tile.br().y < area.br().y && tile.br().y - box.br().y <= kCutTolerance) return true;
+        return false;
+    }
+}
+
+std::vector<Detection> mergeTileDetections(const std::vector<TileResult> &tiles, const cv::Rect &area,
+                                           float iou_threshold, float iomin_threshold) {
+    std::vector<Candidate> candidates;
+    for (size_t t = 0; t < tiles.size(); t++) {
+        for (const auto &det : tiles[t].detections) {
+            candidates.push_back({det, (int)t, touchesCut(det.box, tiles[t].region, area)});
+        }
+    }
+    if (tiles.size() <= 1) {
+        std::vector<Detection> objects;
+        for (auto &cand : candidates) objects.push_back(cand.det);
+        return objects;
+    }
+
+    // 完整的框优先，其次按置信度
+    std::stable_sort(candidates.begin(), candidates.end(), [](const Candidate &a, const Candidate &b) {
+        if (a.cut != b.cut) return !a.cut;
+        return a.det.confidence > b.det.confidence;
+    });
+
+    std::vector<Candidate> kept;
+    for (auto &cand : candidates) {
+        bool merged = false;
+        for (auto &k : kept) {
+            // 同一分块内的框在后处理中已经做过 NMS
+            if (k.tile == cand.tile) continue;
+            int inter = (k.det.box & cand.det.box).area();
+            if (inter <= 0) continue;
+
+            int area_k = k.det.box.area();
+            int area_c = cand.det.box.area();
+            float iou = (float)inter / (area_k + area_c - inter);
+            float iomin = (float)inter / std::max(1, std::min(area_k, area_c));
+            if (iou < iou_threshold && !((k.cut || cand.cut) && iomin > iomin_threshold)) continue;
+
+            // 同一目标在两个分块里都被切断：拼成完整的框
+            if (k.cut && cand.cut) {
+                k.det.box |= cand.det.box;
+                k.det.confidence = std::max(k.det.confidence, cand.det.confidence);
+            }
+            merged = true;
+            break;
+        }
+        if (!merged) {
+            kept.push_back(cand);
+        }
+    }
+
+    std::vector<Detection> objects;
+    objects.reserve(kept.size());
+    for (auto &k : kept) objects.push_back(k.det);
+    return objects;
+}
+
+TileScheduler::TileScheduler(const std::vector<cv::Rect> &tiles, int idle_limit, int probe_interval)
+    : tiles_(tiles), idle_runs_(tiles.size(), 0), idle_limit_(std::max(1, idle_limit)),
+      probe_interval_(std::max(1, probe_interval)) {}
+
+std::vector<cv::Rect> TileScheduler::select(int frame_index) const {
+    std::vector<cv::Rect> selected;
+    for (size_t i = 0; i < tiles_.size(); i++) {
+        // 空闲分块错开探测，避免所有空闲块挤在同一帧
+        if (idle_runs_[i] < idle_limit_ || (frame_index + (int)i) % probe_interval_ == 0) {
+            selected.push_back(tiles_[i]);
+        }
+    }
+    return selected;
+}
+
+void TileScheduler::update(const std::vector<cv::Rect> &inferred, const std::vector<Detection> &detections) {
+    for (size_t i = 0; i < tiles_.size(); i++) {
+        bool active = false;
+        for (const auto &det : detections) {
+            cv::Point center(det.box.x + det.box.width / 2, det.box.y + det.box.height / 2);
+            if (tiles_[i].contains(center)) {
+                active = true;
+                break;
+            }
+        }
+        if (active) {
+            idle_runs_[i] = 0;
+        } else if (std::find(inferred.begin(), inferred.end(), tiles_[i]) != inferred.end()) {
+            idle_runs_[i]++;
+        }
+    }
+}
+
+int TileScheduler::idleCount() const {
+    int count = 0;
+    for (int runs : idle_runs_) {
+        if (runs >= idle_limit_) count++;
+    }
+    return count;
+}
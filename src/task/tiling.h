@@ -0,0 +1,49 @@
+// 分块推理：把大分辨率画面（或推理区域）切成相互重叠的小块分别推理，再合并各块的检测结果
+
+#ifndef RK3588_DEMO_TILING_H
+#define RK3588_DEMO_TILING_H
+
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "types/yolo_datatype.h"
+
+// 一个分块的推理结果，检测框为整帧坐标
+struct TileResult {
+    cv::Rect region;
+    std::vector<Detection> detections;
+};
+
+// 把 area 切成 cols x rows 个大小相同、相邻块重叠 overlap（占块宽/高的比例）的分块
+std::vector<cv::Rect> planTiles(const cv::Rect &area, int cols, int rows, float overlap);
+
+// 合并各分块的检测结果。area 为所有分块覆盖的区域，分块边缘在 area 内部的是“切边”：
+// 贴着切边的框可能只是目标的一部分，与其他分块的框按“交集/较小框面积”判断是否为同一目标，
+// 两边都被切断时取并集，否则保留未被切断的完整框
+std::vector<Detection> mergeTileDetections(const std::vector<TileResult> &tiles, const cv::Rect &area,
+                                           float iou_threshold = 0.5f, float iomin_threshold = 0.6f);
+
+// 自适应跳过：连续 idle_limit 次推理都没有目标的分块进入空闲状态，之后每 probe_interval 帧才推理一次；
+// 任何检测框中心落入空闲分块都会立即唤醒它
+class TileScheduler {
+public:
+    TileScheduler() = default;
+    TileScheduler(const std::vector<cv::Rect> &tiles, int idle_limit = 5, int probe_interval = 10);
+
+    // 本帧需要推理的分块
+    std::vector<cv::Rect> select(int frame_index) const;
+    // 用本帧合并后的检测结果更新各分块的活跃状态
+    void update(const std::vector<cv::Rect> &inferred, const std::vector<Detection> &detections);
+
+    const std::vector<cv::Rect> &tiles() const { return tiles_; }
+    int idleCount() const;
+
+private:
+    std::vector<cv::Rect> tiles_;
+    std::vector<int> idle_runs_;  // 每个分块连续无目标的推理次数
+    int idle_limit_ = 5;
+    int probe_interval_ = 10;
+};
+
+#endif // RK3588_DEMO_TILING_H
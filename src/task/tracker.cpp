@@ -0,0 +1,252 @@
+#include "tracker.h"
+
+#include <algorithm>
+#include <cmath>
+
+// 预先分配的容量，稳态下关联和输出都不再分配内存
+static const size_t kMaxTracks = 256;
+static const size_t kMaxCandidates = 4096;
+
+// 噪声按框高归一化（参照 ByteTrack 在 25fps 下的取值，换算到秒）
+static const float kFrameRate = 25.0f;
+static const float kPosStd = 1.0f / 20;   // 每帧位置噪声 / 观测噪声
+static const float kVelStd = 1.0f / 160;  // 每帧速度噪声
+
+static float iou(const cv::Rect2f &a, const cv::Rect2f &b) {
+    float inter = (a & b).area();
+    float uni = a.area() + b.area() - inter;
+    return uni > 0 ? inter / uni : 0.f;
+}
+
+MultiObjectTracker::MultiObjectTracker() {
+    tracks_.reserve(kMaxTracks);
+    candidates_.reserve(kMaxCandidates);
+    track_matched_.reserve(kMaxTracks);
+    unmatched_.reserve(kMaxTracks);
+}
+
+void MultiObjectTracker::configure(const Params &params) {
+    params_ = params;
+    params_.min_interval = std::max(1, params_.min_interval);
+    params_.max_interval = std::max(params_.min_interval, params_.max_interval);
+    enabled_ = true;
+    reset();
+}
+
+void MultiObjectTracker::reset() {
+    tracks_.clear();
+    unmatched_.clear();
+    interval_ = params_.min_interval;
+    frames_since_infer_ = 0;
+    has_state_ = false;
+}
+
+int MultiObjectTracker::activeTracks() const {
+    int n = 0;
+    for (const auto &track : tracks_) {
+        if (track.lost == 0) n++;
+    }
+    return n;
+}
+
+cv::Rect2f MultiObjectTracker::trackBox(const Track &track) const {
+    float w = std::max(1.f, track.axis[2].p);
+    float h = std::max(1.f, track.axis[3].p);
+    return cv::Rect2f(track.axis[0].p - w / 2, track.axis[1].p - h / 2, w, h);
+}
+
+void MultiObjectTracker::initTrack(Track &track, const Detection &det) {
+    const float h = (float)std::max(1, det.box.height);
+    const float z[4] = {det.box.x + det.box.width / 2.f, det.box.y + det.box.height / 2.f,
+                        (float)det.box.width, (float)det.box.height};
+    const float pos_std = 2 * kPosStd * h;
+    const float vel_std = 10 * kVelStd * h * kFrameRate;
+    for (int i = 0; i < 4; i++) {
+        Axis &a = track.axis[i];
+        a.p = z[i];
+        a.v = 0;
+        a.p00 = pos_std * pos_std;
+        a.p01 = 0;
+        a.p11 = vel_std * vel_std;
+    }
+    track.id = next_id_++;
+    track.hits = 1;
+    track.lost = 0;
+    track.det = det;
+}
+
+void MultiObjectTracker::correct(Track &track, const Detection &det) {
+    const float h = std::max(1.f, track.axis[3].p);
+    const float r = (kPosStd * h) * (kPosStd * h);
+    const float z[4] = {det.box.x + det.box.width / 2.f, det.box.y + det.box.height / 2.f,
+                        (float)det.box.width, (float)det.box.height};
+    for (int i = 0; i < 4; i++) {
+        Axis &a = track.axis[i];
+        const float s = a.p00 + r;
+        const float k0 = a.p00 / s;
+        const float k1 = a.p01 / s;
+        const float y = z[i] - a.p;
+        a.p += k0 * y;
+        a.v += k1 * y;
+        const float p00 = a.p00, p01 = a.p01;
+        a.p00 = (1 - k0) * p00;
+        a.p01 = (1 - k0) * p01;
+        a.p11 -= k1 * p01;
+    }
+    track.hits++;
+    track.lost = 0;
+    track.det = det;
+}
+
+void MultiObjectTracker::advanceTo(std::chrono::steady_clock::time_point now) {
+    if (!has_state_) {
+        state_time_ = now;
+        has_state_ = true;
+        return;
+    }
+    float dt = std::chrono::duration<float>(now - state_time_).count();
+    state_time_ = now;
+    dt = std::min(std::max(dt, 0.f), 2.f);
+    if (dt <= 0) return;
+
+    const float frames = dt * kFrameRate;
+    for (auto &track : tracks_) {
+        const float h = std::max(1.f, track.axis[3].p);
+        const float qp = (kPosStd * h) * (kPosStd * h) * frames;
+        const float qv = (kVelStd * h * kFrameRate) * (kVelStd * h * kFrameRate) * frames;
+        for (int i = 0; i < 4; i++) {
+            Axis &a = track.axis[i];
+            a.p += a.v * dt;
+            a.p00 += dt * (2 * a.p01 + dt * a.p11) + qp;
+            a.p01 += dt * a.p11;
+            a.p11 += qv;
+        }
+        // 宽高不能外推成负数
+        track.axis[2].p = std::max(1.f, track.axis[2].p);
+        track.axis[3].p = std::max(1.f, track.axis[3].p);
+    }
+}
+
+int MultiObjectTracker::associate(bool high_round, float &iou_sum) {
+    const std::vector<Detection> &dets = *dets_;
+    candidates_.clear();
+    for (size_t d = 0; d < dets.size(); d++) {
+        if (det_match_[d] >= 0 || (dets[d].confidence >= params_.high_score) != high_round) continue;
+        const cv::Rect2f box(dets[d].box);
+        for (size_t t = 0; t < tracks_.size() && candidates_.size() < kMaxCandidates; t++) {
+            // 第二轮（低置信度检测）只延续最近一次推理还在的轨迹
+            if (track_matched_[t] || (!high_round && tracks_[t].lost > 0)) continue;
+            if (tracks_[t].det.class_id != dets[d].class_id) continue;
+            float v = iou(trackBox(tracks_[t]), box);
+            if (v >= params_.match_iou) {
+                candidates_.push_back({v, (int)t, (int)d});
+            }
+        }
+    }
+    std::sort(candidates_.begin(), candidates_.end(),
+              [](const Candidate &a, const Candidate &b) { return a.iou > b.iou; });
+
+    int matched = 0;
+    for (const auto &c : candidates_) {
+        if (track_matched_[c.track] || det_match_[c.det] >= 0) continue;
+        track_matched_[c.track] = 1;
+        det_match_[c.det] = c.track;
+        iou_sum += c.iou;
+        matched++;
+    }
+    return matched;
+}
+
+void MultiObjectTracker::update(std::vector<Detection> &detections, std::chrono::steady_clock::time_point now) {
+    advanceTo(now);
+    last_infer_ = now;
+    frames_since_infer_ = 0;
+
+    dets_ = &detections;
+    det_match_.assign(detections.size(), -1);
+    track_matched_.assign(tracks_.size(), 0);
+
+    float iou_sum = 0;
+    int matched = associate(true, iou_sum);
+    matched += associate(false, iou_sum);
+
+    for (size_t d = 0; d < detections.size(); d++) {
+        if (det_match_[d] >= 0) {
+            correct(tracks_[det_match_[d]], detections[d]);
+        }
+    }
+
+    // 未关联的轨迹：丢失计数加一，超过上限删除
+    for (size_t t = 0; t < tracks_.size(); t++) {
+        if (!track_matched_[t]) {
+            tracks_[t].lost++;
+        }
+    }
+    for (size_t t = 0; t < tracks_.size();) {
+        if (tracks_[t].lost > params_.max_lost) {
+            tracks_[t] = tracks_.back();
+            tracks_.pop_back();
+        } else {
+            t++;
+        }
+    }
+
+    // 未关联的高置信度检测新建轨迹，其余（低置信度或轨迹已满）不跟踪，但仍计入本帧结果
+    int born = 0;
+    unmatched_.clear();
+    for (size_t d = 0; d < detections.size(); d++) {
+        if (det_match_[d] >= 0) continue;
+        if (detections[d].confidence >= params_.high_score && tracks_.size() < kMaxTracks) {
+            tracks_.emplace_back();
+            initTrack(tracks_.back(), detections[d]);
+            born++;
+        } else {
+            unmatched_.push_back(detections[d]);
+            unmatched_.back().track_id = -1;
+        }
+    }
+    dets_ = nullptr;
+
+    // 自适应间隔：预测准确且目标集合没变化时逐帧加大，否则减半
+    int unmatched = (int)track_matched_.size() - matched;
+    bool stable = born == 0 && unmatched == 0 && (matched == 0 || iou_sum / matched >= params_.stable_iou);
+    if (stable) {
+        interval_ = std::min(params_.max_interval, interval_ + 1);
+    } else {
+        interval_ = std::max(params_.min_interval, interval_ / 2);
+    }
+
+    emit(detections);
+}
+
+bool MultiObjectTracker::shouldInfer(std::chrono::steady_clock::time_point now) const {
+    if (!enabled_ || !has_state_) return true;
+    if (frames_since_infer_ + 1 >= interval_) return true;
+    if (std::chrono::duration<double>(now - last_infer_).count() >= params_.max_gap_seconds) return true;
+    for (const auto &track : tracks_) {
+        if (track.lost > 0) continue;
+        const float h = std::max(1.f, track.axis[3].p);
+        const float limit = params_.max_uncertainty * h;
+        if (track.axis[0].p00 > limit * limit || track.axis[1].p00 > limit * limit) return true;
+    }
+    return false;
+}
+
+void MultiObjectTracker::predict(std::chrono::steady_clock::time_point now, std::vector<Detection> &out) {
+    advanceTo(now);
+    frames_since_infer_++;
+    emit(out);
+}
+
+void MultiObjectTracker::emit(std::vector<Detection> &out) const {
+    out.clear();
+    for (const auto &track : tracks_) {
+        if (track.lost > 0) continue;
+        cv::Rect2f box = trackBox(track);
+        out.push_back(track.det);
+        Detection &det = out.back();
+        det.box = cv::Rect(cvRound(box.x), cvRound(box.y), cvRound(box.width), cvRound(box.height));
+        det.track_id = track.id;
+    }
+    out.insert(out.end(), unmatched_.begin(), unmatched_.end());
+}
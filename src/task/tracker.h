@@ -0,0 +1,93 @@
+// 多目标跟踪（SORT/ByteTrack 思路）：卡尔曼预测框 + IoU 关联，推理只在每 N 帧或超过时间预算时运行，
+// 中间的帧由轨迹外推补齐；推理间隔按跟踪的稳定程度自适应调整
+
+#ifndef RK3588_DEMO_TRACKER_H
+#define RK3588_DEMO_TRACKER_H
+
+#include <chrono>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "types/yolo_datatype.h"
+
+class MultiObjectTracker {
+public:
+    struct Params {
+        float high_score = 0.4f;        // 第一轮关联和新建轨迹的置信度阈值，低于它的检测只用于延续已有轨迹
+        float match_iou = 0.3f;         // 预测框与检测框 IoU 低于该值不关联
+        int max_lost = 2;               // 连续多少次推理未关联到检测后删除轨迹
+        int min_interval = 1;           // 推理间隔（帧）的范围
+        int max_interval = 5;
+        double max_gap_seconds = 1.0;   // 两次推理之间的最长时间
+        float stable_iou = 0.7f;        // 平均关联 IoU 达到该值且没有新增/丢失目标时加大推理间隔
+        float max_uncertainty = 0.25f;  // 预测位置标准差超过框高的该比例时立即推理
+    };
+
+    MultiObjectTracker();
+
+    void configure(const Params &params);
+    bool enabled() const { return enabled_; }
+    void reset();
+
+    // 本帧是否需要推理：到达推理间隔、超过时间预算或轨迹预测不可靠
+    bool shouldInfer(std::chrono::steady_clock::time_point now) const;
+
+    // 推理结果与轨迹关联；detections 被改写为本次关联上（含新建）的轨迹框（带 track_id），
+    // 加上没有关联也没有新建轨迹的检测（track_id 为 -1），推理帧的人数与检测结果一致
+    void update(std::vector<Detection> &detections, std::chrono::steady_clock::time_point now);
+
+    // 不推理的帧：把轨迹外推到 now，结果写入 out；没有轨迹的检测保持上次推理的位置
+    void predict(std::chrono::steady_clock::time_point now, std::vector<Detection> &out);
+
+    int interval() const { return interval_; }
+    int activeTracks() const;
+
+private:
+    // 每个坐标（cx、cy、w、h）独立的匀速模型卡尔曼滤波：状态 [位置, 速度]，协方差对称只存三项。
+    // 过程噪声和观测噪声都是对角的，与 8 维联合滤波等价
+    struct Axis {
+        float p, v;
+        float p00, p01, p11;
+    };
+
+    struct Track {
+        int id;
+        Axis axis[4];
+        int hits;
+        int lost;  // 连续未关联的推理次数，0 表示最近一次推理关联上
+        Detection det;
+    };
+
+    struct Candidate {
+        float iou;
+        int track;
+        int det;
+    };
+
+    void advanceTo(std::chrono::steady_clock::time_point now);
+    cv::Rect2f trackBox(const Track &track) const;
+    void initTrack(Track &track, const Detection &det);
+    void correct(Track &track, const Detection &det);
+    // 贪心关联：按 IoU 从大到小依次配对，返回配对数并累加 IoU
+    int associate(bool high_round, float &iou_sum);
+    void emit(std::vector<Detection> &out) const;
+
+    bool enabled_ = false;
+    Params params_;
+    std::vector<Track> tracks_;
+    std::vector<Candidate> candidates_;
+    std::vector<int> det_match_;    // 检测对应的轨迹下标，-1 为未关联
+    std::vector<char> track_matched_;
+    std::vector<Detection> unmatched_;  // 最近一次推理中没有轨迹的检测，到下次推理前原样输出
+    const std::vector<Detection> *dets_ = nullptr;
+    int next_id_ = 1;
+
+    int interval_ = 1;
+    int frames_since_infer_ = 0;
+    bool has_state_ = false;
+    std::chrono::steady_clock::time_point state_time_;
+    std::chrono::steady_clock::time_point last_infer_;
+};
+
+#endif // RK3588_DEMO_TRACKER_H
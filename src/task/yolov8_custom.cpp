@@ -11,6 +11,8 @@ Yolov8Custom::Yolov8Custom() {
     input_tensor_.data = nullptr;
     want_float_ = false;
     ready_ = false;
+    process_type_ = "auto";
+    pack_param_ = nn_tensor_pack_default_param();
 }
 
 Yolov8Custom::~Yolov8Custom() {
@@ -44,12 +46,18 @@ nn_error_e Yolov8Custom::LoadModel(const char *model_path) {
         return NN_RKNN_INPUT_ATTR_ERROR;
     }
 
-    nn_tensor_attr_to_cvimg_input_data(input_shapes[0], input_tensor_);
+    nn_tensor_pack_prepare(input_shapes[0], pack_param_, input_tensor_, pack_plan_);
     input_tensor_.data = malloc(input_tensor_.attr.size);
     if (!input_tensor_.data) {
         NN_LOG_ERROR("Failed to allocate input tensor memory");
         return NN_RKNN_INPUT_SET_FAIL;
     }
+    model_size_ = cv::Size(pack_plan_.width, pack_plan_.height);
+    if (nn_tensor_pack_needed(pack_plan_)) {
+        staging_.create(model_size_, CV_8UC3);
+    } else {
+        staging_ = cv::Mat(model_size_, CV_8UC3, input_tensor_.data);
+    }
 
     auto output_shapes = engine_->GetOutputShapes();
     if (output_shapes.size() != 6) {
@@ -90,23 +98,45 @@ nn_error_e Yolov8Custom::LoadModel(const char *model_path) {
     return NN_SUCCESS;
 }
 
-nn_error_e Yolov8Custom::Preprocess(const cv::Mat &img, const std::string process_type, cv::Mat &image_letterbox) {
+void Yolov8Custom::SetPreprocessType(const std::string &process_type) {
+    process_type_ = process_type;
+    preprocess_ = nullptr;
+}
+
+void Yolov8Custom::SetInputPack(const tensor_pack_param_s &pack_param) {
+    pack_param_ = pack_param;
+}
+
+nn_error_e Yolov8Custom::WarmUpPreprocess(int width, int height) {
     if (!ready_) return NN_RKNN_MODEL_NOT_LOAD;
 
-    float wh_ratio = (float)input_tensor_.attr.dims[2] / (float)input_tensor_.attr.dims[1];
+    preprocess_size_ = cv::Size(width, height);
+    letterbox_ = get_letterbox_geometry(preprocess_size_, model_size_);
+    preprocess_ = PreprocessRegistry::Instance().Select(preprocess_size_, model_size_, process_type_);
+    return NN_SUCCESS;
+}
+
+nn_error_e Yolov8Custom::Preprocess(const cv::Mat &img) {
+    if (!ready_) return NN_RKNN_MODEL_NOT_LOAD;
 
-    if (process_type == "opencv") {
-        letterbox_info_ = letterbox(img, image_letterbox, wh_ratio);
-        cvimg2tensor(image_letterbox, input_tensor_.attr.dims[2], input_tensor_.attr.dims[1], input_tensor_);
-    } 
-    else if (process_type == "rga") {
-        letterbox_info_ = letterbox_rga(img, image_letterbox, wh_ratio);
-        cvimg2tensor_rga(image_letterbox, input_tensor_.attr.dims[2], input_tensor_.attr.dims[1], input_tensor_);
+    // 分辨率变化时重新选择（几何信息和后端都按分辨率缓存）
+    if (!preprocess_ || preprocess_size_ != img.size()) {
+        WarmUpPreprocess(img.cols, img.rows);
     }
-    else {
-        return NN_RKNN_INPUT_ATTR_ERROR;
+
+    auto ret = preprocess_->Run(img, *letterbox_, staging_);
+    if (ret != NN_SUCCESS) {
+        // 后端按尺寸分组选定，组内个别尺寸可能不被支持（如 RGA 的对齐要求），此时改用参考实现
+        auto fallback = PreprocessRegistry::Instance().Get("opencv");
+        if (!fallback || fallback == preprocess_) return ret;
+        NN_LOG_WARNING("preprocess %dx%d: %s failed, using %s", img.cols, img.rows, preprocess_->Name(), fallback->Name());
+        preprocess_ = fallback;
+        ret = preprocess_->Run(img, *letterbox_, staging_);
+        if (ret != NN_SUCCESS) return ret;
     }
 
+    // 按模型原生布局/类型打包（NN_PACK_RUNTIME 时预处理已直接写入输入张量）
+    nn_tensor_pack(staging_, pack_plan_, input_tensor_);
     return NN_SUCCESS;
 }
 
@@ -118,7 +148,7 @@ nn_error_e Yolov8Custom::Inference() {
     return engine_->Run(inputs, output_tensors_, want_float_);
 }
 
-nn_error_e Yolov8Custom::Postprocess(const cv::Mat &img, std::vector<Detection> &objects) {
+nn_error_e Yolov8Custom::Postprocess(std::vector<Detection> &objects) {
     if (!ready_) return NN_RKNN_MODEL_NOT_LOAD;
 
     std::lock_guard<std::mutex> lock(model_mutex_);
@@ -134,8 +164,9 @@ nn_error_e Yolov8Custom::Postprocess(const cv::Mat &img, std::vector<Detection>
         yolo::GetConvDetectionResultInt8((int8_t **)output_data, out_zps_, out_scales_, DetectiontRects);
     }
 
-    int img_width = img.cols;
-    int img_height = img.rows;
+    // 检测框是相对模型输入的归一化坐标
+    float model_width = model_size_.width;
+    float model_height = model_size_.height;
     objects.clear();
 
     for (size_t i = 0; i < DetectiontRects.size(); i += 6) {
@@ -145,17 +176,9 @@ nn_error_e Yolov8Custom::Postprocess(const cv::Mat &img, std::vector<Detection>
         float conf = DetectiontRects[i + 1];
         if (conf < 0.25f) continue;
 
-        int xmin = static_cast<int>(DetectiontRects[i + 2] * img_width + 0.5f);
-        int ymin = static_cast<int>(DetectiontRects[i + 3] * img_height + 0.5f);
-        int xmax = static_cast<int>(DetectiontRects[i + 4] * img_width + 0.5f);
-        int ymax = static_cast<int>(DetectiontRects[i + 5] * img_height + 0.5f);
-
-        xmin = std::max(0, std::min(xmin, img_width - 1));
-        ymin = std::max(0, std::min(ymin, img_height - 1));
-        xmax = std::max(0, std::min(xmax, img_width - 1));
-        ymax = std::max(0, std::min(ymax, img_height - 1));
-
-        if (xmax <= xmin || ymax <= ymin) continue;
+        cv::Rect box = LetterboxDecode(DetectiontRects[i + 2] * model_width, DetectiontRects[i + 3] * model_height,
+                                       DetectiontRects[i + 4] * model_width, DetectiontRects[i + 5] * model_height);
+        if (box.width <= 0 || box.height <= 0) continue;
 
 
         Detection result;
@@ -164,7 +187,7 @@ nn_error_e Yolov8Custom::Postprocess(const cv::Mat &img, std::vector<Detection>
         result.color = cv::Scalar(0, 255, 0);
         result.className = classId < g_classes.size() ? g_classes[classId] : "unknown";
 
-        result.box = cv::Rect(xmin, ymin, xmax - xmin, ymax - ymin);
+        result.box = box;
 
         objects.push_back(result);
     }
@@ -172,29 +195,19 @@ nn_error_e Yolov8Custom::Postprocess(const cv::Mat &img, std::vector<Detection>
     return NN_SUCCESS;
 }
 
-void Yolov8Custom::LetterboxDecode(std::vector<Detection> &objects, bool hor, int pad) {
-    for (auto &obj : objects) {
-        if (hor) {
-            obj.box.x -= pad;
-        } else {
-            obj.box.y -= pad;
-        }
-    }
+// 模型输入坐标 -> 原图坐标，与预处理使用同一份缓存的几何信息
+cv::Rect Yolov8Custom::LetterboxDecode(float xmin, float ymin, float xmax, float ymax) const {
+    return letterbox_->Decode(xmin, ymin, xmax, ymax);
 }
 
 nn_error_e Yolov8Custom::Run(const cv::Mat &img, std::vector<Detection> &objects) {
     if (!ready_) return NN_RKNN_MODEL_NOT_LOAD;
 
-    cv::Mat image_letterbox;
-    auto ret = Preprocess(img, "opencv", image_letterbox);
+    auto ret = Preprocess(img);
     if (ret != NN_SUCCESS) return ret;
 
     ret = Inference();
     if (ret != NN_SUCCESS) return ret;
 
-    ret = Postprocess(image_letterbox, objects);
-    if (ret != NN_SUCCESS) return ret;
-
-    LetterboxDecode(objects, letterbox_info_.hor, letterbox_info_.pad);
-    return NN_SUCCESS;
+    return Postprocess(objects);
 }
\ No newline at end of file
@@ -7,6 +7,8 @@
 #include <mutex>
 #include <opencv2/opencv.hpp>
 #include "process/preprocess.h"
+#include "process/preprocess_backend.h"
+#include "process/tensor_pack.h"
 #include "types/yolo_datatype.h"
 
 class Yolov8Custom {
@@ -20,15 +22,28 @@ public:
 
     nn_error_e LoadModel(const char *model_path);
     nn_error_e Run(const cv::Mat &img, std::vector<Detection> &objects);
+    // Ԥˣopencv/simd/rga autoֱʻ׼ԺԶѡ
+    void SetPreprocessType(const std::string &process_type);
+    // ʽ LoadModel ֮ǰ
+    void SetInputPack(const tensor_pack_param_s &pack_param);
+    // ʱͷֱԤѡԤˣ֡׼
+    nn_error_e WarmUpPreprocess(int width, int height);
 
 private:
-    nn_error_e Preprocess(const cv::Mat &img, const std::string process_type, cv::Mat &image_letterbox);
+    nn_error_e Preprocess(const cv::Mat &img);
     nn_error_e Inference();
-    nn_error_e Postprocess(const cv::Mat &img, std::vector<Detection> &objects);
-    void LetterboxDecode(std::vector<Detection> &objects, bool hor, int pad);
+    nn_error_e Postprocess(std::vector<Detection> &objects);
+    cv::Rect LetterboxDecode(float xmin, float ymin, float xmax, float ymax) const;
 
     bool ready_;
-    LetterBoxInfo letterbox_info_;
+    std::shared_ptr<const LetterBoxGeometry> letterbox_;
+    std::string process_type_;
+    std::shared_ptr<PreprocessBackend> preprocess_;
+    cv::Size preprocess_size_;
+    cv::Size model_size_;
+    tensor_pack_param_s pack_param_;
+    tensor_pack_plan_s pack_plan_;
+    cv::Mat staging_;  // ԤRGB HWCҪʱֱָڴ
     tensor_data_s input_tensor_;
     std::vector<tensor_data_s> output_tensors_;
     bool want_float_;
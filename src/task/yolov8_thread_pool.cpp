@@ -19,17 +19,20 @@ Yolov8ThreadPool::~Yolov8ThreadPool()
     }
 }
 
-// 初始化：加载模型，创建线程，参数：模型路径，线程数量
-nn_error_e Yolov8ThreadPool::setUp(const std::string &model_path, int num_threads) 
+// 初始化：加载模型，创建线程，参数：模型路径，线程数量，预处理后端，输入张量打包方式
+nn_error_e Yolov8ThreadPool::setUp(const std::string &model_path, int num_threads, const std::string &preprocess_type,
+                                   const tensor_pack_param_s &pack_param)
 {
     // 遍历线程数量，创建模型实例，放入vector
     // 这些线程加载的模型是同一个
     for (size_t i = 0; i < num_threads; ++i)
     {
         std::shared_ptr<Yolov8Custom> Yolov8 = std::make_shared<Yolov8Custom>();
+        Yolov8->SetInputPack(pack_param);
         if (Yolov8->LoadModel(model_path.c_str()) != NN_SUCCESS) {
             return NN_LOAD_MODEL_FAIL;
         }
+        Yolov8->SetPreprocessType(preprocess_type);
         Yolov8_instances.push_back(Yolov8);
     }
     
@@ -42,12 +45,26 @@ nn_error_e Yolov8ThreadPool::setUp(const std::string &model_path, int num_thread
     return NN_SUCCESS;
 }
 
+// 预先选择预处理后端，同一分辨率只会测试一次，其余实例直接取固定的结果
+nn_error_e Yolov8ThreadPool::warmUp(int width, int height)
+{
+    for (auto &instance : Yolov8_instances)
+    {
+        auto ret = instance->WarmUpPreprocess(width, height);
+        if (ret != NN_SUCCESS)
+        {
+            return ret;
+        }
+    }
+    return NN_SUCCESS;
+}
+
 // 线程函数。参数：线程id
 void Yolov8ThreadPool::worker(int id)
 {
     while (!stop)
     {
-        std::pair<int, cv::Mat> task;
+        InferTask task;
         std::shared_ptr<Yolov8Custom> instance = Yolov8_instances[id]; // 获取模型实例
         {
             // 获取任务
@@ -63,28 +80,61 @@ void Yolov8ThreadPool::worker(int id)
             task = tasks.front();
             tasks.pop();
         }
-        // 运行模型
+        // 运行模型，只裁剪推理区域，检测框再平移回整帧坐标
         std::vector<Detection> detections;
-        instance->Run(task.second, detections);
-        processed_frames++;  // 处理完成后增加计数
+        cv::Rect region = task.region & cv::Rect(0, 0, task.img.cols, task.img.rows);
+        if (region.area() > 0 && region.size() != task.img.size())
+        {
+            instance->Run(task.img(region), detections);
+            for (auto &det : detections)
+            {
+                det.box += region.tl();
+            }
+        }
+        else
+        {
+            instance->Run(task.img, detections);
+        }
 
         {
             // 保存结果
             std::lock_guard<std::mutex> lock(mtx2);
-            results.insert({task.first, detections});
-            DrawDetections(task.second, detections);
-            img_results.insert({task.first, task.second});
+            auto pending = pending_frames.find(task.id);
+            if (pending != pending_frames.end())
+            {
+                // 分块任务：等该帧所有分块完成后再合并
+                pending->second.tiles.push_back({region, detections});
+                if (--pending->second.remaining > 0)
+                {
+                    continue;
+                }
+                detections = mergeTileDetections(pending->second.tiles, pending->second.area);
+                pending_frames.erase(pending);
+            }
+            results.insert({task.id, detections});
+            if (draw_detections)
+            {
+                DrawDetections(task.img, detections);
+            }
+            img_results.insert({task.id, task.img});
         }
+        processed_frames++;  // 处理完成后增加计数
     }
 }
 
+int Yolov8ThreadPool::pendingTasks()
+{
+    std::lock_guard<std::mutex> lock(mtx1);
+    return (int)tasks.size();
+}
+
 // allTasksDone实现
 bool Yolov8ThreadPool::allTasksDone() const {
     return submitted_frames == processed_frames;
 }
 
-// 提交任务，参数：图片，id（帧号）
-nn_error_e Yolov8ThreadPool::submitTask(const cv::Mat &img, int id)
+// 提交任务，参数：图片，id（帧号），推理区域
+nn_error_e Yolov8ThreadPool::submitTask(const cv::Mat &img, int id, const cv::Rect &region)
 {
     submitted_frames++;
     // 如果任务队列中的任务数量大于10，等待，避免内存占用过多
@@ -97,12 +147,46 @@ nn_error_e Yolov8ThreadPool::submitTask(const cv::Mat &img, int id)
     {
         // 保存任务
         std::lock_guard<std::mutex> lock(mtx1);
-        tasks.push({id, img});
+        tasks.push({id, img, region});
     }
     cv_task.notify_one();
     return NN_SUCCESS;
 }
 
+// 提交分块任务，参数：图片，id（帧号），分块，分块覆盖的区域
+nn_error_e Yolov8ThreadPool::submitTiledTask(const cv::Mat &img, int id, const std::vector<cv::Rect> &tiles, const cv::Rect &area)
+{
+    submitted_frames++;
+    // 所有分块都被跳过：直接给出空结果
+    if (tiles.empty())
+    {
+        std::lock_guard<std::mutex> lock(mtx2);
+        results.insert({id, std::vector<Detection>()});
+        img_results.insert({id, img});
+        processed_frames++;
+        return NN_SUCCESS;
+    }
+
+    while (tasks.size() > 10)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mtx2);
+        pending_frames[id] = {(int)tiles.size(), area, {}};
+    }
+    {
+        std::lock_guard<std::mutex> lock(mtx1);
+        for (const auto &tile : tiles)
+        {
+            tasks.push({id, img, tile});
+        }
+    }
+    cv_task.notify_all();
+    return NN_SUCCESS;
+}
+
 // 获取结果，参数：检测框，id（帧号）
 nn_error_e Yolov8ThreadPool::getTargetResult(std::vector<Detection> &objects, int id)
 {
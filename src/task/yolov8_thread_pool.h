@@ -2,6 +2,7 @@
 #define RK3588_DEMO_Yolov8_THREAD_POOL_H
 
 #include "yolov8_custom.h"
+#include "tiling.h"
 #include <iostream>
 #include <vector>
 #include <queue>
@@ -52,13 +53,27 @@ public:
     }
 };
 
+// 推理任务：region 为整帧中参与推理的区域，为空时使用整帧
+struct InferTask {
+    int id;
+    cv::Mat img;
+    cv::Rect region;
+};
+
 class Yolov8ThreadPool
 {
 private:
-    std::queue<std::pair<int, cv::Mat>> tasks;
+    std::queue<InferTask> tasks;
     std::vector<std::shared_ptr<Yolov8Custom>> Yolov8_instances;
     std::map<int, std::vector<Detection>> results;
     std::map<int, cv::Mat> img_results;
+    // 分块推理中的帧：所有分块完成后合并结果
+    struct PendingFrame {
+        int remaining;
+        cv::Rect area;
+        std::vector<TileResult> tiles;
+    };
+    std::map<int, PendingFrame> pending_frames;
     std::vector<std::thread> threads;
     std::mutex mtx1;
     std::mutex mtx2;
@@ -68,6 +83,7 @@ private:
     std::atomic<bool> processing_complete{false}; // 新增标志位
     std::atomic<int> submitted_frames{0};
     std::atomic<int> processed_frames{0};
+    std::atomic<bool> draw_detections{true};
 
     bool stop;
 
@@ -77,8 +93,14 @@ public:
     Yolov8ThreadPool();
     ~Yolov8ThreadPool();
 
-    nn_error_e setUp(const std::string &model_path, int num_threads = 12);
-    nn_error_e submitTask(const cv::Mat &img, int id);
+    nn_error_e setUp(const std::string &model_path, int num_threads = 12, const std::string &preprocess_type = "auto",
+                     const tensor_pack_param_s &pack_param = nn_tensor_pack_default_param());
+    // 按输入分辨率预先选择预处理后端（auto 时会做一次基准测试）
+    nn_error_e warmUp(int width, int height);
+    // region 非空时只对该区域推理，检测框仍为整帧坐标
+    nn_error_e submitTask(const cv::Mat &img, int id, const cv::Rect &region = cv::Rect());
+    // 分块推理：每个分块作为独立任务分给各线程，全部完成后合并为该帧的结果；area 为分块覆盖的区域
+    nn_error_e submitTiledTask(const cv::Mat &img, int id, const std::vector<cv::Rect> &tiles, const cv::Rect &area);
     nn_error_e getTargetResult(std::vector<Detection> &objects, int id);
     nn_error_e getTargetImgResult(cv::Mat &img, int id);
     nn_error_e getTargetImgResultWithCount(cv::Mat &img, int id, int& box_count);
@@ -88,6 +110,11 @@ public:
     bool allTasksDone() const;
     int getSubmittedCount() const { return submitted_frames; }
     int getProcessedCount() const { return processed_frames; }
+    // 等待推理的任务数（分块推理每块一个任务）
+    int pendingTasks();
+    // 是否在结果图（即提交的图像本身）上画检测框，默认画；关闭后提交的图像不会被修改
+    void setDrawDetections(bool draw) { draw_detections = draw; }
+    bool drawDetections() const { return draw_detections; }
 
     void setProcessingComplete() { processing_complete = true; }
     bool isProcessingComplete() const { return processing_complete; }
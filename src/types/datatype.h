@@ -39,6 +39,7 @@ typedef struct
     tensor_layout_e layout;
     int32_t zp;
     float scale;
+    bool pass_through; // 输入张量已按模型原生布局/类型打包好，runtime 不再做转换
 } tensor_attr_s;
 
 typedef struct
@@ -78,6 +79,7 @@ static void nn_tensor_attr_to_cvimg_input_data(const tensor_attr_s &attr, tensor
     data.attr.index = 0;
     data.attr.type = NN_TENSOR_UINT8;
     data.attr.layout = NN_TENSOR_NHWC;
+    data.attr.pass_through = false;
     if (attr.layout == NN_TENSOR_NCHW)
     {
         data.attr.dims[0] = attr.dims[0];
@@ -18,6 +18,7 @@ typedef enum
     NN_RKNN_MODEL_NOT_LOAD = -10,   // rknn模型未加载
     NN_STOPED = -11,                // 程序已停止
     NN_TIMEOUT = -12,          // 超时
+    NN_PREPROCESS_FAIL = -13,       // 预处理失败
 } nn_error_e;
 
 #endif // RK3588_DEMO_ERROR_H
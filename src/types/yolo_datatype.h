@@ -21,6 +21,7 @@ struct Detection
     float confidence{0.0};
     cv::Scalar color{};
     cv::Rect box{};
+    int track_id{-1};  // 跟踪编号，未跟踪时为 -1
 };
 
 #endif //RK3588_DEMO_NN_DATATYPE_H
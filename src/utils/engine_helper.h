@@ -89,6 +89,8 @@ static rknn_tensor_type rknn_type_convert(tensor_datatype_e type)
     {
     case NN_TENSOR_UINT8:
         return RKNN_TENSOR_UINT8;
+    case NN_TENSOR_INT8:
+        return RKNN_TENSOR_INT8;
     case NN_TENSOR_FLOAT:
         return RKNN_TENSOR_FLOAT32;
     default:
@@ -133,6 +135,7 @@ static tensor_attr_s rknn_tensor_attr_convert(const rknn_tensor_attr &attr)
     shape.type = rknn_type_convert(attr.type);
     shape.zp = attr.zp;
     shape.scale = attr.scale;
+    shape.pass_through = false;
     return shape;
 }
 
@@ -142,8 +145,9 @@ static rknn_input tensor_data_to_rknn_input(const tensor_data_s &data)
 {
     rknn_input input;
     memset(&input, 0, sizeof(input));
-    // set default not passthrough
+    // 默认不 passthrough，由 runtime 做布局转换和归一化/量化
     input.index = data.attr.index;
+    input.pass_through = data.attr.pass_through ? 1 : 0;
     input.type = rknn_type_convert(data.attr.type);
     input.size = data.attr.size;
     input.fmt = rknn_layout_convert(data.attr.layout);
@@ -7,6 +7,10 @@
 
 #include "task/yolov8_thread_pool.h"
 
+#ifdef ENABLE_FFMPEG_DECODE
+#include "decode/sw_decoder.h"
+#endif
+
 static int g_frame_start_id = 0; // 读取视频帧的索引
 static int g_frame_end_id = 0;   // 模型处理完的索引
 
@@ -101,6 +105,41 @@ void read_stream(const char *video_file)
     cap.release();
 }
 
+#ifdef ENABLE_FFMPEG_DECODE
+// 用软件解码后端读取视频文件或 RTSP 流，提交任务
+void read_stream_sw(const char *video_file, int decode_threads)
+{
+    SwDecoder decoder;
+    SwDecoder::Params params;
+    params.threads = decode_threads;
+    // 回调在解码线程中执行，数据只在回调期间有效，转换成 BGR 后提交
+    auto on_frame = [](const SwDecoder::Frame &frame)
+    {
+        cv::Mat yuv(frame.height + frame.height / 2, frame.width, CV_8UC1, (uchar *)frame.data);
+        cv::Mat img;
+        cv::cvtColor(yuv, img, cv::COLOR_YUV2BGR_I420);
+        g_pool->submitTask(img, g_frame_start_id++);
+    };
+    bool opened = decoder.openUrl(video_file, params, on_frame);
+    if (!opened)
+    {
+        NN_LOG_ERROR("Failed to open video file: %s", video_file);
+        end = true;
+        return;
+    }
+
+    while (!decoder.finished())
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+        SwDecoder::Stats stats = decoder.takeStats();
+        NN_LOG_INFO("Decode frames: %d, latency avg: %.1fms, max: %.1fms", stats.frames, stats.avg_decode_ms, stats.max_decode_ms);
+    }
+    NN_LOG_INFO("Video end.");
+    decoder.close();
+    end = true;
+}
+#endif
+
 int main(int argc, char **argv)
 {
     // model file path
@@ -109,6 +148,8 @@ int main(int argc, char **argv)
     const char *video_file = argv[2];
     // 参数：线程池数量
     const int num_threads = (argc > 3) ? atoi(argv[3]) : 12;
+    // 参数：解码方式，opencv（默认）或 ffmpeg，ffmpeg 可带解码线程数，如 ffmpeg:4
+    const std::string decoder = (argc > 4) ? argv[4] : "opencv";
 
     // 线程1：读取视频帧，提交任务
     // 线程池：模型运行
@@ -119,7 +160,18 @@ int main(int argc, char **argv)
     g_pool->setUp(model_file, num_threads);
 
     // 读取视频
-    std::thread read_stream_thread(read_stream, video_file);
+    std::thread read_stream_thread;
+#ifdef ENABLE_FFMPEG_DECODE
+    if (decoder.compare(0, 6, "ffmpeg") == 0)
+    {
+        int decode_threads = decoder.size() > 7 ? atoi(decoder.c_str() + 7) : 2;
+        read_stream_thread = std::thread(read_stream_sw, video_file, decode_threads);
+    }
+    else
+#endif
+    {
+        read_stream_thread = std::thread(read_stream, video_file);
+    }
     // 启动结果线程
     std::thread result_thread(get_results, 1280, 720, 25);
 
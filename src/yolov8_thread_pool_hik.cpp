@@ -10,36 +10,89 @@
 #include <memory>
 #include <mutex>
 #include <atomic>
-#include <sqlite3.h>
+#include <cassert>
 #include <chrono>
 #include <iomanip>
 #include "task/yolov8_thread_pool.h"
 #include "task/mask_utils.h"
 #include "task/comm.h"
+#include "task/motion_gate.h"
+#include "task/stream_activity.h"
+#include "task/decode_policy.h"
+#include "task/tracker.h"
+#include "task/flow_propagator.h"
+#include "task/rate_allocator.h"
+#include "task/overload_controller.h"
+#include "task/model_cascade.h"
+#include "task/count_aggregator.h"
+#include "task/count_smoother.h"
+#include "storage/detection_shards.h"
+#include "storage/detection_log.h"
+#ifdef ENABLE_FFMPEG_DECODE
+#include "decode/sw_decoder.h"
+#endif
 #include <X11/Xlib.h>
 #include <unordered_map>
+#include <deque>
+#include <sys/stat.h>
 
 using namespace cv;
 
 // Global mutex lock
 std::mutex g_gui_mutex;
 std::atomic<bool> g_running{true};
-
-// Database connection pool
-namespace {
-    std::mutex db_pool_mutex;
-    std::map<std::string, sqlite3*> db_pool;
-}
+std::atomic<bool> g_reload_config{false};
 
 // Hikvision SDK mutex lock
 std::mutex g_hik_mutex;
-std::atomic<uint16_t> g_max_box_count(0);
+// Per-camera counts aggregated into windowed snapshots for the serial port and metrics
+CountAggregator g_count_aggregator;
+// Statistic of each camera's sliding window published on the serial port and stored in the database
+// (serial_stat= / db_stat=, re-read on SIGHUP)
+std::atomic<int> g_serial_statistic{CountSmoother::kRaw};
+std::atomic<int> g_db_statistic{CountSmoother::kRaw};
 
 // Signal handler function
 void signal_handler(int signal) {
     g_running = false;
 }
 
+// SIGHUP: re-read runtime-switchable options (decode policy) from the config file
+void reload_handler(int signal) {
+    g_reload_config = true;
+}
+
+// Main stream opened on demand next to the sub-stream used for inference (stream=dual).
+// Shares the camera's login; keeps the last few decoded frames as YV12 so the one matching
+// an inference frame's timestamp can be converted only when it is actually shown or saved.
+void CALLBACK MainDecCBFun(int nPort, char* pBuf, int nSize, FRAME_INFO* pFrameInfo, void* nUser, int nReserved2);
+void CALLBACK MainDataCallBack(LONG lPlayHandle, DWORD dwDataType, BYTE *pBuffer, DWORD dwBufSize, void* pUser);
+
+struct MainStream {
+    static const size_t kRingSize = 5;
+
+    std::string id;
+    LONG userID = -1;
+    int channel = 0;
+    int port = -1;
+    LONG handle = -1;
+
+    std::mutex mutex;
+    std::deque<std::pair<uint32_t, cv::Mat>> frames;  // (nStamp, YV12), oldest first
+    std::chrono::steady_clock::time_point last_demand;
+
+    bool isOpen() const { return handle >= 0; }
+    bool open();
+    void close();
+    // Mark the main stream as needed; opens it if closed
+    void demand();
+    void closeIfUnused(double idle_seconds);
+    // Convert the buffered frame whose timestamp is closest to stamp
+    bool grab(uint32_t stamp, cv::Mat& bgr);
+
+    ~MainStream() { close(); }
+};
+
 // Camera configuration structure
 struct CameraConfig {
     std::string unique_id;  // Unique identifier
@@ -50,15 +103,21 @@ struct CameraConfig {
     LONG userID = -1;
     LONG realPlayHandle = -1;
     std::unique_ptr<Yolov8ThreadPool> yolov8_pool;
+    std::unique_ptr<Yolov8ThreadPool> cascade_pool;  // Larger model, cascade=<path> only
+    ModelCascade cascade;
     std::atomic<int> frame_id{0};
     std::atomic<bool> stop_flag{false};
-    sqlite3* db = nullptr;
-    sqlite3* send_db = nullptr;
+    int db_slot = -1;  // Device number in g_detection_writer (includes the shard)
+    int log_slot = -1;  // Camera number in g_detection_log
+    int count_slot = -1;  // Camera number in g_count_aggregator
+    CountSmoother count_smoother;  // Sliding-window max/median/mean of the per-frame count
     time_t last_minute = 0;
     
     // Video stream related
     int g_nPort = -1;
     Mat g_BGRImage;
+    uint32_t g_frame_stamp = 0;  // nStamp of g_BGRImage
+    std::chrono::steady_clock::time_point g_frame_time;  // When g_BGRImage was decoded, for the frame age
     std::mutex g_frame_mutex;
     
     // Performance statistics
@@ -68,6 +127,57 @@ struct CameraConfig {
 
     cv::Mat exclusion_mask;
     std::mutex mask_mutex;
+
+    // Configured resolution and per-camera options
+    cv::Size frame_size{1920, 1080};
+    CameraOptions options;
+    cv::Rect active_region;  // Inference crop around the counting region
+    TileScheduler tile_scheduler;  // Tiled inference, empty when tiling is off
+
+    // Motion gating: Y-plane thumbnail of the latest decoded frame (guarded by g_frame_mutex)
+    MotionGate motion_gate;
+    cv::Mat motion_thumb;
+    std::vector<Detection> cached_detections;  // Reused while the scene does not change
+    int frames_inferred = 0;
+    int frames_skipped = 0;
+
+    // Tracking: inference every N frames, Kalman-predicted tracks fill the frames in between
+    MultiObjectTracker tracker;
+    int frames_tracked = 0;
+
+    // Optical-flow propagation: downsampled Y plane of the latest frame (guarded by g_frame_mutex)
+    FlowPropagator flow;
+    cv::Mat flow_gray;
+    int frames_propagated = 0;
+
+    int rate_slot = -1;  // Slot in g_rate_allocator
+
+    // Overload degradation: throttled display and one DB row per second carrying the highest count
+    std::chrono::steady_clock::time_point last_display;
+    std::chrono::steady_clock::time_point last_db_row;
+    int db_pending_max = 0;
+    std::chrono::steady_clock::time_point last_reported_frame;  // g_frame_time of the last reported frame age
+
+    // Compressed-domain activity gating: packet sizes decide between full and key-frame-only decode
+    StreamActivityEstimator stream_activity;
+    int decode_frame_type = 0;                 // Current PlayM4_SetDecodeFrameType value (stream callback thread)
+    std::atomic<uint32_t> decoded_frames{0};   // Incremented for every converted frame
+    uint32_t inferred_decode_seq = 0;          // decoded_frames at the last inference
+    uint32_t stepped_decode_seq = 0;           // decoded_frames at the last inference, flow or tracker step
+    std::chrono::steady_clock::time_point last_infer_time;
+    std::chrono::steady_clock::time_point last_key_request;
+
+    // Decode policy: full / decimated / key frames only, switchable at runtime
+    DecodeRateController decode_rate;
+
+    // Dual-stream mode: inference on the sub-stream, main stream opened on demand
+    std::unique_ptr<MainStream> main_stream;
+    std::chrono::steady_clock::time_point last_evidence;
+
+#ifdef ENABLE_FFMPEG_DECODE
+    // Software decode backend (decoder=ffmpeg); PlayM4 is not used when set
+    std::unique_ptr<SwDecoder> sw_decoder;
+#endif
     
     CameraConfig(const CameraConfig&) = delete;
     CameraConfig& operator=(const CameraConfig&) = delete;
@@ -81,20 +191,54 @@ struct CameraConfig {
           userID(other.userID),
           realPlayHandle(other.realPlayHandle),
           yolov8_pool(std::move(other.yolov8_pool)),
+          cascade_pool(std::move(other.cascade_pool)),
+          cascade(other.cascade),
           frame_id(other.frame_id.load()),
           stop_flag(other.stop_flag.load()),
-          db(other.db),
-          send_db(other.send_db),
+          db_slot(other.db_slot),
+          log_slot(other.log_slot),
+          count_slot(other.count_slot),
+          count_smoother(std::move(other.count_smoother)),
           last_minute(other.last_minute),
           g_nPort(other.g_nPort),
           g_BGRImage(std::move(other.g_BGRImage)),
           frame_counter(other.frame_counter.load()),
           last_stat_time(other.last_stat_time),
           fps(other.fps),
-          exclusion_mask(std::move(other.exclusion_mask))
+          exclusion_mask(std::move(other.exclusion_mask)),
+          frame_size(other.frame_size),
+          options(std::move(other.options)),
+          active_region(other.active_region),
+          tile_scheduler(std::move(other.tile_scheduler)),
+          motion_gate(std::move(other.motion_gate)),
+          motion_thumb(std::move(other.motion_thumb)),
+          cached_detections(std::move(other.cached_detections)),
+          frames_inferred(other.frames_inferred),
+          frames_skipped(other.frames_skipped),
+          tracker(std::move(other.tracker)),
+          frames_tracked(other.frames_tracked),
+          flow(std::move(other.flow)),
+          flow_gray(std::move(other.flow_gray)),
+          frames_propagated(other.frames_propagated),
+          rate_slot(other.rate_slot),
+          last_display(other.last_display),
+          last_db_row(other.last_db_row),
+          db_pending_max(other.db_pending_max),
+          last_reported_frame(other.last_reported_frame),
+          stream_activity(other.stream_activity),
+          decode_frame_type(other.decode_frame_type),
+          decoded_frames(other.decoded_frames.load()),
+          inferred_decode_seq(other.inferred_decode_seq),
+          stepped_decode_seq(other.stepped_decode_seq),
+          last_infer_time(other.last_infer_time),
+          last_key_request(other.last_key_request),
+          decode_rate(other.decode_rate),
+          main_stream(std::move(other.main_stream)),
+          last_evidence(other.last_evidence)
+#ifdef ENABLE_FFMPEG_DECODE
+          , sw_decoder(std::move(other.sw_decoder))
+#endif
     {
-        other.db = nullptr;
-        other.send_db = nullptr;
         other.g_nPort = -1;
         other.frame_counter = 0;
     }
@@ -109,10 +253,14 @@ struct CameraConfig {
             userID = other.userID;
             realPlayHandle = other.realPlayHandle;
             yolov8_pool = std::move(other.yolov8_pool);
+            cascade_pool = std::move(other.cascade_pool);
+            cascade = other.cascade;
             frame_id = other.frame_id.load();
             stop_flag = other.stop_flag.load();
-            db = other.db;
-            send_db = other.send_db;
+            db_slot = other.db_slot;
+            log_slot = other.log_slot;
+            count_slot = other.count_slot;
+            count_smoother = std::move(other.count_smoother);
             last_minute = other.last_minute;
             g_nPort = other.g_nPort;
             g_BGRImage = std::move(other.g_BGRImage);
@@ -120,9 +268,39 @@ struct CameraConfig {
             last_stat_time = other.last_stat_time;
             fps = other.fps;
             exclusion_mask = std::move(other.exclusion_mask);
+            frame_size = other.frame_size;
+            options = std::move(other.options);
+            active_region = other.active_region;
+            tile_scheduler = std::move(other.tile_scheduler);
+            motion_gate = std::move(other.motion_gate);
+            motion_thumb = std::move(other.motion_thumb);
+            cached_detections = std::move(other.cached_detections);
+            frames_inferred = other.frames_inferred;
+            frames_skipped = other.frames_skipped;
+            tracker = std::move(other.tracker);
+            frames_tracked = other.frames_tracked;
+            flow = std::move(other.flow);
+            flow_gray = std::move(other.flow_gray);
+            frames_propagated = other.frames_propagated;
+            rate_slot = other.rate_slot;
+            last_display = other.last_display;
+            last_db_row = other.last_db_row;
+            db_pending_max = other.db_pending_max;
+            last_reported_frame = other.last_reported_frame;
+            stream_activity = other.stream_activity;
+            decode_frame_type = other.decode_frame_type;
+            decoded_frames = other.decoded_frames.load();
+            inferred_decode_seq = other.inferred_decode_seq;
+            stepped_decode_seq = other.stepped_decode_seq;
+            last_infer_time = other.last_infer_time;
+            last_key_request = other.last_key_request;
+            decode_rate = other.decode_rate;
+            main_stream = std::move(other.main_stream);
+            last_evidence = other.last_evidence;
+#ifdef ENABLE_FFMPEG_DECODE
+            sw_decoder = std::move(other.sw_decoder);
+#endif
 
-            other.db = nullptr;
-            other.send_db = nullptr;
             other.g_nPort = -1;
             other.frame_counter = 0;
         }
@@ -133,8 +311,6 @@ struct CameraConfig {
     
     ~CameraConfig() {
         stop_flag = true;
-        if (db) sqlite3_close(db);
-        if (send_db) sqlite3_close(send_db);
         if (g_nPort != -1) {
             PlayM4_Stop(g_nPort);
             PlayM4_CloseStream(g_nPort);
@@ -145,25 +321,188 @@ struct CameraConfig {
 
 // Global configuration
 std::string g_model_path;
+// Global inference budget shared by all cameras (infer_budget=N in the config file, off by default)
+InferenceRateAllocator g_rate_allocator;
+// System-wide overload ladder driven by frame ages and inference queue depths
+OverloadController g_overload;
+// Detection rows are written in batches by dedicated threads, one per database shard (db_shards=)
+DetectionShards g_detection_writer;
+// Every processed frame's boxes, appended to an hourly memory-mapped binary log (detection_log=dir, off by default)
+DetectionLog g_detection_log;
 int g_num_threads_per_camera = 2;
 const int MAX_CAMERAS = 4;
 
+// Store a decoded 4:2:0 frame (YV12 from PlayM4, I420 from the software decoder) as the latest frame
+static void StoreDecodedFrame(CameraConfig* config, const uint8_t* yuv, int width, int height, uint32_t stamp, int colorCode) {
+    std::unique_lock<std::mutex> lock(config->g_frame_mutex, std::try_to_lock);
+    if (lock.owns_lock()) {
+        Mat yuvImg(height + height/2, width, CV_8UC1, (uchar*)yuv);
+        cvtColor(yuvImg, config->g_BGRImage, colorCode);
+        config->g_frame_stamp = stamp;
+        config->g_frame_time = std::chrono::steady_clock::now();
+        if (config->motion_gate.enabled()) {
+            // The Y plane is the first height rows of the buffer
+            config->motion_gate.thumbnail(yuv, width, height, width, config->motion_thumb);
+        }
+        if (config->flow.enabled()) {
+            config->flow.downsample(yuv, width, height, width, config->flow_gray);
+        }
+        config->decoded_frames++;
+    }
+}
+
 // Fixed callback function signature - added nReserved2 parameter
 void CALLBACK DecCBFun(int nPort, char* pBuf, int nSize, FRAME_INFO* pFrameInfo, void* nUser, int nReserved2) {
     CameraConfig* config = reinterpret_cast<CameraConfig*>(nUser);
     if (pFrameInfo->nType == T_YV12 && !config->stop_flag) {
-        std::unique_lock<std::mutex> lock(config->g_frame_mutex, std::try_to_lock);
-        if (lock.owns_lock()) {
-            Mat yuvImg(pFrameInfo->nHeight + pFrameInfo->nHeight/2, pFrameInfo->nWidth, CV_8UC1, (uchar*)pBuf);
-            cvtColor(yuvImg, config->g_BGRImage, COLOR_YUV2BGR_YV12);
+        // Frames the decode policy does not need are dropped before the colour conversion
+        if (!config->decode_rate.accept(pFrameInfo->nStamp)) {
+            return;
         }
+        StoreDecodedFrame(config, (const uint8_t*)pBuf, pFrameInfo->nWidth, pFrameInfo->nHeight,
+                          pFrameInfo->nStamp, COLOR_YUV2BGR_YV12);
+    }
+}
+
+// Main stream decode callback (stream=dual): keep a copy of the YV12 frame, convert on demand
+void CALLBACK MainDecCBFun(int nPort, char* pBuf, int nSize, FRAME_INFO* pFrameInfo, void* nUser, int nReserved2) {
+    MainStream* stream = reinterpret_cast<MainStream*>(nUser);
+    if (pFrameInfo->nType != T_YV12) return;
+
+    std::lock_guard<std::mutex> lock(stream->mutex);
+    cv::Mat yv12;
+    if (stream->frames.size() >= MainStream::kRingSize) {
+        // Reuse the oldest buffer
+        yv12 = stream->frames.front().second;
+        stream->frames.pop_front();
     }
+    Mat(pFrameInfo->nHeight + pFrameInfo->nHeight/2, pFrameInfo->nWidth, CV_8UC1, (uchar*)pBuf).copyTo(yv12);
+    stream->frames.emplace_back(pFrameInfo->nStamp, yv12);
+}
+
+void CALLBACK MainDataCallBack(LONG lPlayHandle, DWORD dwDataType, BYTE *pBuffer, DWORD dwBufSize, void* pUser) {
+    MainStream* stream = static_cast<MainStream*>(pUser);
+    if (dwDataType == NET_DVR_STREAMDATA && dwBufSize > 0 && stream->port != -1) {
+        PlayM4_InputData(stream->port, pBuffer, dwBufSize);
+    }
+}
+
+bool MainStream::open() {
+    if (isOpen()) return true;
+    if (!PlayM4_GetPort(&port)) {
+        port = -1;
+        return false;
+    }
+    if (!PlayM4_SetStreamOpenMode(port, STREAME_REALTIME) ||
+        !PlayM4_OpenStream(port, NULL, 0, 1024*1024) ||
+        !PlayM4_SetDecCallBackExMend(port, MainDecCBFun, NULL, 0, this) ||
+        !PlayM4_Play(port, 0)) {
+        std::cerr << "Failed to open main stream player: " << id << std::endl;
+        close();
+        return false;
+    }
+
+    NET_DVR_PREVIEWINFO previewInfo = {0};
+    previewInfo.lChannel = channel;
+    previewInfo.dwStreamType = 0;
+    previewInfo.dwLinkMode = 0;
+    previewInfo.bBlocked = 1;
+    {
+        std::lock_guard<std::mutex> lock(g_hik_mutex);
+        handle = NET_DVR_RealPlay_V40(userID, &previewInfo, MainDataCallBack, this);
+    }
+    if (handle < 0) {
+        std::cerr << "Failed to start main stream: " << id << " Error: " << NET_DVR_GetLastError() << std::endl;
+        close();
+        return false;
+    }
+    std::cout << "Camera " << id << " main stream opened" << std::endl;
+    return true;
+}
+
+void MainStream::close() {
+    if (handle >= 0) {
+        std::lock_guard<std::mutex> lock(g_hik_mutex);
+        NET_DVR_StopRealPlay(handle);
+        handle = -1;
+        std::cout << "Camera " << id << " main stream closed" << std::endl;
+    }
+    if (port != -1) {
+        PlayM4_Stop(port);
+        PlayM4_CloseStream(port);
+        PlayM4_FreePort(port);
+        port = -1;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    frames.clear();
+}
+
+void MainStream::demand() {
+    last_demand = std::chrono::steady_clock::now();
+    if (!isOpen()) {
+        open();
+    }
+}
+
+void MainStream::closeIfUnused(double idle_seconds) {
+    if (isOpen() && std::chrono::duration<double>(std::chrono::steady_clock::now() - last_demand).count() > idle_seconds) {
+        close();
+    }
+}
+
+bool MainStream::grab(uint32_t stamp, cv::Mat& bgr) {
+    cv::Mat yv12;
+    {
+        // Both streams of a channel carry the capture time, so nStamp lines them up
+        std::lock_guard<std::mutex> lock(mutex);
+        int64_t best = -1;
+        for (const auto& frame : frames) {
+            int64_t diff = std::abs((int64_t)frame.first - (int64_t)stamp);
+            if (best < 0 || diff < best) {
+                best = diff;
+                yv12 = frame.second.clone();
+            }
+        }
+    }
+    if (yv12.empty()) return false;
+    cvtColor(yv12, bgr, COLOR_YUV2BGR_YV12);
+    return true;
 }
 
 // Real-time data callback
 void CALLBACK RealDataCallBack_V30(LONG lPlayHandle, DWORD dwDataType, BYTE *pBuffer, DWORD dwBufSize, void* pUser) {
     CameraConfig* config = static_cast<CameraConfig*>(pUser);
-    if (dwDataType == NET_DVR_STREAMDATA && dwBufSize > 0 && config->g_nPort != -1 && !config->stop_flag) {
+    bool decoderReady = config->g_nPort != -1;
+#ifdef ENABLE_FFMPEG_DECODE
+    decoderReady = decoderReady || config->sw_decoder;
+#endif
+    if (dwDataType == NET_DVR_STREAMDATA && dwBufSize > 0 && decoderReady && !config->stop_flag) {
+        // Static scene: only key frames are decoded until the P-frame sizes show motion again
+        bool idle = false;
+        if (config->stream_activity.enabled()) {
+            config->stream_activity.feed(pBuffer, dwBufSize, std::chrono::steady_clock::now());
+            idle = config->stream_activity.idle();
+        }
+        int frameType = (config->decode_rate.keyFramesOnly() || idle) ? 1 : 0;
+#ifdef ENABLE_FFMPEG_DECODE
+        if (config->sw_decoder) {
+            if (frameType != config->decode_frame_type) {
+                config->sw_decoder->setKeyFramesOnly(frameType == 1);
+                config->decode_frame_type = frameType;
+                std::cout << "Camera " << config->unique_id
+                          << (frameType ? ": decoding key frames only" : ": decoding all frames")
+                          << (idle ? " (static scene)" : "") << std::endl;
+            }
+            config->sw_decoder->feedPs(pBuffer, dwBufSize);
+            return;
+        }
+#endif
+        if (frameType != config->decode_frame_type && PlayM4_SetDecodeFrameType(config->g_nPort, frameType)) {
+            config->decode_frame_type = frameType;
+            std::cout << "Camera " << config->unique_id
+                      << (frameType ? ": decoding key frames only" : ": decoding all frames")
+                      << (idle ? " (static scene)" : "") << std::endl;
+        }
         if (!PlayM4_InputData(config->g_nPort, pBuffer, dwBufSize)) {
             std::cerr << "PlayM4 input data failed: " << NET_DVR_GetLastError() << std::endl;
         }
@@ -183,77 +522,10 @@ std::string GetCurrentTimestamp() {
     return oss.str();
 }
 
-// Initialize database
-sqlite3* GetDatabaseConnection(const std::string& db_name) {
-    std::lock_guard<std::mutex> lock(db_pool_mutex);
-    
-    if (db_pool.find(db_name) != db_pool.end()) {
-        return db_pool[db_name];
-    }
-
-    std::string db_path = "./" + db_name;
-    sqlite3* db = nullptr;
-    
-    system(("mkdir -p $(dirname '" + db_path + "') 2>/dev/null").c_str());
-
-    if (sqlite3_open_v2(db_path.c_str(), &db, 
-        SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_FULLMUTEX, 
-        nullptr) != SQLITE_OK) 
-    {
-        std::cerr << "Database connection failed: " << sqlite3_errmsg(db) << std::endl;
-        return nullptr;
-    }
-
-    sqlite3_exec(db, "PRAGMA journal_mode=WAL;", nullptr, nullptr, nullptr);
-    sqlite3_exec(db, "PRAGMA synchronous=NORMAL;", nullptr, nullptr, nullptr);
-
-    const char* create_sql = "CREATE TABLE IF NOT EXISTS detection_results ("
-                           "id INTEGER PRIMARY KEY AUTOINCREMENT,"
-                           "device TEXT NOT NULL,"
-                           "timestamp TEXT NOT NULL,"
-                           "box_count INTEGER NOT NULL);";
-    
-    char* errMsg = nullptr;
-    if (sqlite3_exec(db, create_sql, nullptr, nullptr, &errMsg) != SQLITE_OK) {
-        std::cerr << "Create table failed: " << errMsg << std::endl;
-        sqlite3_free(errMsg);
-        sqlite3_close(db);
-        return nullptr;
-    }
-
-    db_pool[db_name] = db;
-    return db;
-}
-
-// Save to database
-bool SaveToDatabase(sqlite3* db, const std::string& device, int boxCount) {
-    if (boxCount <= 0) return true;
-
-    const char* sql = "INSERT INTO detection_results (device, timestamp, box_count) VALUES (?, ?, ?);";
-    sqlite3_stmt* stmt;
-    
-    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK) {
-        std::cerr << "SQL preparation failed: " << sqlite3_errmsg(db) << std::endl;
-        return false;
-    }
-    
-    std::string timestamp = GetCurrentTimestamp();
-    sqlite3_bind_text(stmt, 1, device.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 2, timestamp.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_int(stmt, 3, boxCount);
-    
-    bool success = (sqlite3_step(stmt) == SQLITE_DONE);
-    sqlite3_finalize(stmt);
-    
-    if (success && boxCount > 0) {
-        uint16_t current_max = g_max_box_count.load();
-        if (boxCount > current_max) {
-            g_max_box_count.store(boxCount);
-            update_max_info(device, timestamp);
-            send_people_count(boxCount);
-        }
-    }
-    return success;
+// Queue a detection row for the writer thread; never waits on storage.
+// Zero counts only end change-only spans, the writer does not store them as samples (skip_zero)
+void SaveToDatabase(int slot, int boxCount) {
+    g_detection_writer.push(slot, DetectionWriter::nowMs(), boxCount);
 }
 
 std::vector<CameraConfig> ReadCameraConfig(const std::string& configFile) {
@@ -270,6 +542,9 @@ std::vector<CameraConfig> ReadCameraConfig(const std::string& configFile) {
         camera.username = cfg.username;
         camera.password = cfg.password;
         camera.channel = cfg.channel;
+        camera.frame_size = cv::Size(cfg.width, cfg.height);
+        camera.options = cfg.options;
+        camera.active_region = cfg.active_region;
         
         // Create exclusion mask
         camera.exclusion_mask = createExclusionMask(cfg.width, cfg.height, cfg.exclusion_zones);
@@ -287,23 +562,142 @@ std::vector<CameraConfig> ReadCameraConfig(const std::string& configFile) {
     return cameras;
 }
 
-// Camera processing thread
-void ProcessCameraStream(CameraConfig& cameraConfig) {
-    // Initialize database
-    cameraConfig.db = GetDatabaseConnection("detection_results.db");
-    cameraConfig.send_db = GetDatabaseConnection("detection_results_send.db");
+// Configure the global inference budget and the overload ladder; cameras are registered once, on the first call
+void ApplyGlobalOptions(const GlobalOptions& global, std::vector<CameraConfig>& cameras) {
+    InferenceRateAllocator::Params params = g_rate_allocator.params();
+    params.budget = global.infer_budget;
+    params.min_rate = global.infer_min_rate;
+    params.max_rate = global.infer_max_rate;
+    g_rate_allocator.configure(params);
+
+    OverloadController::Params overload = g_overload.params();
+    overload.enabled = global.overload;
+    overload.max_age_ms = global.overload_age_ms;
+    overload.recover_age_ms = global.overload_age_ms * 0.3;
+    overload.max_queue = global.overload_queue;
+    g_overload.configure(overload);
 
-    if (!cameraConfig.db || !cameraConfig.send_db) {
-        std::cerr << "Fatal error: Failed to initialize database connection" << std::endl;
-        exit(EXIT_FAILURE);
+    CountSmoother::Statistic serial_stat = CountSmoother::kRaw;
+    CountSmoother::Statistic db_stat = CountSmoother::kRaw;
+    CountSmoother::parseStatistic(global.serial_stat, serial_stat);
+    CountSmoother::parseStatistic(global.db_stat, db_stat);
+    g_serial_statistic = serial_stat;
+    g_db_statistic = db_stat;
+    if (serial_stat != CountSmoother::kRaw || db_stat != CountSmoother::kRaw) {
+        std::cout << "Smoothed counts: serial " << CountSmoother::statisticName(serial_stat)
+                  << ", database " << CountSmoother::statisticName(db_stat) << std::endl;
     }
 
+    for (auto& camera : cameras) {
+        if (camera.rate_slot < 0) {
+            camera.rate_slot = g_rate_allocator.addCamera(camera.unique_id);
+        }
+    }
+    if (g_rate_allocator.enabled()) {
+        std::cout << "Inference budget: " << params.budget << "/s across " << cameras.size()
+                  << " cameras, " << params.min_rate << "-" << params.max_rate << "/s each" << std::endl;
+    }
+}
+
+// Scale a rectangle between the configured resolution and a decoded stream's resolution
+static cv::Rect scaleRect(const cv::Rect& r, double sx, double sy) {
+    return cv::Rect(cvRound(r.x * sx), cvRound(r.y * sy), cvRound(r.width * sx), cvRound(r.height * sy));
+}
+
+// Camera processing thread
+void ProcessCameraStream(CameraConfig& cameraConfig) {
     // Initialize YOLOv8 thread pool
     cameraConfig.yolov8_pool = std::make_unique<Yolov8ThreadPool>();
-    if (cameraConfig.yolov8_pool->setUp(g_model_path, g_num_threads_per_camera) != NN_SUCCESS) {
+    tensor_pack_param_s pack_param = nn_tensor_pack_default_param();
+    pack_param.mode = nn_tensor_pack_mode_from_string(cameraConfig.options.input_pack);
+    for (int c = 0; c < 3; c++) {
+        pack_param.mean[c] = cameraConfig.options.input_mean[c];
+        pack_param.std[c] = cameraConfig.options.input_std[c];
+    }
+    const std::string& model_path = cameraConfig.options.model.empty() ? g_model_path : cameraConfig.options.model;
+    if (cameraConfig.yolov8_pool->setUp(model_path, g_num_threads_per_camera, cameraConfig.options.preprocess,
+                                        pack_param) != NN_SUCCESS) {
         std::cerr << "Failed to initialize YOLOv8 thread pool: " << cameraConfig.ip << std::endl;
         return;
     }
+    // Boxes are drawn in the result path; the pools leave the submitted frame untouched,
+    // so the cascade reruns the same pixels the small model saw
+    cameraConfig.yolov8_pool->setDrawDetections(false);
+
+    // Cascade: the model above runs on every inference, the larger one only when it is unsure
+    if (!cameraConfig.options.cascade.empty()) {
+        cameraConfig.cascade_pool = std::make_unique<Yolov8ThreadPool>();
+        if (cameraConfig.cascade_pool->setUp(cameraConfig.options.cascade, g_num_threads_per_camera,
+                                             cameraConfig.options.preprocess, pack_param) != NN_SUCCESS) {
+            std::cerr << "Failed to load cascade model " << cameraConfig.options.cascade
+                      << ", running without it: " << cameraConfig.unique_id << std::endl;
+            cameraConfig.cascade_pool.reset();
+        } else {
+            cameraConfig.cascade_pool->setDrawDetections(false);
+            ModelCascade::Params cascade_params;
+            cascade_params.density = cameraConfig.options.cascade_density;
+            cascade_params.low_conf = cameraConfig.options.cascade_conf;
+            cascade_params.count_diff = cameraConfig.options.cascade_diff;
+            cameraConfig.cascade.configure(cascade_params);
+        }
+    }
+
+    // Split the inference region into overlapping tiles for high-resolution cameras
+    cv::Size infer_size = cameraConfig.active_region.size();
+    if (cameraConfig.options.tile_cols * cameraConfig.options.tile_rows > 1) {
+        auto tiles = planTiles(cameraConfig.active_region, cameraConfig.options.tile_cols,
+                               cameraConfig.options.tile_rows, cameraConfig.options.tile_overlap);
+        cameraConfig.tile_scheduler = TileScheduler(tiles);
+        infer_size = tiles[0].size();
+        std::cout << "Camera " << cameraConfig.unique_id << " tiled inference: " << tiles.size()
+                  << " tiles of " << infer_size.width << "x" << infer_size.height << std::endl;
+    }
+
+    if (cameraConfig.options.motion) {
+        MotionGate::Params motion_params;
+        motion_params.pixel_threshold = cameraConfig.options.motion_threshold;
+        motion_params.refresh_seconds = cameraConfig.options.motion_refresh;
+        cameraConfig.motion_gate.configure(motion_params, cameraConfig.active_region, cameraConfig.frame_size);
+    }
+
+    if (cameraConfig.options.track) {
+        MultiObjectTracker::Params track_params;
+        track_params.max_interval = cameraConfig.options.track_interval;
+        track_params.max_gap_seconds = cameraConfig.options.track_gap;
+        cameraConfig.tracker.configure(track_params);
+    }
+
+    if (cameraConfig.options.flow) {
+        FlowPropagator::Params flow_params;
+        flow_params.max_frames = cameraConfig.options.flow_interval;
+        flow_params.max_drift = cameraConfig.options.flow_drift;
+        cameraConfig.flow.configure(flow_params, cameraConfig.frame_size);
+    }
+
+    CountSmoother::Params smooth_params;
+    smooth_params.window_seconds = cameraConfig.options.smooth_window;
+    cameraConfig.count_smoother.configure(smooth_params);
+
+    DecodePolicy decode_policy;
+    parseDecodePolicy(cameraConfig.options.decode, decode_policy);
+    cameraConfig.decode_rate.setPolicy(decode_policy);
+
+    if (cameraConfig.options.activity) {
+        StreamActivityEstimator::Params activity_params;
+        activity_params.idle_seconds = cameraConfig.options.activity_idle;
+        activity_params.refresh_seconds = cameraConfig.options.activity_refresh;
+        cameraConfig.stream_activity.configure(activity_params);
+    }
+
+    // Pick the preprocess backend for this camera's inference size before the first frame arrives
+    // (the sub-stream resolution is only known once it is decoded)
+    const bool useSubStream = cameraConfig.options.stream != "main";
+    if (!useSubStream) {
+        cameraConfig.yolov8_pool->warmUp(infer_size.width, infer_size.height);
+        if (cameraConfig.cascade_pool) {
+            cameraConfig.cascade_pool->warmUp(cameraConfig.active_region.width, cameraConfig.active_region.height);
+        }
+    }
 
     // Device login
     NET_DVR_USER_LOGIN_INFO loginInfo = {0};
@@ -324,42 +718,77 @@ void ProcessCameraStream(CameraConfig& cameraConfig) {
         return;
     }
 
-    // Initialize playback library
-    if (!PlayM4_GetPort(&cameraConfig.g_nPort)) {
-        std::cerr << "Failed to get playback port: " << cameraConfig.ip << std::endl;
-        NET_DVR_Logout(cameraConfig.userID);
-        return;
+    // Initialize the decoder: PlayM4, or the in-process software decoder (decoder=ffmpeg)
+    bool useSwDecoder = cameraConfig.options.decoder == "ffmpeg";
+#ifdef ENABLE_FFMPEG_DECODE
+    if (useSwDecoder) {
+        SwDecoder::Params decoderParams;
+        decoderParams.threads = cameraConfig.options.decode_threads;
+        decoderParams.out_width = cameraConfig.options.decode_width;
+        decoderParams.out_height = cameraConfig.options.decode_height;
+        decoderParams.skip_nonref = cameraConfig.options.skip_nonref;
+        CameraConfig* config = &cameraConfig;
+        cameraConfig.sw_decoder = std::make_unique<SwDecoder>();
+        bool opened = cameraConfig.sw_decoder->openPs(decoderParams,
+            [config](const SwDecoder::Frame& frame) {
+                if (!config->stop_flag) {
+                    StoreDecodedFrame(config, frame.data, frame.width, frame.height, frame.stamp_ms, COLOR_YUV2BGR_I420);
+                }
+            },
+            // Frames the decode policy does not need are dropped before scaling and colour conversion
+            [config](uint32_t stamp) { return config->decode_rate.accept(stamp); });
+        if (!opened) {
+            std::cerr << "Failed to start software decoder: " << cameraConfig.ip << std::endl;
+            cameraConfig.sw_decoder.reset();
+            NET_DVR_Logout(cameraConfig.userID);
+            return;
+        }
     }
-
-    if (!PlayM4_SetStreamOpenMode(cameraConfig.g_nPort, STREAME_REALTIME)) {
-        std::cerr << "Failed to set stream mode: " << cameraConfig.ip << std::endl;
-        NET_DVR_Logout(cameraConfig.userID);
-        return;
+#else
+    if (useSwDecoder) {
+        std::cerr << "Warning: built without ENABLE_FFMPEG_DECODE, using PlayM4: " << cameraConfig.ip << std::endl;
+        useSwDecoder = false;
     }
+#endif
 
-    if (!PlayM4_OpenStream(cameraConfig.g_nPort, NULL, 0, 1024*1024)) {
-        std::cerr << "Failed to open stream: " << cameraConfig.ip << std::endl;
-        NET_DVR_Logout(cameraConfig.userID);
-        return;
-    }
+    // Initialize playback library
+    if (!useSwDecoder) {
+        if (!PlayM4_GetPort(&cameraConfig.g_nPort)) {
+            std::cerr << "Failed to get playback port: " << cameraConfig.ip << std::endl;
+            NET_DVR_Logout(cameraConfig.userID);
+            return;
+        }
 
-    // Use fixed callback function signature
-    if (!PlayM4_SetDecCallBackExMend(cameraConfig.g_nPort, DecCBFun, NULL, 0, &cameraConfig)) {
-        std::cerr << "Failed to set decode callback: " << cameraConfig.ip << std::endl;
-        NET_DVR_Logout(cameraConfig.userID);
-        return;
-    }
+        if (!PlayM4_SetStreamOpenMode(cameraConfig.g_nPort, STREAME_REALTIME)) {
+            std::cerr << "Failed to set stream mode: " << cameraConfig.ip << std::endl;
+            NET_DVR_Logout(cameraConfig.userID);
+            return;
+        }
 
-    if (!PlayM4_Play(cameraConfig.g_nPort, 0)) {
-        std::cerr << "Failed to start playback: " << cameraConfig.ip << std::endl;
-        NET_DVR_Logout(cameraConfig.userID);
-        return;
+        if (!PlayM4_OpenStream(cameraConfig.g_nPort, NULL, 0, 1024*1024)) {
+            std::cerr << "Failed to open stream: " << cameraConfig.ip << std::endl;
+            NET_DVR_Logout(cameraConfig.userID);
+            return;
+        }
+
+        // Use fixed callback function signature
+        if (!PlayM4_SetDecCallBackExMend(cameraConfig.g_nPort, DecCBFun, NULL, 0, &cameraConfig)) {
+            std::cerr << "Failed to set decode callback: " << cameraConfig.ip << std::endl;
+            NET_DVR_Logout(cameraConfig.userID);
+            return;
+        }
+
+        if (!PlayM4_Play(cameraConfig.g_nPort, 0)) {
+            std::cerr << "Failed to start playback: " << cameraConfig.ip << std::endl;
+            NET_DVR_Logout(cameraConfig.userID);
+            return;
+        }
     }
 
     // Set preview parameters
     NET_DVR_PREVIEWINFO previewInfo = {0};
     previewInfo.lChannel = cameraConfig.channel;
-    previewInfo.dwStreamType = 0;
+    previewInfo.dwStreamType = useSubStream ? 1 : 0;
     previewInfo.dwLinkMode = 0;
     previewInfo.bBlocked = 1;
 
@@ -375,6 +804,13 @@ void ProcessCameraStream(CameraConfig& cameraConfig) {
         return;
     }
 
+    if (cameraConfig.options.stream == "dual") {
+        cameraConfig.main_stream = std::make_unique<MainStream>();
+        cameraConfig.main_stream->id = cameraConfig.unique_id;
+        cameraConfig.main_stream->userID = cameraConfig.userID;
+        cameraConfig.main_stream->channel = cameraConfig.channel;
+    }
+
     // Create display window - use unique ID to ensure unique window name
     std::string windowName = "Camera " + cameraConfig.unique_id;
     {
@@ -396,73 +832,330 @@ void ProcessCameraStream(CameraConfig& cameraConfig) {
 
         // Get video frame
         cv::Mat frameCopy;
+        cv::Mat thumbCopy;
+        cv::Mat flowGray;
+        uint32_t frameStamp = 0;
+        uint32_t frameSeq = 0;
+        std::chrono::steady_clock::time_point decodeTime;
         {
             std::unique_lock<std::mutex> lock(cameraConfig.g_frame_mutex, std::try_to_lock);
             if (lock.owns_lock() && !cameraConfig.g_BGRImage.empty()) {
                 frameCopy = cameraConfig.g_BGRImage.clone();
+                cameraConfig.motion_thumb.copyTo(thumbCopy);
+                cameraConfig.flow_gray.copyTo(flowGray);
+                frameStamp = cameraConfig.g_frame_stamp;
+                frameSeq = cameraConfig.decoded_frames.load();
+                decodeTime = cameraConfig.g_frame_time;
             }
         }
 
         if (!frameCopy.empty()) {
-            int currentFrameId = cameraConfig.frame_id++;
-            cameraConfig.yolov8_pool->submitTask(frameCopy, currentFrameId);
+            // Overload ladder, sampled once per frame so a level change never splits a frame
+            const int overloadLevel = g_overload.level();
+
+            // Regions, masks and counts stay in the configured (main-stream) resolution;
+            // the decoded frame may be smaller (sub-stream), so scale on the way in and out
+            const double sx = (double)frameCopy.cols / cameraConfig.frame_size.width;
+            const double sy = (double)frameCopy.rows / cameraConfig.frame_size.height;
 
             // Get inference results
             cv::Mat resultImg;
             int rawBoxCount = 0;
             std::vector<Detection> detections;
-            
-            if (cameraConfig.yolov8_pool->getTargetImgResultWithDetections(
-                resultImg, currentFrameId, rawBoxCount, detections) == NN_SUCCESS) {
-                
-                // Filter detection boxes
+            bool gotResult = false;
+
+            auto frameTime = std::chrono::steady_clock::now();
+            bool infer = cameraConfig.motion_gate.shouldInfer(thumbCopy, frameTime);
+            if (infer && cameraConfig.stream_activity.idle()) {
+                // Idle stream: infer only on newly decoded key frames, or when the minimum refresh is due
+                uint32_t decoded = cameraConfig.decoded_frames.load();
+                double sinceInfer = std::chrono::duration<double>(frameTime - cameraConfig.last_infer_time).count();
+                infer = decoded != cameraConfig.inferred_decode_seq ||
+                        sinceInfer >= cameraConfig.stream_activity.params().refresh_seconds;
+            }
+            // Flow and tracker steps need a newly decoded frame: the same frame shown again would spend
+            // the flow budget and advance the Kalman state without a new observation
+            const bool newFrame = frameSeq != cameraConfig.stepped_decode_seq;
+            // Optical flow: shift the last inferred boxes instead of running the model, until they drift too far
+            bool propagated = infer && newFrame && cameraConfig.flow.enabled() && cameraConfig.flow.ready() &&
+                              cameraConfig.flow.propagate(flowGray, detections);
+            const bool flowRepeat = !newFrame && infer && cameraConfig.flow.enabled() && cameraConfig.flow.ready();
+            bool tracked = !propagated && infer && cameraConfig.tracker.enabled() &&
+                           !cameraConfig.tracker.shouldInfer(frameTime);
+            // Global budget: cameras with fewer people and less change get fewer inferences;
+            // a refused frame is filled by the tracker when it is on, else by the last detections.
+            // The last overload level caps the inference rate the same way
+            bool overBudget = !propagated && !tracked && !flowRepeat && infer &&
+                              (!g_overload.inferenceAllowed(cameraConfig.last_infer_time, frameTime) ||
+                               !g_rate_allocator.acquire(cameraConfig.rate_slot, frameTime));
+            if (overBudget && cameraConfig.tracker.enabled()) {
+                tracked = true;
+            }
+            // A frame already stepped is shown again with the last result
+            const bool repeat = flowRepeat || (!newFrame && tracked);
+            bool inferred = false;
+            if (propagated) {
+                resultImg = frameCopy;
+                rawBoxCount = detections.size();
+                cameraConfig.cached_detections = detections;
+                cameraConfig.stepped_decode_seq = frameSeq;
+                cameraConfig.frames_propagated++;
+                gotResult = true;
+            } else if (tracked && !repeat) {
+                // Between inferences the tracks are extrapolated to the new frame
+                resultImg = frameCopy;
+                cameraConfig.tracker.predict(frameTime, detections);
+                rawBoxCount = detections.size();
+                cameraConfig.cached_detections = detections;
+                cameraConfig.stepped_decode_seq = frameSeq;
+                cameraConfig.frames_tracked++;
+                gotResult = true;
+            } else if (infer && !overBudget && !repeat) {
+                cameraConfig.inferred_decode_seq = frameSeq;
+                cameraConfig.stepped_decode_seq = frameSeq;
+                cameraConfig.last_infer_time = frameTime;
+                int currentFrameId = cameraConfig.frame_id++;
+                const bool tiled = !cameraConfig.tile_scheduler.tiles().empty() &&
+                                   overloadLevel < OverloadController::kLightInference;
+                std::vector<cv::Rect> tiles;
+                if (tiled) {
+                    tiles = cameraConfig.tile_scheduler.select(currentFrameId);
+                    std::vector<cv::Rect> frameTiles;
+                    for (const auto& tile : tiles) {
+                        frameTiles.push_back(scaleRect(tile, sx, sy));
+                    }
+                    cameraConfig.yolov8_pool->submitTiledTask(frameCopy, currentFrameId, frameTiles,
+                                                              scaleRect(cameraConfig.active_region, sx, sy));
+                } else {
+                    cameraConfig.yolov8_pool->submitTask(frameCopy, currentFrameId, scaleRect(cameraConfig.active_region, sx, sy));
+                }
+
+                if (cameraConfig.yolov8_pool->getTargetImgResultWithDetections(
+                    resultImg, currentFrameId, rawBoxCount, detections) == NN_SUCCESS) {
+                    for (auto& det : detections) {
+                        det.box = scaleRect(det.box, 1.0 / sx, 1.0 / sy);
+                    }
+                    // Cascade: rerun the frame through the larger model (whole region, no tiles) and merge;
+                    // skipped from the light-inference overload level on
+                    if (cameraConfig.cascade_pool && overloadLevel < OverloadController::kLightInference &&
+                        cameraConfig.cascade.shouldEscalate(detections, frameTime)) {
+                        cv::Mat largeImg;
+                        int largeCount = 0;
+                        std::vector<Detection> large;
+                        // frameCopy is shared with the small model's result image and must still be undrawn
+                        assert(!cameraConfig.yolov8_pool->drawDetections());
+                        cameraConfig.cascade_pool->submitTask(frameCopy, currentFrameId, scaleRect(cameraConfig.active_region, sx, sy));
+                        if (cameraConfig.cascade_pool->getTargetImgResultWithDetections(
+                            largeImg, currentFrameId, largeCount, large) == NN_SUCCESS) {
+                            for (auto& det : large) {
+                                det.box = scaleRect(det.box, 1.0 / sx, 1.0 / sy);
+                            }
+                            cameraConfig.cascade.merge(detections, large);
+                            detections.swap(large);
+                            resultImg = largeImg;
+                            rawBoxCount = detections.size();
+                        }
+                    }
+                    if (tiled) {
+                        cameraConfig.tile_scheduler.update(tiles, detections);
+                    }
+                    if (cameraConfig.tracker.enabled()) {
+                        cameraConfig.tracker.update(detections, frameTime);
+                    }
+                    cameraConfig.motion_gate.accept(thumbCopy, frameTime);
+                    if (cameraConfig.flow.enabled()) {
+                        cameraConfig.flow.reset(flowGray, detections);
+                    }
+                    cameraConfig.cached_detections = detections;
+                    cameraConfig.frames_inferred++;
+                    inferred = true;
+                    gotResult = true;
+                }
+            } else {
+                // Nothing moved since the last inference, over budget, or the same frame again: reuse the last detections
+                resultImg = frameCopy;
+                detections = cameraConfig.cached_detections;
+                rawBoxCount = detections.size();
+                cameraConfig.frames_skipped++;
+                gotResult = true;
+            }
+
+            if (gotResult) {
+                // Counting always runs; under overload the display is throttled and then left undrawn
+                const bool display = g_overload.displayDue(cameraConfig.last_display, frameTime);
+                const bool draw = overloadLevel < OverloadController::kNoOverlay;
+
+                // Dual-stream: show the main-stream frame captured at the same time as the inferred one
+                if (display && cameraConfig.main_stream && cameraConfig.options.display == "main") {
+                    cameraConfig.main_stream->demand();
+                    cv::Mat mainImg;
+                    if (cameraConfig.main_stream->grab(frameStamp, mainImg)) {
+                        resultImg = mainImg;
+                    }
+                }
+                const double dx = (double)resultImg.cols / cameraConfig.frame_size.width;
+                const double dy = (double)resultImg.rows / cameraConfig.frame_size.height;
+
+                // Filter detection boxes; with the detection log on, every box is kept with its mask flag
                 int filteredBoxCount = 0;
+                thread_local LogFrame logFrame;
+                const bool logBoxes = cameraConfig.log_slot >= 0;
+                logFrame.boxes.clear();
                 {
                     std::lock_guard<std::mutex> mask_lock(cameraConfig.mask_mutex);
+                    const int maskWidth = cameraConfig.frame_size.width;
+                    const int maskHeight = cameraConfig.frame_size.height;
                     for (const auto& det : detections) {
                         cv::Rect safeBox = det.box;
-                        safeBox.x = std::max(0, std::min(safeBox.x, resultImg.cols - 1));
-                        safeBox.y = std::max(0, std::min(safeBox.y, resultImg.rows - 1));
-                        safeBox.width = std::min(safeBox.width, resultImg.cols - safeBox.x);
-                        safeBox.height = std::min(safeBox.height, resultImg.rows - safeBox.y);
+                        safeBox.x = std::max(0, std::min(safeBox.x, maskWidth - 1));
+                        safeBox.y = std::max(0, std::min(safeBox.y, maskHeight - 1));
+                        safeBox.width = std::min(safeBox.width, maskWidth - safeBox.x);
+                        safeBox.height = std::min(safeBox.height, maskHeight - safeBox.y);
                         
                         if (safeBox.width <= 0 || safeBox.height <= 0) continue;
 
                         // da ying
                         // std::cerr << safeBox << std::endl;
 
-                        if (shouldExcludeBox(safeBox, cameraConfig.exclusion_mask)) {
-                            cv::rectangle(resultImg, safeBox, cv::Scalar(0, 0, 255), 2);
-                        } else {
-                            cv::rectangle(resultImg, safeBox, cv::Scalar(0, 255, 0), 2);
+                        bool excluded = shouldExcludeBox(safeBox, cameraConfig.exclusion_mask);
+                        if (!excluded) {
                             filteredBoxCount++;
                         }
+                        if (logBoxes) {
+                            LogBox box;
+                            box.x = (uint16_t)safeBox.x;
+                            box.y = (uint16_t)safeBox.y;
+                            box.w = (uint16_t)safeBox.width;
+                            box.h = (uint16_t)safeBox.height;
+                            box.score = (uint16_t)(std::min(1.0f, std::max(0.0f, det.confidence)) * 65535);
+                            box.track_id = det.track_id >= 0 ? (uint16_t)std::min(det.track_id, 0xFFFE) : 0xFFFF;
+                            box.class_id = (uint8_t)det.class_id;
+                            box.flags = excluded ? kLogBoxExcluded : 0;
+                            logFrame.boxes.push_back(box);
+                        }
+                        if (!draw) continue;
+
+                        cv::Rect drawBox = scaleRect(safeBox, dx, dy);
+                        cv::rectangle(resultImg, drawBox, excluded ? cv::Scalar(0, 0, 255) : cv::Scalar(0, 255, 0), 2);
+                        if (det.track_id >= 0) {
+                            cv::putText(resultImg, std::to_string(det.track_id), drawBox.tl() + cv::Point(2, 14),
+                                        cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(255, 255, 0), 1);
+                        }
                     }
                 }
 
                 // Display information
-                std::string infoText = cameraConfig.unique_id;
-                cv::putText(resultImg, infoText, cv::Point(10, 30), cv::FONT_HERSHEY_SIMPLEX, 
-                            0.7, cv::Scalar(0, 255, 0), 2);
-                
-                std::string countText = "Valid count: " + std::to_string(filteredBoxCount) + 
-                                       " (Raw: " + std::to_string(rawBoxCount) + ")";
-                cv::putText(resultImg, countText, cv::Point(10, 60), cv::FONT_HERSHEY_SIMPLEX, 
-                            0.7, cv::Scalar(0, 255, 0), 2);
+                if (draw) {
+                    std::string infoText = cameraConfig.unique_id;
+                    cv::putText(resultImg, infoText, cv::Point(10, 30), cv::FONT_HERSHEY_SIMPLEX, 
+                                0.7, cv::Scalar(0, 255, 0), 2);
+                    
+                    std::string countText = "Valid count: " + std::to_string(filteredBoxCount) + 
+                                           " (Raw: " + std::to_string(rawBoxCount) + ")";
+                    cv::putText(resultImg, countText, cv::Point(10, 60), cv::FONT_HERSHEY_SIMPLEX, 
+                                0.7, cv::Scalar(0, 255, 0), 2);
+                }
 
                 // Display results
-                {
+                if (display) {
                     std::lock_guard<std::mutex> gui_lock(g_gui_mutex);
                     cv::imshow(windowName, resultImg);
+                    cameraConfig.last_display = frameTime;
                 }
                 
-                // Save results to database
-                if (!SaveToDatabase(cameraConfig.db, cameraConfig.unique_id, filteredBoxCount)) {
-                    std::cerr << "Failed to save to database: " << cameraConfig.unique_id << std::endl;
+                if (inferred) {
+                    g_rate_allocator.report(cameraConfig.rate_slot, filteredBoxCount, frameTime);
+                }
+
+                if (logBoxes) {
+                    logFrame.time_ms = DetectionWriter::nowMs();
+                    logFrame.camera = cameraConfig.log_slot;
+                    logFrame.width = cameraConfig.frame_size.width;
+                    logFrame.height = cameraConfig.frame_size.height;
+                    g_detection_log.push(cameraConfig.log_slot, logFrame);
+                }
+
+                // Sliding-window statistics of the count; the serial port and the database each take the configured one
+                cameraConfig.count_smoother.add(filteredBoxCount, frameTime);
+                const int serialCount = cameraConfig.count_smoother.value(
+                    (CountSmoother::Statistic)g_serial_statistic.load(std::memory_order_relaxed));
+                const int dbCount = cameraConfig.count_smoother.value(
+                    (CountSmoother::Statistic)g_db_statistic.load(std::memory_order_relaxed));
+
+                // Every processed frame feeds the count aggregator (serial max, metrics), lock-free
+                g_count_aggregator.report(cameraConfig.count_slot, serialCount, DetectionWriter::nowMs());
+
+                // Save results to database; under overload one row per second carries that second's highest count
+                bool writeRow = true;
+                int rowCount = dbCount;
+                if (overloadLevel >= OverloadController::kDbDetail) {
+                    cameraConfig.db_pending_max = std::max(cameraConfig.db_pending_max, dbCount);
+                    writeRow = frameTime - cameraConfig.last_db_row >= std::chrono::seconds(1);
+                    if (writeRow) {
+                        rowCount = cameraConfig.db_pending_max;
+                        cameraConfig.db_pending_max = 0;
+                        cameraConfig.last_db_row = frameTime;
+                    }
+                } else {
+                    cameraConfig.db_pending_max = 0;
+                }
+                if (writeRow) {
+                    SaveToDatabase(cameraConfig.db_slot, rowCount);
+                }
+
+                // Frame age from decode to here, and the inference backlog, drive the overload ladder.
+                // A frame reused while decode is idle (key frames only) is not reported again
+                if (decodeTime != cameraConfig.last_reported_frame) {
+                    g_overload.report(std::chrono::duration<double, std::milli>(
+                                          std::chrono::steady_clock::now() - decodeTime).count(),
+                                      cameraConfig.yolov8_pool->pendingTasks());
+                    cameraConfig.last_reported_frame = decodeTime;
+                }
+
+                // Evidence snapshot when the count reaches the configured level, at most every 10 seconds
+                if (cameraConfig.options.evidence > 0 && filteredBoxCount >= cameraConfig.options.evidence &&
+                    overloadLevel < OverloadController::kDbDetail &&
+                    std::chrono::duration<double>(frameTime - cameraConfig.last_evidence).count() >= 10) {
+                    cv::Mat evidenceImg = resultImg;
+                    bool ready = true;
+                    if (cameraConfig.main_stream && evidenceImg.size() != cameraConfig.frame_size) {
+                        // Full-resolution snapshot from the main stream; retried on the next frames while it opens
+                        cameraConfig.main_stream->demand();
+                        ready = cameraConfig.main_stream->grab(frameStamp, evidenceImg);
+                        for (const auto& det : detections) {
+                            if (ready) cv::rectangle(evidenceImg, det.box, cv::Scalar(0, 255, 0), 2);
+                        }
+                    }
+                    if (ready) {
+                        mkdir("evidence", 0755);
+                        std::string path = "evidence/" + cameraConfig.unique_id + "_" + GetCurrentTimestamp() + ".jpg";
+                        cv::imwrite(path, evidenceImg);
+                        cameraConfig.last_evidence = frameTime;
+                    }
                 }
             }
         }
 
+        // Long GOP while idle: ask the camera for a key frame so the minimum refresh rate holds
+        if (cameraConfig.stream_activity.idle()) {
+            auto now = std::chrono::steady_clock::now();
+            double refresh = cameraConfig.stream_activity.params().refresh_seconds;
+            if (cameraConfig.stream_activity.secondsSinceKeyFrame(now) >= refresh &&
+                std::chrono::duration<double>(now - cameraConfig.last_key_request).count() >= refresh) {
+                if (useSubStream) {
+                    NET_DVR_MakeKeyFrameSub(cameraConfig.userID, cameraConfig.channel);
+                } else {
+                    NET_DVR_MakeKeyFrame(cameraConfig.userID, cameraConfig.channel);
+                }
+                cameraConfig.last_key_request = now;
+            }
+        }
+
+        // Close the main stream again once nothing has asked for it for a while
+        if (cameraConfig.main_stream) {
+            cameraConfig.main_stream->closeIfUnused(30);
+        }
+
         // Performance statistics
         if (cameraConfig.frame_counter++ % 30 == 0) {
             auto now = std::chrono::steady_clock::now();
@@ -471,7 +1164,60 @@ void ProcessCameraStream(CameraConfig& cameraConfig) {
             if (elapsed > 0) {
                 cameraConfig.fps = 30 / elapsed;
                 cameraConfig.last_stat_time = now;
-                std::cout << "Camera " << cameraConfig.unique_id << " FPS: " << cameraConfig.fps << std::endl;
+                std::cout << "Camera " << cameraConfig.unique_id << " FPS: " << cameraConfig.fps;
+                if (cameraConfig.motion_gate.enabled()) {
+                    std::cout << " frames skipped: " << cameraConfig.frames_skipped << "/"
+                              << (cameraConfig.frames_skipped + cameraConfig.frames_inferred);
+                    cameraConfig.frames_skipped = 0;
+                    cameraConfig.frames_inferred = 0;
+                }
+                if (cameraConfig.tracker.enabled()) {
+                    std::cout << " tracked frames: " << cameraConfig.frames_tracked
+                              << " interval: " << cameraConfig.tracker.interval()
+                              << " tracks: " << cameraConfig.tracker.activeTracks();
+                    cameraConfig.frames_tracked = 0;
+                }
+                if (cameraConfig.cascade.enabled()) {
+                    ModelCascade::Stats cascadeStats = cameraConfig.cascade.takeStats();
+                    std::cout << " cascade: " << cascadeStats.escalated << "/" << cascadeStats.frames
+                              << " (density " << cascadeStats.density << ", low conf " << cascadeStats.low_conf
+                              << ", count jump " << cascadeStats.disagree << ", held " << cascadeStats.held << ")";
+                }
+                if (g_overload.level() > OverloadController::kNormal) {
+                    std::cout << " overload: " << OverloadController::levelName(g_overload.level());
+                }
+                if (g_rate_allocator.enabled()) {
+                    std::cout << " infer rate: " << std::fixed << std::setprecision(1)
+                              << g_rate_allocator.rate(cameraConfig.rate_slot) << "/s" << std::defaultfloat;
+                }
+                if (cameraConfig.flow.enabled()) {
+                    std::cout << " propagated frames: " << cameraConfig.frames_propagated;
+                    cameraConfig.frames_propagated = 0;
+                }
+                int converted = 0, dropped = 0;
+                cameraConfig.decode_rate.takeStats(converted, dropped);
+                std::cout << " decode " << decodePolicyToString(cameraConfig.decode_rate.policy())
+                          << " kept: " << converted << "/" << (converted + dropped);
+#ifdef ENABLE_FFMPEG_DECODE
+                if (cameraConfig.sw_decoder) {
+                    SwDecoder::Stats decodeStats = cameraConfig.sw_decoder->takeStats();
+                    std::cout << " sw decode " << decodeStats.frames << " frames, "
+                              << std::fixed << std::setprecision(1) << decodeStats.avg_decode_ms << "/"
+                              << decodeStats.max_decode_ms << " ms avg/max" << std::defaultfloat;
+                    if (decodeStats.dropped_bytes > 0) {
+                        std::cout << " dropped " << decodeStats.dropped_bytes << " bytes";
+                    }
+                }
+#endif
+                if (cameraConfig.stream_activity.enabled()) {
+                    std::cout << " stream " << (cameraConfig.stream_activity.idle() ? "idle" : "active")
+                              << " (activity " << cameraConfig.stream_activity.activity() << ")";
+                }
+                if (!cameraConfig.tile_scheduler.tiles().empty()) {
+                    std::cout << " idle tiles: " << cameraConfig.tile_scheduler.idleCount() << "/"
+                              << cameraConfig.tile_scheduler.tiles().size();
+                }
+                std::cout << std::endl;
             }
         }
 
@@ -495,6 +1241,9 @@ void ProcessCameraStream(CameraConfig& cameraConfig) {
     }
 
     // Cleanup resources
+    if (cameraConfig.main_stream) {
+        cameraConfig.main_stream->close();
+    }
     {
         std::lock_guard<std::mutex> lock(g_hik_mutex);
         if (cameraConfig.realPlayHandle >= 0) {
@@ -504,6 +1253,11 @@ void ProcessCameraStream(CameraConfig& cameraConfig) {
             NET_DVR_Logout(cameraConfig.userID);
         }
     }
+#ifdef ENABLE_FFMPEG_DECODE
+    if (cameraConfig.sw_decoder) {
+        cameraConfig.sw_decoder->close();
+    }
+#endif
     
     {
         std::lock_guard<std::mutex> gui_lock(g_gui_mutex);
@@ -518,6 +1272,7 @@ int main(int argc, char** argv) {
     // Register signal handlers
     std::signal(SIGINT, signal_handler);
     std::signal(SIGTERM, signal_handler);
+    std::signal(SIGHUP, reload_handler);
     
     // Set DISPLAY environment variable
     setenv("DISPLAY", ":0", 1);
@@ -539,7 +1294,9 @@ int main(int argc, char** argv) {
         g_num_threads_per_camera = std::max(1, static_cast<int>(num_threads/4));
     }
 
-    // Initialize serial communication - call directly without checking return value
+    // Initialize serial communication - call directly without checking return value.
+    // The serial thread reads the current maximum from g_count_aggregator snapshots
+    set_count_aggregator(&g_count_aggregator);
     init_serial_comm("/dev/ttyS9");
 
     // Initialize Hikvision SDK
@@ -557,6 +1314,72 @@ int main(int argc, char** argv) {
         return -1;
     }
 
+    // Global options: split the inference budget across cameras by crowd density
+    GlobalOptions global = parseGlobalOptions(configFile);
+    ApplyGlobalOptions(global, cameras);
+
+    // Detection rows: batched transactions on a writer thread, camera threads only enqueue
+    DetectionWriter::Params writer_params;
+    writer_params.batch_rows = global.db_batch_rows;
+    writer_params.batch_ms = global.db_batch_ms;
+    writer_params.queue_size = global.db_queue;
+    writer_params.raw_retention_hours = global.db_retention_hours;
+    writer_params.change_only = global.db_change_only;
+    writer_params.skip_zero = true;
+    writer_params.heartbeat_ms = global.db_heartbeat_s * 1000;
+    writer_params.series = global.db_series;
+    writer_params.series_resolution_ms = global.db_series_resolution_ms;
+    writer_params.series_retention_hours = global.db_series_retention_hours;
+    writer_params.hot_hours = global.db_hot_hours;
+    writer_params.flush_ms = global.db_flush_s * 1000;
+    for (int level = 0; level < kRollupLevels; level++) {
+        writer_params.retention_hours[level] = std::max(0, (int)global.db_rollup_retention_hours[level]);
+    }
+    // Shards: one database per camera (db_shards=camera) or per group of cameras, each with its own writer
+    std::vector<std::string> shard_names;
+    if (global.db_shards == 0) {
+        for (const auto& camera : cameras) {
+            shard_names.push_back(camera.unique_id);
+        }
+    } else if (global.db_shards > 1) {
+        int groups = std::min<int>(global.db_shards, cameras.size());
+        for (int i = 0; i < groups; i++) {
+            shard_names.push_back("g" + std::to_string(i));
+        }
+    }
+    if (!g_detection_writer.start(writer_params, shard_names)) {
+        std::cerr << "Failed to start the detection writer: " << writer_params.db_path << std::endl;
+        NET_DVR_Cleanup();
+        return -1;
+    }
+    for (size_t i = 0; i < cameras.size(); i++) {
+        cameras[i].db_slot = g_detection_writer.addDevice(cameras[i].unique_id, (int)i);
+    }
+
+    // Count aggregation windows and camera groups
+    g_count_aggregator.configure(global.count_windows);
+    for (auto& camera : cameras) {
+        camera.count_slot = g_count_aggregator.addCamera(camera.unique_id, camera.options.group);
+    }
+    for (const auto& path : g_detection_writer.paths()) {
+        std::cout << "Detection database: " << path << std::endl;
+    }
+
+    // Per-frame box log for offline analysis
+    if (!global.detection_log.empty()) {
+        DetectionLog::Params log_params;
+        log_params.dir = global.detection_log;
+        log_params.retention_hours = global.detection_log_hours;
+        if (g_detection_log.start(log_params)) {
+            for (auto& camera : cameras) {
+                camera.log_slot = g_detection_log.addCamera(camera.unique_id);
+            }
+            std::cout << "Detection log: " << log_params.dir << std::endl;
+        } else {
+            std::cerr << "Failed to start the detection log in " << log_params.dir << std::endl;
+        }
+    }
+
     std::cout << "Starting " << cameras.size() << " camera streams..." << std::endl;
 
     // Start camera threads
@@ -565,14 +1388,89 @@ int main(int argc, char** argv) {
         threads.emplace_back(ProcessCameraStream, std::ref(camera));
     }
 
-    // Main loop to update max count
+    // Main loop: closes one count aggregation second per iteration
+    auto lastMetrics = std::chrono::steady_clock::now();
+    auto lastDbStats = lastMetrics;
     while (g_running) {
         std::this_thread::sleep_for(std::chrono::seconds(1));
-        uint16_t current_max = g_max_box_count.load();
-        if (current_max > 0) {
-            send_people_count(current_max);
-            g_max_box_count.store(0);
+
+        // Overload ladder: one step per evaluation, degrading in order and recovering in reverse
+        if (g_overload.evaluate(std::chrono::steady_clock::now())) {
+            OverloadController::Metrics m = g_overload.metrics();
+            std::cout << "Overload level " << m.level << " (" << OverloadController::levelName(m.level)
+                      << "), frame age " << std::fixed << std::setprecision(0) << m.mean_age_ms << "/"
+                      << m.max_age_ms << " ms avg/max" << std::defaultfloat
+                      << ", inference queue " << m.max_queue << std::endl;
+        }
+
+        // Inference budget allocation metrics
+        if (g_rate_allocator.enabled() &&
+            std::chrono::steady_clock::now() - lastMetrics >= std::chrono::seconds(10)) {
+            lastMetrics = std::chrono::steady_clock::now();
+            std::cout << "Inference budget " << g_rate_allocator.params().budget << "/s:";
+            for (const auto& m : g_rate_allocator.takeMetrics()) {
+                std::cout << " [" << m.id << " rate " << std::fixed << std::setprecision(1) << m.rate
+                          << "/s mean " << m.mean << " sd " << m.stddev << std::defaultfloat
+                          << " granted " << m.granted << " denied " << m.denied << "]";
+            }
+            std::cout << std::endl;
+        }
+
+        // Detection writer throughput, and rows dropped because the queue was full
+        if (std::chrono::steady_clock::now() - lastDbStats >= std::chrono::seconds(60)) {
+            lastDbStats = std::chrono::steady_clock::now();
+            DetectionWriter::Stats dbStats = g_detection_writer.takeStats();
+            std::cout << "Detection writer: " << dbStats.rows << " rows in " << dbStats.transactions
+                      << " transactions, commit " << std::fixed << std::setprecision(1) << dbStats.avg_commit_ms
+                      << "/" << dbStats.max_commit_ms << " ms avg/max" << std::defaultfloat;
+            if (dbStats.dropped > 0) {
+                std::cout << ", dropped " << dbStats.dropped << " rows (queue full)";
+            }
+            if (global.db_change_only) {
+                std::cout << ", " << dbStats.span_writes << " span writes";
+            }
+            if (dbStats.deleted > 0) {
+                std::cout << ", deleted " << dbStats.deleted << " expired rows";
+            }
+            std::cout << std::endl;
+
+            // People counts per camera group over the longest aggregation window
+            auto counts = g_count_aggregator.snapshot();
+            if (!counts->windows.empty()) {
+                size_t w = counts->windows.size() - 1;
+                std::cout << "Counts (" << counts->windows[w] << " s):";
+                for (size_t g = 0; g < counts->groups.size(); g++) {
+                    const CountAggregator::Stats& stats = counts->group[w][g];
+                    std::cout << " [" << counts->groups[g] << " max " << stats.max << " mean " << std::fixed
+                              << std::setprecision(1) << stats.mean() << std::defaultfloat << "]";
+                }
+                std::cout << std::endl;
+            }
+            if (g_detection_log.running()) {
+                DetectionLog::Stats logStats = g_detection_log.takeStats();
+                std::cout << "Detection log: " << logStats.frames << " frames, " << logStats.bytes / 1024 << " KB";
+                if (logStats.dropped > 0) {
+                    std::cout << ", dropped " << logStats.dropped << " frames (ring full)";
+                }
+                std::cout << std::endl;
+            }
+        }
+
+        // Apply decode policies changed in the config file (kill -HUP <pid>)
+        if (g_reload_config.exchange(false)) {
+            ApplyGlobalOptions(parseGlobalOptions(configFile), cameras);
+            auto configs = parseCameraConfig(configFile);
+            for (size_t i = 0; i < cameras.size() && i < configs.size(); i++) {
+                if (configs[i].ip != cameras[i].ip || configs[i].channel != cameras[i].channel) continue;
+                DecodePolicy policy;
+                if (parseDecodePolicy(configs[i].options.decode, policy)) {
+                    cameras[i].decode_rate.setPolicy(policy);
+                    std::cout << "Camera " << cameras[i].unique_id << " decode policy: "
+                              << decodePolicyToString(policy) << std::endl;
+                }
+            }
         }
+        g_count_aggregator.close(DetectionWriter::nowMs());
     }
 
     // Wait for threads to finish
@@ -580,11 +1478,9 @@ int main(int argc, char** argv) {
         if (t.joinable()) t.join();
     }
 
-    // Cleanup database connections
-    for (auto& [name, db] : db_pool) {
-        sqlite3_close(db);
-    }
-    db_pool.clear();
+    // Write out the queued detection rows
+    g_detection_writer.stop();
+    g_detection_log.stop();
 
     // Cleanup SDK
     NET_DVR_Cleanup();
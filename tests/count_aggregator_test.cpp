@@ -0,0 +1,139 @@
+// 人数汇总：逐秒上报随机人数（有的秒某些摄像头没有帧），每次结束秒窗口后，各时间窗口的摄像头、分组和全部摄像头的
+// 最大值、总和、帧数、均值都要与按原始上报逐帧重新统计的结果一致；停止上报后各窗口按秒数依次清空；
+// 当前最大人数取最后一个秒窗口与还没结束的秒窗口中较大的一个
+
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "task/count_aggregator.h"
+
+static int failures = 0;
+
+static void expect(bool ok, const char *what) {
+    if (!ok) {
+        std::fprintf(stderr, "FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+struct Report {
+    int second;
+    int camera;
+    int count;
+    int64_t time_ms;
+    bool first;  // 这一秒该摄像头第一次出现这个人数，计数槽记下的是达到最大值的第一帧的时间
+};
+
+// 由原始上报统计最近 seconds 个秒窗口（second 在 (last - seconds, last] 内）中 camera 属于 cameras 的帧
+static CountAggregator::Stats bruteForce(const std::vector<Report> &reports, int last, int seconds,
+                                         const std::vector<int> &cameras) {
+    CountAggregator::Stats stats;
+    for (const Report &report : reports) {
+        if (report.second <= last - seconds || report.second > last) continue;
+        bool selected = false;
+        for (int camera : cameras) selected = selected || camera == report.camera;
+        if (!selected) continue;
+        stats.sum += report.count;
+        stats.frames++;
+        // 并列时取时间较新的，时间也相同时取编号小的摄像头（上报按摄像头编号的顺序）
+        if (stats.max_camera < 0 || report.count > stats.max ||
+            (report.count == stats.max && report.first && report.time_ms > stats.max_time_ms)) {
+            stats.max = report.count;
+            stats.max_camera = report.camera;
+            stats.max_time_ms = report.time_ms;
+        }
+    }
+    return stats;
+}
+
+static bool sameStats(const CountAggregator::Stats &a, const CountAggregator::Stats &b) {
+    return a.max == b.max && a.sum == b.sum && a.frames == b.frames && a.max_camera == b.max_camera &&
+           (a.max_camera < 0 || a.max_time_ms == b.max_time_ms) && a.mean() == b.mean();
+}
+
+int main() {
+    const std::vector<int> windows = {1, 3, 5};
+    CountAggregator aggregator;
+    aggregator.configure(windows);
+    const char *groups[] = {"door", "door", "hall", ""};
+    const int cameras = 4;
+    for (int i = 0; i < cameras; i++) {
+        expect(aggregator.addCamera("cam" + std::to_string(i), groups[i]) == i, "camera ids in order");
+    }
+    const std::vector<std::vector<int>> group_cameras = {{0, 1}, {2}, {3}};  // door、hall、all
+
+    auto empty = aggregator.snapshot();
+    expect(empty->groups.size() == 3 && empty->groups[2] == "all", "empty group name becomes all");
+    expect(aggregator.peak().camera == -1, "no peak before any report");
+
+    std::mt19937 rng(5);
+    std::vector<Report> reports;
+    const int kSeconds = 40;
+    const int kSilent = 6;  // 最后几秒不上报，各窗口依次清空
+    for (int second = 0; second < kSeconds + kSilent; second++) {
+        if (second < kSeconds) {
+            for (int camera = 0; camera < cameras; camera++) {
+                if (rng() % 4 == 0) continue;  // 这一秒没有帧
+                const int frames = 1 + (int)(rng() % 25);
+                bool seen[8] = {};
+                for (int f = 0; f < frames; f++) {
+                    // 人数取值少，最大值经常并列
+                    const int count = (int)(rng() % 8);
+                    Report report{second, camera, count, (int64_t)second * 1000 + f * 40, !seen[count]};
+                    seen[count] = true;
+                    aggregator.report(camera, report.count, report.time_ms);
+                    reports.push_back(report);
+                }
+            }
+        }
+        aggregator.close((int64_t)(second + 1) * 1000);
+
+        auto snapshot = aggregator.snapshot();
+        bool ok = snapshot->time_ms == (int64_t)(second + 1) * 1000 && snapshot->windows == windows;
+        for (size_t w = 0; w < windows.size(); w++) {
+            std::vector<int> all;
+            for (int camera = 0; camera < cameras; camera++) {
+                ok = ok && sameStats(snapshot->camera[w][camera], bruteForce(reports, second, windows[w], {camera}));
+                all.push_back(camera);
+            }
+            for (size_t g = 0; g < group_cameras.size(); g++) {
+                ok = ok && sameStats(snapshot->group[w][g], bruteForce(reports, second, windows[w], group_cameras[g]));
+            }
+            ok = ok && sameStats(snapshot->total[w], bruteForce(reports, second, windows[w], all));
+            if (w == 0) ok = ok && sameStats(snapshot->last_second, snapshot->total[0]);
+        }
+        if (!ok) {
+            std::fprintf(stderr, "FAIL: snapshot after second %d differs from the reports\n", second);
+            failures++;
+        }
+
+        // 停止上报后，秒数为 n 的窗口在第 n 次结束后清空
+        if (second >= kSeconds) {
+            const int idle = second - kSeconds + 1;
+            for (size_t w = 0; w < windows.size(); w++) {
+                const bool cleared = snapshot->total[w].frames == 0 && snapshot->total[w].max_camera == -1;
+                if (cleared != (idle >= windows[w])) {
+                    std::fprintf(stderr, "FAIL: %d s window after %d idle seconds\n", windows[w], idle);
+                    failures++;
+                }
+            }
+        }
+    }
+
+    // 当前最大人数：还没结束的秒窗口更大时取计数槽，否则取最后一个秒窗口
+    aggregator.report(1, 9, 100000);
+    aggregator.close(101000);
+    aggregator.report(2, 4, 101500);
+    CountAggregator::Peak peak = aggregator.peak();
+    expect(peak.count == 9 && peak.camera == 1 && peak.camera_name == "cam1" && peak.time_ms == 100000,
+           "peak from the last closed second");
+    aggregator.report(3, 12, 101600);
+    peak = aggregator.peak();
+    expect(peak.count == 12 && peak.camera == 3 && peak.camera_name == "cam3" && peak.time_ms == 101600,
+           "peak from the open second");
+
+    if (failures == 0) std::printf("count_aggregator_test: ok\n");
+    return failures == 0 ? 0 : 1;
+}
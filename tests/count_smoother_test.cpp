@@ -0,0 +1,104 @@
+// 人数平滑：随机间隔（含相同时间）、取值很少（中位数两半之间大量重复的值）的人数序列，每加入一帧后
+// 滑动最大值、中位数、均值都要与直接对窗口内的帧排序、求和的结果一致；长时间没有帧后窗口只剩当前帧
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "task/count_smoother.h"
+
+static int failures = 0;
+
+static void expect(bool ok, const char *what) {
+    if (!ok) {
+        std::fprintf(stderr, "FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+using Clock = std::chrono::steady_clock;
+
+struct Frame {
+    int64_t time_ms;
+    int count;
+};
+
+// 窗口内的帧：时间不早于 now - window_ms，至少有当前帧
+static bool matchesWindow(const CountSmoother &smoother, const std::vector<Frame> &frames, int64_t window_ms) {
+    const int64_t now = frames.back().time_ms;
+    std::vector<int> counts;
+    for (const Frame &frame : frames) {
+        if (frame.time_ms >= now - window_ms) counts.push_back(frame.count);
+    }
+    if (counts.empty()) counts.push_back(frames.back().count);
+    std::sort(counts.begin(), counts.end());
+    const size_t n = counts.size();
+    const double median = n % 2 ? counts[n / 2] : (counts[n / 2 - 1] + counts[n / 2]) / 2.0;
+    int64_t sum = 0;
+    for (int count : counts) sum += count;
+    return smoother.size() == n && smoother.max() == counts.back() && smoother.median() == median &&
+           smoother.mean() == (double)sum / n && smoother.last() == frames.back().count &&
+           smoother.value(CountSmoother::kMedian) == (int)std::lround(median) &&
+           smoother.value(CountSmoother::kRaw) == frames.back().count;
+}
+
+int main() {
+    const int64_t window_ms = 500;
+    CountSmoother::Params params;
+    params.window_seconds = window_ms / 1000.0;
+    CountSmoother smoother;
+    smoother.configure(params);
+    expect(smoother.size() == 0 && smoother.value(CountSmoother::kMax) == 0 && smoother.median() == 0,
+           "empty window is 0");
+
+    const Clock::time_point start = Clock::now();
+    std::mt19937 rng(3);
+    std::vector<Frame> frames;
+    int64_t time_ms = 0;
+    int mismatches = 0;
+    for (int i = 0; i < 20000; i++) {
+        switch (rng() % 10) {
+        case 0: time_ms += 0; break;                  // 同一时间的两帧
+        case 1: time_ms += window_ms * 3; break;      // 断流，窗口只剩当前帧
+        default: time_ms += 20 + rng() % 60; break;
+        }
+        // 人数在几个值之间变化，偶尔跳高
+        const int count = rng() % 50 == 0 ? 30 + (int)(rng() % 5) : (int)(rng() % 4);
+        frames.push_back({time_ms, count});
+        smoother.add(count, start + std::chrono::milliseconds(time_ms));
+        if (!matchesWindow(smoother, frames, window_ms) && mismatches++ < 5) {
+            std::fprintf(stderr, "FAIL: frame %d at %lld ms: size %zu max %d median %.1f mean %.3f\n", i,
+                         (long long)time_ms, smoother.size(), smoother.max(), smoother.median(), smoother.mean());
+        }
+    }
+    failures += mismatches;
+
+    // 重复值的中位数
+    smoother.reset();
+    const int counts[] = {3, 3, 3, 1, 5, 5};
+    const double medians[] = {3, 3, 3, 3, 3, 3};
+    for (int i = 0; i < 6; i++) {
+        smoother.add(counts[i], start);
+        if (smoother.median() != medians[i]) {
+            std::fprintf(stderr, "FAIL: median after %d frames is %.1f\n", i + 1, smoother.median());
+            failures++;
+        }
+    }
+    smoother.reset();
+    for (int count : {2, 2, 5, 5}) smoother.add(count, start);
+    expect(smoother.median() == 3.5 && smoother.value(CountSmoother::kMedian) == 4, "even window median rounds");
+
+    CountSmoother::Statistic statistic;
+    for (CountSmoother::Statistic s : {CountSmoother::kRaw, CountSmoother::kMax, CountSmoother::kMedian,
+                                       CountSmoother::kMean}) {
+        expect(CountSmoother::parseStatistic(CountSmoother::statisticName(s), statistic) && statistic == s,
+               "statistic name round trip");
+    }
+    expect(!CountSmoother::parseStatistic("p95", statistic), "unknown statistic rejected");
+
+    if (failures == 0) std::printf("count_smoother_test: ok\n");
+    return failures == 0 ? 0 : 1;
+}
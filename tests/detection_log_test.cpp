@@ -0,0 +1,180 @@
+// 检测框日志：第一次在子进程中写入后不调用 stop 直接退出（模拟断电/崩溃，段文件停在映射大小、尾部为 0），
+// 重新启动后同一小时的段要接在已有记录之后继续写；读取时所有帧、框和摄像头名都在，
+// 按时间范围（跨小时的两段、用索引定位）取出的帧与写入的一致
+// 用法：detection_log_test [日志目录]，默认 /tmp/detection_log_test，目录中原有的段会被删除
+
+#include <dirent.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "storage/detection_log.h"
+
+static int failures = 0;
+
+static void expect(bool ok, const char *what) {
+    if (!ok) {
+        std::fprintf(stderr, "FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+struct Written {
+    int64_t time_ms;
+    int camera;
+    int boxes;
+};
+
+static const int kCameras = 3;
+static const int kFramesPerRun = 6000;
+static const int kFrameMs = 40;
+// 第二次写入跨过整点，日志分成两段
+static const int64_t t0 = logHourStart(1700000000000) + 55 * 60 * 1000;
+
+static void clearDir(const std::string &path) {
+    DIR *dir = opendir(path.c_str());
+    if (!dir) return;
+    while (dirent *entry = readdir(dir)) {
+        const std::string name = entry->d_name;
+        if (name != "." && name != "..") unlink((path + "/" + name).c_str());
+    }
+    closedir(dir);
+}
+
+static std::string cameraName(int camera) { return "cam" + std::to_string(camera); }
+
+// 第 i 帧的内容只由 i 决定，子进程和父进程得到相同的记录
+static Written frameAt(int i) {
+    std::mt19937 rng(i);
+    Written frame;
+    frame.camera = i % kCameras;
+    frame.time_ms = t0 + (int64_t)i * kFrameMs - (rng() % 3 == 0 ? rng() % 500 : 0);
+    frame.boxes = rng() % 30;
+    return frame;
+}
+
+static bool writeRun(const std::string &dir, int begin, int end, bool crash) {
+    DetectionLog::Params params;
+    params.dir = dir;
+    params.index_interval_ms = 1;  // 索引按写线程的时钟计时，测试写得快，取最小间隔才有足够的索引项
+    params.retention_hours = 0;
+    params.initial_segment_bytes = 64 << 10;  // 小的初始映射，写入中途扩大
+    DetectionLog log;
+    if (!log.start(params)) return false;
+    int cameras[kCameras];
+    for (int c = 0; c < kCameras; c++) cameras[c] = log.addCamera(cameraName(c));
+
+    for (int i = begin; i < end; i++) {
+        const Written written = frameAt(i);
+        LogFrame frame;
+        frame.time_ms = written.time_ms;
+        frame.camera = written.camera;
+        frame.width = 1920;
+        frame.height = 1080;
+        for (int k = 0; k < written.boxes; k++) {
+            LogBox box{};
+            box.x = (uint16_t)(i & 0xFFFF);
+            box.y = (uint16_t)k;
+            box.w = 10;
+            box.h = 20;
+            box.score = 60000;
+            box.track_id = 0xFFFF;
+            frame.boxes.push_back(box);
+        }
+        while (!log.push(cameras[written.camera], frame)) usleep(100);
+    }
+    if (crash) {
+        // 等写线程写完所有帧，不关闭段就退出
+        uint64_t frames = 0;
+        while (frames < (uint64_t)(end - begin)) {
+            usleep(1000);
+            frames += log.takeStats().frames;
+        }
+        _exit(0);
+    }
+    log.stop();
+    return true;
+}
+
+int main(int argc, char **argv) {
+    const std::string dir = argc > 1 ? argv[1] : "/tmp/detection_log_test";
+    clearDir(dir);
+
+    pid_t child = fork();
+    if (child == 0) {
+        writeRun(dir, 0, kFramesPerRun, true);
+        _exit(1);
+    }
+    int status = 0;
+    waitpid(child, &status, 0);
+    expect(WIFEXITED(status) && WEXITSTATUS(status) == 0, "crashed writer wrote its frames");
+    expect(writeRun(dir, kFramesPerRun, 2 * kFramesPerRun, false), "restart the log");
+
+    std::vector<Written> all;
+    for (int i = 0; i < 2 * kFramesPerRun; i++) all.push_back(frameAt(i));
+
+    DetectionLogReader reader;
+    expect(reader.open(dir), "open reader");
+
+    // 全部读出：每个摄像头的帧按写入顺序（不同摄像头之间可能交错），框的内容和摄像头名不变
+    std::vector<int> order[kCameras];
+    for (int i = 0; i < (int)all.size(); i++) order[all[i].camera].push_back(i);
+    size_t next[kCameras] = {};
+    size_t read = 0;
+    bool same = true;
+    reader.forEach(t0 - 60 * 60 * 1000, t0 + 2 * 60 * 60 * 1000, [&](const LogFrame &frame) {
+        if (frame.camera < 0 || frame.camera >= kCameras || next[frame.camera] >= order[frame.camera].size()) {
+            same = false;
+            return false;
+        }
+        const int i = order[frame.camera][next[frame.camera]++];
+        const Written &written = all[i];
+        bool ok = frame.time_ms == written.time_ms && (int)frame.boxes.size() == written.boxes &&
+                  frame.width == 1920 && frame.height == 1080 && frame.camera_name &&
+                  cameraName(written.camera) == frame.camera_name;
+        for (size_t k = 0; ok && k < frame.boxes.size(); k++) {
+            ok = frame.boxes[k].x == (uint16_t)(i & 0xFFFF) && frame.boxes[k].y == k;
+        }
+        same = same && ok;
+        read++;
+        return true;
+    });
+    expect(same && read == all.size(), "read back every frame after the crash reopen");
+
+    // 按时间范围读取，与写入的帧比较条数和框数
+    std::mt19937 rng(11);
+    const int64_t span = 2 * kFramesPerRun * kFrameMs;
+    for (int q = 0; q < 200; q++) {
+        const int64_t from = t0 - 1000 + (int64_t)(rng() % (span + 2000));
+        const int64_t to = from + (int64_t)(rng() % 60000);
+        long long frames = 0, boxes = 0, expect_frames = 0, expect_boxes = 0;
+        reader.forEach(from, to, [&](const LogFrame &frame) {
+            frames++;
+            boxes += frame.boxes.size();
+            return true;
+        });
+        for (const Written &written : all) {
+            if (written.time_ms >= from && written.time_ms < to) {
+                expect_frames++;
+                expect_boxes += written.boxes;
+            }
+        }
+        if (frames != expect_frames || boxes != expect_boxes) {
+            std::fprintf(stderr, "FAIL: range [%lld, %lld): %lld frames %lld boxes, expected %lld / %lld\n",
+                         (long long)from, (long long)to, frames, boxes, expect_frames, expect_boxes);
+            failures++;
+        }
+    }
+
+    // 回调返回 false 时停止
+    int seen = 0;
+    reader.forEach(t0, t0 + span, [&](const LogFrame &) { return ++seen < 10; });
+    expect(seen == 10, "forEach stops when the callback returns false");
+
+    if (failures == 0) std::printf("detection_log_test: ok\n");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,80 @@
+// change_only 模式：同一心跳周期内的 5、0、5 要写成三个区间，中间 0 人的一段不能并入前后的区间；
+// 汇总表的样本不随 change_only 变化（skip_zero 时两种模式都不计 0 人的记录）
+// 用法：detection_spans_test [数据库路径前缀]，默认在 /tmp 下新建
+
+#include <cstdio>
+#include <string>
+
+#include "storage/detection_history.h"
+#include "storage/detection_writer.h"
+
+static int failures = 0;
+
+static void expect(bool ok, const char *what) {
+    if (!ok) {
+        std::fprintf(stderr, "FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+static const int64_t t0 = 1700000000000;
+
+static bool writeCounts(const std::string &path, bool change_only) {
+    std::remove(path.c_str());
+    std::remove((path + "-wal").c_str());
+    std::remove((path + "-shm").c_str());
+
+    DetectionWriter::Params params;
+    params.db_path = path;
+    params.change_only = change_only;
+    params.heartbeat_ms = 60 * 1000;
+    params.skip_zero = true;
+    DetectionWriter writer;
+    if (!writer.start(params)) {
+        std::fprintf(stderr, "FAIL: cannot open %s\n", path.c_str());
+        return false;
+    }
+    const int device = writer.addDevice("cam");
+    writer.push(device, t0, 5);
+    writer.push(device, t0 + 1000, 0);
+    writer.push(device, t0 + 2000, 5);
+    writer.push(device, t0 + 3000, 5);
+    writer.stop();
+    return true;
+}
+
+int main(int argc, char **argv) {
+    const std::string prefix = argc > 1 ? argv[1] : "/tmp/detection_spans_test";
+    const std::string spans_path = prefix + "_spans.db";
+    const std::string rows_path = prefix + "_rows.db";
+    if (!writeCounts(spans_path, true) || !writeCounts(rows_path, false)) return 1;
+
+    DetectionHistory history;
+    expect(history.open(spans_path), "open history");
+    int value = -1;
+    expect(history.valueAt("cam", t0 + 500, value) && value == 5, "valueAt before the gap is 5");
+    expect(history.valueAt("cam", t0 + 1500, value) && value == 0, "valueAt inside the gap is 0");
+    expect(history.valueAt("cam", t0 + 2500, value) && value == 5, "valueAt after the gap is 5");
+
+    SpanAggregate spans;
+    expect(history.aggregateSpans("cam", t0, t0 + 3000, spans), "aggregateSpans");
+    expect(spans.duration_ms == 3000, "span duration is 3000 ms");
+    expect(spans.weighted_sum == 5 * 1000 + 5 * 1000, "weighted sum counts the gap as 0");
+    expect(spans.min == 0 && spans.max == 5, "min 0, max 5");
+
+    // 两种模式的汇总一致：三条 5 人的样本，0 人的记录不计
+    CountAggregate from_spans, from_rows;
+    expect(history.aggregate("cam", t0, t0 + 4000, from_spans), "aggregate change_only rollups");
+    history.close();
+    DetectionHistory rows;
+    expect(rows.open(rows_path), "open row-mode history");
+    expect(rows.aggregate("cam", t0, t0 + 4000, from_rows), "aggregate row-mode rollups");
+    rows.close();
+    expect(from_spans.samples == 3 && from_spans.sum == 15, "change_only rollups skip the zero record");
+    expect(from_rows.samples == from_spans.samples && from_rows.sum == from_spans.sum &&
+               from_rows.max == from_spans.max && from_rows.last == from_spans.last,
+           "rollups match between modes");
+
+    if (failures == 0) std::printf("detection_spans_test: ok\n");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,110 @@
+// 压缩序列编解码：各种形状的序列（长游程、抖动的间隔、大的时间跳变、大的人数变化）按块编码后逐个解码，
+// 样本与块的汇总（条数、和、最小/最大/最后值、首尾时间）都要与原序列一致；块写满时换新块
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "storage/series_codec.h"
+
+static int failures = 0;
+
+static void expect(bool ok, const char *what) {
+    if (!ok) {
+        std::fprintf(stderr, "FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+struct Sample {
+    int64_t tick;
+    int value;
+};
+
+// 编码成若干块，再解码拼起来与原序列比较
+static void roundTrip(const std::vector<Sample> &input, size_t block_bytes, const char *name) {
+    std::vector<Sample> output;
+    SeriesEncoder encoder(block_bytes);
+    size_t begin = 0;  // 当前块的第一个样本
+    int blocks = 0;
+    auto closeBlock = [&](size_t end) {
+        std::vector<uint8_t> data = encoder.finish();
+        int64_t sum = 0;
+        int min = input[begin].value, max = input[begin].value;
+        for (size_t i = begin; i < end; i++) {
+            sum += input[i].value;
+            min = std::min(min, input[i].value);
+            max = std::max(max, input[i].value);
+        }
+        expect(encoder.samples() == (int64_t)(end - begin), "block sample count");
+        expect(encoder.sum() == sum && encoder.min() == min && encoder.max() == max, "block sum/min/max");
+        expect(encoder.last() == input[end - 1].value, "block last value");
+        expect(encoder.firstTick() == input[begin].tick && encoder.lastTick() == input[end - 1].tick, "block ticks");
+        expect(data.size() <= block_bytes, "block within size");
+
+        SeriesDecoder decoder(data.data(), data.size(), encoder.firstTick(), encoder.samples());
+        Sample sample;
+        while (decoder.next(sample.tick, sample.value)) {
+            output.push_back(sample);
+        }
+        blocks++;
+    };
+    for (size_t i = 0; i < input.size(); i++) {
+        if (!encoder.append(input[i].tick, input[i].value)) {
+            closeBlock(i);
+            encoder.reset();
+            begin = i;
+            expect(encoder.append(input[i].tick, input[i].value), "append to a new block");
+        }
+    }
+    if (!encoder.empty()) closeBlock(input.size());
+
+    bool same = output.size() == input.size();
+    for (size_t i = 0; same && i < input.size(); i++) {
+        same = output[i].tick == input[i].tick && output[i].value == input[i].value;
+    }
+    if (!same) std::fprintf(stderr, "FAIL: %s: decoded %zu of %zu samples, mismatch\n", name, output.size(), input.size());
+    failures += same ? 0 : 1;
+    std::printf("%s: %zu samples, %d blocks\n", name, input.size(), blocks);
+}
+
+int main() {
+    std::mt19937 rng(7);
+
+    // 固定间隔、人数不变：整段是一个游程
+    std::vector<Sample> constant;
+    for (int i = 0; i < 100000; i++) constant.push_back({1000 + i * 4, 12});
+    roundTrip(constant, 4096, "constant");
+
+    // 间隔抖动、人数小幅变化
+    std::vector<Sample> jitter;
+    int64_t tick = 5;
+    int value = 20;
+    for (int i = 0; i < 200000; i++) {
+        tick += 3 + (int)(rng() % 3);
+        if (rng() % 4 == 0) value = std::max(0, value + (int)(rng() % 7) - 3);
+        jitter.push_back({tick, value});
+    }
+    roundTrip(jitter, 4096, "jitter");
+
+    // 大的时间跳变（断流）、大的人数变化，以及相同时间的样本
+    std::vector<Sample> jumps;
+    tick = 0;
+    for (int i = 0; i < 50000; i++) {
+        switch (rng() % 6) {
+        case 0: tick += 1 + (int64_t)(rng() % 100000000); break;
+        case 1: break;
+        default: tick += 4; break;
+        }
+        value = rng() % 5 == 0 ? (int)(rng() % 65536) : value;
+        jumps.push_back({tick, value});
+    }
+    roundTrip(jumps, 4096, "jumps");
+
+    // 很小的块：频繁换块
+    roundTrip(jitter, 64, "small blocks");
+
+    if (failures == 0) std::printf("series_codec_test: ok\n");
+    return failures == 0 ? 0 : 1;
+}